@@ -0,0 +1,482 @@
+#include <stdint.h>
+
+#include <vector>
+
+#include "barrett64.h"
+#include "benchmark/benchmark.h"
+#include "lucas64.h"
+#include "mod_arith.h"
+#include "montgomery64.h"
+#include "multiplicative64.h"
+#include "prime_sieve.h"
+#include "uint64_mod_ct.h"
+#include "uint64_mod_operation.h"
+
+// Benchmarks of the scalar modular operations.
+// Throughput : independent operations over an array of operands. Latency : every result feeds the next operation.
+// Operands are swept over bit lengths, moduli over shapes.
+// Results are JSON by default ( --benchmark_format=console for a table ), so runs can be diffed between releases.
+
+const size_t operand_count = 1024;
+
+// Modulus shapes, selected by index.
+const uint64_t moduli[] = {
+    65497,                  // 0 : small prime
+    0xFFFF'FFFB,            // 1 : 32-bit prime
+    ( 1ULL << 61 ) - 1,     // 2 : Mersenne prime
+    0xFFFF'FFFF'FFFF'FFC5,  // 3 : largest 64-bit prime
+    3ULL << 40,             // 4 : even, 42 bits
+    0xFFFF'FFFF'FFFF'FFFE,  // 5 : even, 64 bits
+};
+const char *const modulus_names[] = { "small", "p32", "mersenne61", "p64", "even42", "even64" };
+
+/**
+ * make_operands( int bits, size_t n, uint64_t seed )
+ * @return n pseudo-random values of exactly bits bits
+ */
+static std::vector<uint64_t> make_operands( const int bits, const size_t n, uint64_t seed ) {
+	std::vector<uint64_t> v( n );
+	const uint64_t mask = ( bits >= 64 ) ? ~0ULL : ( 1ULL << bits ) - 1;
+	const uint64_t top = 1ULL << ( bits - 1 );
+	for ( auto &&x : v ) {
+		seed = seed * 0x9E37'79B9'7F4A'7C15ULL + 1;
+		x = ( ( seed ^ ( seed >> 29 ) ) & mask ) | top;
+	}
+	return v;
+}
+
+// Args : operand bits, modulus index
+static void operand_args( benchmark::internal::Benchmark *b ) {
+	b->ArgNames( { "bits", "mod" } );
+	for ( int m = 0; m < static_cast<int>( sizeof( moduli ) / sizeof( moduli[ 0 ] ) ); m++ ) {
+		for ( int bits : { 8, 32, 48, 64 } ) {
+			b->Args( { bits, m } );
+		}
+	}
+}
+
+static void set_labels( benchmark::State &state, const size_t items ) {
+	state.SetItemsProcessed( static_cast<int64_t>( state.iterations() * items ) );
+	state.SetLabel( modulus_names[ state.range( 1 ) ] );
+}
+
+/**
+ * Binary operations : throughput and latency
+ */
+template <uint64_t ( *Op )( uint64_t, uint64_t, uint64_t )>
+static void BM_binary_throughput( benchmark::State &state ) {
+	const uint64_t mod = moduli[ state.range( 1 ) ];
+	const std::vector<uint64_t> a = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 1 );
+	const std::vector<uint64_t> b = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 2 );
+	for ( auto _ : state ) {
+		for ( size_t i = 0; i < operand_count; i++ ) {
+			benchmark::DoNotOptimize( Op( a[ i ], b[ i ], mod ) );
+		}
+	}
+	set_labels( state, operand_count );
+}
+
+template <uint64_t ( *Op )( uint64_t, uint64_t, uint64_t )>
+static void BM_binary_latency( benchmark::State &state ) {
+	const uint64_t mod = moduli[ state.range( 1 ) ];
+	const std::vector<uint64_t> b = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 2 );
+	uint64_t x = b[ 0 ] % mod;
+	for ( auto _ : state ) {
+		for ( size_t i = 0; i < operand_count; i++ ) {
+			x = Op( x, b[ i ], mod );
+		}
+		benchmark::DoNotOptimize( x );
+	}
+	set_labels( state, operand_count );
+}
+
+BENCHMARK_TEMPLATE( BM_binary_throughput, uaddmod64 )->Name( "uaddmod64/throughput" )->Apply( operand_args );
+BENCHMARK_TEMPLATE( BM_binary_latency, uaddmod64 )->Name( "uaddmod64/latency" )->Apply( operand_args );
+BENCHMARK_TEMPLATE( BM_binary_throughput, usubmod64 )->Name( "usubmod64/throughput" )->Apply( operand_args );
+BENCHMARK_TEMPLATE( BM_binary_latency, usubmod64 )->Name( "usubmod64/latency" )->Apply( operand_args );
+BENCHMARK_TEMPLATE( BM_binary_throughput, umulmod64 )->Name( "umulmod64/throughput" )->Apply( operand_args );
+BENCHMARK_TEMPLATE( BM_binary_latency, umulmod64 )->Name( "umulmod64/latency" )->Apply( operand_args );
+
+/**
+ * Reduced operands ( a, b < mod ), the domain of the ct:: functions : plain and branch-free versions side by side.
+ */
+template <uint64_t ( *Op )( uint64_t, uint64_t, uint64_t )>
+static void BM_reduced_throughput( benchmark::State &state ) {
+	const uint64_t mod = moduli[ state.range( 1 ) ];
+	std::vector<uint64_t> a = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 1 );
+	std::vector<uint64_t> b = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 2 );
+	for ( size_t i = 0; i < operand_count; i++ ) {
+		a[ i ] %= mod;
+		b[ i ] %= mod;
+	}
+	for ( auto _ : state ) {
+		for ( size_t i = 0; i < operand_count; i++ ) {
+			benchmark::DoNotOptimize( Op( a[ i ], b[ i ], mod ) );
+		}
+	}
+	set_labels( state, operand_count );
+}
+
+BENCHMARK_TEMPLATE( BM_reduced_throughput, uaddmod64 )->Name( "uaddmod64/reduced" )->Apply( operand_args );
+BENCHMARK_TEMPLATE( BM_reduced_throughput, ct::uaddmod64 )->Name( "ct::uaddmod64/reduced" )->Apply( operand_args );
+BENCHMARK_TEMPLATE( BM_reduced_throughput, usubmod64 )->Name( "usubmod64/reduced" )->Apply( operand_args );
+BENCHMARK_TEMPLATE( BM_reduced_throughput, ct::usubmod64 )->Name( "ct::usubmod64/reduced" )->Apply( operand_args );
+BENCHMARK_TEMPLATE( BM_reduced_throughput, umulmod64 )->Name( "umulmod64/reduced" )->Apply( operand_args );
+BENCHMARK_TEMPLATE( BM_reduced_throughput, ct::umulmod64 )->Name( "ct::umulmod64/reduced" )->Apply( operand_args );
+
+/**
+ * umulmod64 paths : udiv128() per call, Barrett64 reciprocal, Montgomery64 ( odd moduli )
+ */
+static void BM_umulmod64_barrett( benchmark::State &state ) {
+	const Barrett64 br( moduli[ state.range( 1 ) ] );
+	const std::vector<uint64_t> a = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 1 );
+	const std::vector<uint64_t> b = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 2 );
+	for ( auto _ : state ) {
+		for ( size_t i = 0; i < operand_count; i++ ) {
+			benchmark::DoNotOptimize( umulmod64( a[ i ], b[ i ], br ) );
+		}
+	}
+	set_labels( state, operand_count );
+}
+BENCHMARK( BM_umulmod64_barrett )->Name( "umulmod64/barrett" )->Apply( operand_args );
+
+static void BM_ct_umulmod64_barrett( benchmark::State &state ) {
+	const Barrett64 br( moduli[ state.range( 1 ) ] );
+	std::vector<uint64_t> a = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 1 );
+	std::vector<uint64_t> b = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 2 );
+	for ( size_t i = 0; i < operand_count; i++ ) {
+		a[ i ] = br.reduce( a[ i ] );
+		b[ i ] = br.reduce( b[ i ] );
+	}
+	for ( auto _ : state ) {
+		for ( size_t i = 0; i < operand_count; i++ ) {
+			benchmark::DoNotOptimize( ct::umulmod64( a[ i ], b[ i ], br ) );
+		}
+	}
+	set_labels( state, operand_count );
+}
+BENCHMARK( BM_ct_umulmod64_barrett )->Name( "ct::umulmod64/barrett" )->Apply( operand_args );
+
+static void BM_umulmod64_montgomery( benchmark::State &state ) {
+	const uint64_t mod = moduli[ state.range( 1 ) ];
+	if ( ( mod & 1 ) == 0 ) {
+		state.SkipWithError( "even modulus" );
+		return;
+	}
+	const Montgomery64 mg( mod );
+	std::vector<uint64_t> a = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 1 );
+	std::vector<uint64_t> b = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 2 );
+	for ( size_t i = 0; i < operand_count; i++ ) {
+		a[ i ] = mg.to_mont( a[ i ] );
+		b[ i ] = mg.to_mont( b[ i ] );
+	}
+	for ( auto _ : state ) {
+		for ( size_t i = 0; i < operand_count; i++ ) {
+			benchmark::DoNotOptimize( mg.mul( a[ i ], b[ i ] ) );
+		}
+	}
+	set_labels( state, operand_count );
+}
+BENCHMARK( BM_umulmod64_montgomery )->Name( "umulmod64/montgomery" )->Apply( operand_args );
+
+/**
+ * powmod64 : Args are exponent bits and modulus index.
+ */
+static void BM_powmod64( benchmark::State &state ) {
+	const uint64_t mod = moduli[ state.range( 1 ) ];
+	const std::vector<uint64_t> a = make_operands( 64, operand_count, 1 );
+	const std::vector<uint64_t> e = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 3 );
+	for ( auto _ : state ) {
+		for ( size_t i = 0; i < operand_count; i++ ) {
+			benchmark::DoNotOptimize( powmod64( a[ i ], e[ i ], mod ) );
+		}
+	}
+	set_labels( state, operand_count );
+}
+BENCHMARK( BM_powmod64 )->Apply( operand_args );
+
+/**
+ * umodinv64 : operands of the given bits, coprime to the modulus.
+ */
+static void BM_umodinv64( benchmark::State &state ) {
+	const uint64_t mod = moduli[ state.range( 1 ) ];
+	std::vector<uint64_t> a = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 1 );
+	for ( auto &&x : a ) {
+		while ( ugcd64( x, mod ) != 1 ) {
+			x++;
+		}
+	}
+	for ( auto _ : state ) {
+		for ( size_t i = 0; i < operand_count; i++ ) {
+			benchmark::DoNotOptimize( umodinv64( a[ i ], mod ) );
+		}
+	}
+	set_labels( state, operand_count );
+}
+BENCHMARK( BM_umodinv64 )->Apply( operand_args );
+
+/**
+ * is_prime : Args are bits and input kind.
+ */
+enum prime_input { primes, odd_composites, strong_pseudoprimes };
+const char *const prime_input_names[] = { "primes", "odd_composites", "strong_pseudoprimes" };
+
+// Strong pseudoprimes to base 2 ( and more bases ), which pass the first Miller-Rabin rounds.
+const uint64_t pseudoprimes[] = { 2047, 3215031751ULL, 341550071728321ULL, 3825123056546413051ULL };
+
+// 3 * 5 * ... * 41 : composites without a factor below 43 are not rejected by trial division.
+const uint64_t small_odd_primorial = 0x8A5B'6470'AF95ULL;
+
+static std::vector<uint64_t> make_prime_inputs( const int bits, const prime_input kind ) {
+	std::vector<uint64_t> v;
+	if ( kind == strong_pseudoprimes ) {
+		for ( size_t i = 0; v.size() < operand_count; i++ ) {
+			v.push_back( pseudoprimes[ i % ( sizeof( pseudoprimes ) / sizeof( pseudoprimes[ 0 ] ) ) ] );
+		}
+		return v;
+	}
+	// Odd candidates of exactly bits bits.
+	for ( const uint64_t x : make_operands( bits, operand_count * 64, 5 ) ) {
+		if ( v.size() == operand_count ) {
+			break;
+		}
+		const uint64_t n = x | 1;
+		if ( is_prime( n ) == ( kind == primes ) && ( kind == primes || ugcd64( n, small_odd_primorial ) == 1 ) ) {
+			v.push_back( n );
+		}
+	}
+	return v;
+}
+
+template <bool ( *Test )( uint64_t )>
+static void BM_is_prime( benchmark::State &state ) {
+	const prime_input kind = static_cast<prime_input>( state.range( 1 ) );
+	const std::vector<uint64_t> n = make_prime_inputs( static_cast<int>( state.range( 0 ) ), kind );
+	for ( auto _ : state ) {
+		for ( auto &&x : n ) {
+			benchmark::DoNotOptimize( Test( x ) );
+		}
+	}
+	state.SetItemsProcessed( static_cast<int64_t>( state.iterations() * n.size() ) );
+	state.SetLabel( prime_input_names[ kind ] );
+}
+BENCHMARK_TEMPLATE( BM_is_prime, is_prime )
+    ->Name( "BM_is_prime" )
+    ->ArgNames( { "bits", "kind" } )
+    ->ArgsProduct( { { 16, 32, 48, 64 }, { primes, odd_composites } } )
+    ->Args( { 64, strong_pseudoprimes } );
+BENCHMARK_TEMPLATE( BM_is_prime, bpsw_is_prime )
+    ->Name( "BM_bpsw_is_prime" )
+    ->ArgNames( { "bits", "kind" } )
+    ->ArgsProduct( { { 16, 32, 48, 64 }, { primes, odd_composites } } )
+    ->Args( { 64, strong_pseudoprimes } );
+
+/**
+ * Prime search : next_prime(), and runs of 1000 primes by next_primes() against an is_prime( n += 2 ) loop. Arg is bits.
+ */
+static void BM_next_prime( benchmark::State &state ) {
+	const std::vector<uint64_t> n = make_operands( static_cast<int>( state.range( 0 ) ), 64, 8 );
+	for ( auto _ : state ) {
+		for ( auto &&x : n ) {
+			// Below the largest 64-bit prime.
+			benchmark::DoNotOptimize( next_prime( x >> 1 ) );
+		}
+	}
+	state.SetItemsProcessed( static_cast<int64_t>( state.iterations() * n.size() ) );
+}
+BENCHMARK( BM_next_prime )->ArgName( "bits" )->Arg( 32 )->Arg( 48 )->Arg( 64 );
+
+static std::vector<uint64_t> next_primes_loop( uint64_t n, const size_t k ) {
+	std::vector<uint64_t> primes;
+	n = ( n + 1 ) | 1;
+	while ( primes.size() < k ) {
+		if ( is_prime( n ) ) {
+			primes.push_back( n );
+		}
+		n += 2;
+	}
+	return primes;
+}
+
+template <std::vector<uint64_t> ( *Run )( uint64_t, size_t )>
+static void BM_next_primes( benchmark::State &state ) {
+	const uint64_t n = make_operands( static_cast<int>( state.range( 0 ) ), 1, 9 )[ 0 ] >> 1;
+	for ( auto _ : state ) {
+		benchmark::DoNotOptimize( Run( n, 1000 ) );
+	}
+	state.SetItemsProcessed( static_cast<int64_t>( state.iterations() * 1000 ) );
+}
+BENCHMARK_TEMPLATE( BM_next_primes, next_primes )->Name( "next_primes" )->ArgName( "bits" )->Arg( 32 )->Arg( 48 )->Arg( 64 );
+BENCHMARK_TEMPLATE( BM_next_primes, next_primes_loop )
+    ->Name( "next_primes/is_prime_loop" )
+    ->ArgName( "bits" )
+    ->Arg( 32 )
+    ->Arg( 48 )
+    ->Arg( 64 );
+
+/**
+ * isqrt / is_square : Args are bits and whether the inputs are squares.
+ */
+static void BM_isqrt( benchmark::State &state ) {
+	const std::vector<uint64_t> n = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 7 );
+	for ( auto _ : state ) {
+		for ( auto &&x : n ) {
+			benchmark::DoNotOptimize( isqrt( x ) );
+		}
+	}
+	state.SetItemsProcessed( static_cast<int64_t>( state.iterations() * n.size() ) );
+}
+BENCHMARK( BM_isqrt )->ArgName( "bits" )->Arg( 8 )->Arg( 32 )->Arg( 48 )->Arg( 64 );
+
+static void BM_is_square( benchmark::State &state ) {
+	std::vector<uint64_t> n = make_operands( static_cast<int>( state.range( 0 ) ), operand_count, 7 );
+	if ( state.range( 1 ) ) {
+		for ( auto &&x : n ) {
+			const uint64_t r = isqrt( x );
+			x = r * r;
+		}
+	}
+	for ( auto _ : state ) {
+		for ( auto &&x : n ) {
+			benchmark::DoNotOptimize( is_square( x ) );
+		}
+	}
+	state.SetItemsProcessed( static_cast<int64_t>( state.iterations() * n.size() ) );
+	state.SetLabel( state.range( 1 ) ? "squares" : "random" );
+}
+BENCHMARK( BM_is_square )->ArgNames( { "bits", "square" } )->ArgsProduct( { { 8, 32, 48, 64 }, { 0, 1 } } );
+
+/**
+ * Discrete logarithms modulo 10^9 + 7 ( p - 1 = 2 * 500000003 ) : one-shot, and precomputed with Arg = scale.
+ */
+static void BM_discrete_log64( benchmark::State &state ) {
+	const uint64_t p = 1000000007, g = 5;
+	const std::vector<uint64_t> x = make_operands( 29, 16, 10 );
+	for ( auto _ : state ) {
+		for ( auto &&e : x ) {
+			benchmark::DoNotOptimize( discrete_log64( g, powmod64( g, e, p ), p ) );
+		}
+	}
+	state.SetItemsProcessed( static_cast<int64_t>( state.iterations() * x.size() ) );
+}
+BENCHMARK( BM_discrete_log64 );
+
+static void BM_discrete_log64_table( benchmark::State &state ) {
+	const uint64_t p = 1000000007, g = 5;
+	const DiscreteLog64 dlog( g, p, static_cast<uint32_t>( state.range( 0 ) ) );
+	const std::vector<uint64_t> x = make_operands( 29, 16, 10 );
+	for ( auto _ : state ) {
+		for ( auto &&e : x ) {
+			benchmark::DoNotOptimize( dlog.log( powmod64( g, e, p ) ) );
+		}
+	}
+	state.SetItemsProcessed( static_cast<int64_t>( state.iterations() * x.size() ) );
+}
+BENCHMARK( BM_discrete_log64_table )->ArgName( "scale" )->Arg( 1 )->Arg( 4 )->Arg( 16 );
+
+/**
+ * Multi-precision moduli : primes of N limbs, 2^64 - 59, 2^128 - 159, 2^255 - 19.
+ */
+template <size_t N>
+static uint_n<N> prime_n() {
+	uint_n<N> p;
+	for ( auto &&x : p.limb ) {
+		x = ~0ULL;
+	}
+	if constexpr ( N == 1 ) {
+		p.limb[ 0 ] -= 58;
+	} else if constexpr ( N == 2 ) {
+		p.limb[ 0 ] -= 158;
+	} else {
+		p.limb[ 0 ] -= 18;
+		p.limb[ N - 1 ] >>= 1;
+	}
+	return p;
+}
+
+template <size_t N>
+static std::vector<uint_n<N>> make_operands_n( const MontgomeryN<N> &mg, const size_t n, const uint64_t seed ) {
+	std::vector<uint_n<N>> v( n );
+	for ( size_t i = 0; i < N; i++ ) {
+		const std::vector<uint64_t> x = make_operands( 64, n, seed * N + i );
+		for ( size_t j = 0; j < n; j++ ) {
+			v[ j ].limb[ i ] = x[ j ];
+		}
+	}
+	for ( auto &&a : v ) {
+		a = mg.to_mont( a );
+	}
+	return v;
+}
+
+template <size_t N>
+static void BM_MontgomeryN_mul( benchmark::State &state ) {
+	const MontgomeryN<N> mg( prime_n<N>() );
+	const std::vector<uint_n<N>> a = make_operands_n( mg, operand_count, 1 );
+	const std::vector<uint_n<N>> b = make_operands_n( mg, operand_count, 2 );
+	for ( auto _ : state ) {
+		for ( size_t i = 0; i < operand_count; i++ ) {
+			benchmark::DoNotOptimize( mg.mul( a[ i ], b[ i ] ) );
+		}
+	}
+	state.SetItemsProcessed( static_cast<int64_t>( state.iterations() * operand_count ) );
+}
+BENCHMARK_TEMPLATE( BM_MontgomeryN_mul, 1 );
+BENCHMARK_TEMPLATE( BM_MontgomeryN_mul, 2 );
+BENCHMARK_TEMPLATE( BM_MontgomeryN_mul, 4 );
+
+/**
+ * ModArith<N>::pow with a full-width exponent.
+ */
+template <size_t N>
+static void BM_ModArith_pow( benchmark::State &state ) {
+	const uint_n<N> p = prime_n<N>();
+	const ModArith<N> ma( p );
+	const std::vector<uint_n<N>> a = make_operands_n( ma.montgomery(), 64, 1 );
+	const std::vector<uint_n<N>> e = make_operands_n( ma.montgomery(), 64, 3 );
+	for ( auto _ : state ) {
+		for ( size_t i = 0; i < a.size(); i++ ) {
+			benchmark::DoNotOptimize( ma.pow( a[ i ], e[ i ] ) );
+		}
+	}
+	state.SetItemsProcessed( static_cast<int64_t>( state.iterations() * a.size() ) );
+}
+BENCHMARK_TEMPLATE( BM_ModArith_pow, 2 );
+BENCHMARK_TEMPLATE( BM_ModArith_pow, 4 );
+
+template <size_t N>
+static void BM_is_prime_n( benchmark::State &state ) {
+	const uint_n<N> p = prime_n<N>();
+	for ( auto _ : state ) {
+		benchmark::DoNotOptimize( is_prime( p ) );
+	}
+	state.SetItemsProcessed( static_cast<int64_t>( state.iterations() ) );
+}
+BENCHMARK_TEMPLATE( BM_is_prime_n, 2 );
+BENCHMARK_TEMPLATE( BM_is_prime_n, 4 );
+
+template <size_t N>
+static void BM_bpsw_is_prime_n( benchmark::State &state ) {
+	const uint_n<N> p = prime_n<N>();
+	for ( auto _ : state ) {
+		benchmark::DoNotOptimize( bpsw_is_prime( p ) );
+	}
+	state.SetItemsProcessed( static_cast<int64_t>( state.iterations() ) );
+}
+BENCHMARK_TEMPLATE( BM_bpsw_is_prime_n, 2 );
+BENCHMARK_TEMPLATE( BM_bpsw_is_prime_n, 4 );
+
+int main( int argc, char **argv ) {
+	// JSON unless the command line asks for another format : later flags override earlier ones.
+	std::vector<char *> args( argv, argv + argc );
+	static char json_format[] = "--benchmark_format=json";
+	args.insert( args.begin() + ( argc > 0 ? 1 : 0 ), json_format );
+	int count = static_cast<int>( args.size() );
+	benchmark::Initialize( &count, args.data() );
+	if ( benchmark::ReportUnrecognizedArguments( count, args.data() ) ) {
+		return 1;
+	}
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
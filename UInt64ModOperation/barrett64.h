@@ -0,0 +1,169 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <stdexcept>
+
+#include "uint64_mod_operation.h"
+
+/**
+ * Barrett64
+ * Modular arithmetic context for a fixed modulus, odd or even.
+ * The normalized modulus d = mod * 2^shift and its reciprocal v = floor( ( 2^128 - 1 ) / d ) - 2^64 are precomputed,
+ * and every reduction is a 2-by-1 division by an invariant integer ( Möller, Granlund ) : two multiplications and no
+ * division after construction.
+ * Values are ordinary residues, so they can be mixed freely with uaddmod64() / umulmod64() results.
+ */
+class Barrett64 {
+   public:
+	/**
+	 * Barrett64( uint64_t mod )
+	 * @param mod modular, mod >= 1
+	 */
+	explicit Barrett64( const uint64_t mod ) : mod_( mod ) {
+		if ( mod == 0 ) {
+			throw std::overflow_error( "Divide by Zero." );
+		}
+		shift_ = ulzcnt64( mod );
+		norm_ = mod << shift_;
+		// ( 2^128 - 1 ) - 2^64 * d = ~d * 2^64 + ( 2^64 - 1 ), and ~d < d.
+		uint64_t rem = 0;
+		reciprocal_ = udiv128( ~norm_, ~0ULL, norm_, &rem );
+	}
+
+	uint64_t modulus() const { return mod_; }
+
+	/**
+	 * one()
+	 * @return 1 % mod
+	 */
+	uint64_t one() const { return ( mod_ == 1 ) ? 0 : 1; }
+
+	/**
+	 * reduce( uint64_t a )
+	 * @param a
+	 * @return a % mod
+	 */
+	uint64_t reduce( const uint64_t a ) const { return reduce( 0, a ); }
+
+	/**
+	 * reduce( uint64_t hi, uint64_t lo )
+	 * @return ( hi * 2^64 + lo ) % mod, requires hi < mod
+	 */
+	uint64_t reduce( const uint64_t hi, const uint64_t lo ) const {
+		uint64_t q0 = 0;
+		uint64_t r = estimate( hi, lo, &q0 );
+		if ( r > q0 ) {
+			r += norm_;
+		}
+		if ( r >= norm_ ) {
+			r -= norm_;
+		}
+		return r >> shift_;
+	}
+
+	/**
+	 * mul( uint64_t a, uint64_t b )
+	 * @param a a < mod
+	 * @param b b < mod
+	 * @return a * b % mod
+	 */
+	uint64_t mul( const uint64_t a, const uint64_t b ) const {
+		uint64_t hi = 0;
+		const uint64_t lo = umul128( a, b, &hi );
+		return reduce( hi, lo );
+	}
+
+	/**
+	 * reduce_ct( uint64_t hi, uint64_t lo )
+	 * Same as reduce( hi, lo ), with the two corrections done by borrow masks instead of branches.
+	 * @return ( hi * 2^64 + lo ) % mod, requires hi < mod
+	 */
+	uint64_t reduce_ct( const uint64_t hi, const uint64_t lo ) const {
+		uint64_t q0 = 0;
+		uint64_t r = estimate( hi, lo, &q0 );
+		// r > q0 : add norm back.
+		uint64_t borrow = 0;
+		usubb64( q0, r, 0, &borrow );
+		r += norm_ & ( 0 - borrow );
+		// r >= norm : subtract norm.
+		usubb64( r, norm_, 0, &borrow );
+		r -= norm_ & ( 0 - ( borrow ^ 1 ) );
+		return r >> shift_;
+	}
+
+	/**
+	 * mul_ct( uint64_t a, uint64_t b )
+	 * @param a a < mod
+	 * @param b b < mod
+	 * @return a * b % mod, in time independent of a and b
+	 */
+	uint64_t mul_ct( const uint64_t a, const uint64_t b ) const {
+		uint64_t hi = 0;
+		const uint64_t lo = umul128( a, b, &hi );
+		return reduce_ct( hi, lo );
+	}
+
+	uint64_t add( const uint64_t a, const uint64_t b ) const {
+		const uint64_t s = a + b;
+		// s < a : a + b overflowed.
+		return ( s < a || s >= mod_ ) ? s - mod_ : s;
+	}
+
+	uint64_t sub( const uint64_t a, const uint64_t b ) const { return ( a < b ) ? a - b + mod_ : a - b; }
+
+	/**
+	 * pow( uint64_t a, uint64_t e )
+	 * @param a base, a < mod
+	 * @param e exponent
+	 * @return a ** e % mod
+	 */
+	uint64_t pow( const uint64_t a, const uint64_t e ) const { return sliding_window_pow( *this, a, e ); }
+
+   private:
+	/**
+	 * estimate( uint64_t hi, uint64_t lo, uint64_t *q0 )
+	 * Quotient estimate of x * 2^shift by norm, x = hi * 2^64 + lo.
+	 * @param q0 low word of the estimate, for the corrections
+	 * @return x * 2^shift - q * norm mod 2^64, at most two corrections away from the normalized remainder
+	 */
+	uint64_t estimate( const uint64_t hi, const uint64_t lo, uint64_t *q0 ) const {
+		// x * 2^shift = u1 * 2^64 + u0, u1 < d. ( lo >> 1 ) >> ( 63 - shift ) : no shift by 64 when shift == 0.
+		const uint64_t u1 = ( hi << shift_ ) | ( ( lo >> 1 ) >> ( 63 - shift_ ) );
+		const uint64_t u0 = lo << shift_;
+		uint64_t q1 = 0, carry = 0;
+		*q0 = uaddc64( umul128( reciprocal_, u1, &q1 ), u0, 0, &carry );
+		q1 += u1 + 1 + carry;
+		return u0 - q1 * norm_;
+	}
+
+	uint64_t mod_;
+	int shift_;            // ulzcnt64( mod )
+	uint64_t norm_;        // mod << shift
+	uint64_t reciprocal_;  // floor( ( 2^128 - 1 ) / norm ) - 2^64
+};
+
+/**
+ * uaddmod64( uint64_t a, uint64_t b, const Barrett64 &ctx )
+ * @return ( a + b ) % ctx.modulus()
+ */
+inline uint64_t uaddmod64( const uint64_t a, const uint64_t b, const Barrett64 &ctx ) {
+	return ctx.add( ctx.reduce( a ), ctx.reduce( b ) );
+}
+
+/**
+ * usubmod64( uint64_t a, uint64_t b, const Barrett64 &ctx )
+ * @return ( a - b ) % ctx.modulus()
+ */
+inline uint64_t usubmod64( const uint64_t a, const uint64_t b, const Barrett64 &ctx ) {
+	return ctx.sub( ctx.reduce( a ), ctx.reduce( b ) );
+}
+
+/**
+ * umulmod64( uint64_t a, uint64_t b, const Barrett64 &ctx )
+ * @return ( a * b ) % ctx.modulus()
+ */
+inline uint64_t umulmod64( const uint64_t a, const uint64_t b, const Barrett64 &ctx ) {
+	const uint64_t mod = ctx.modulus();
+	return ctx.mul( ( a < mod ) ? a : ctx.reduce( a ), ( b < mod ) ? b : ctx.reduce( b ) );
+}
@@ -0,0 +1,252 @@
+#include "factor64.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "montgomery64.h"
+#include "uint64_mod_operation.h"
+
+// Trial division limit. After trial division, a cofactor < trial_limit^2 is 1 or a prime.
+const uint64_t trial_limit = 1024;
+
+// Pollard-Brent : number of products accumulated before each gcd, and the iteration limit per polynomial.
+const uint64_t rho_batch = 128;
+const uint64_t rho_max_iterations = 1ULL << 22;
+
+/**
+ * trial_divisors()
+ * @return ( p, p^-1 % 2^64, ( 2^64 - 1 ) / p ) for odd primes p < trial_limit
+ */
+struct odd_divisor {
+	uint64_t p;
+	uint64_t inv;
+	uint64_t max;
+};
+
+static const std::vector<odd_divisor> &trial_divisors() {
+	static const std::vector<odd_divisor> divisors = [] {
+		std::vector<odd_divisor> d;
+		for ( uint64_t p = 3; p < trial_limit; p += 2 ) {
+			if ( is_prime( p ) ) {
+				uint64_t inv = p;
+				for ( int i = 0; i < 5; i++ ) {
+					inv *= 2 - p * inv;
+				}
+				d.push_back( odd_divisor{ p, inv, std::numeric_limits<uint64_t>::max() / p } );
+			}
+		}
+		return d;
+	}();
+	return divisors;
+}
+
+/**
+ * pollard_brent64( uint64_t n, uint64_t c )
+ * Pollard's rho, Brent's cycle detection, x -> x^2 + c in Montgomery form.
+ * |x - y| are multiplied together and one gcd is taken every rho_batch steps.
+ * @param n odd composite
+ * @param c polynomial constant
+ * @return a non-trivial factor of n, or 0 if this c failed
+ */
+uint64_t pollard_brent64( const uint64_t n, const uint64_t c ) {
+	const Montgomery64 mg( n );
+	const uint64_t mc = mg.to_mont( c );
+	auto f = [ & ]( const uint64_t v ) { return mg.add( mg.mul( v, v ), mc ); };
+
+	uint64_t y = mg.to_mont( 2 );
+	uint64_t x = y;
+	uint64_t ys = y;
+	uint64_t q = mg.one();
+	uint64_t g = 1;
+
+	for ( uint64_t r = 1; g == 1 && r <= rho_max_iterations; r <<= 1 ) {
+		x = y;
+		for ( uint64_t i = 0; i < r; i++ ) {
+			y = f( y );
+		}
+		for ( uint64_t k = 0; k < r && g == 1; k += rho_batch ) {
+			ys = y;
+			const uint64_t steps = ( r - k < rho_batch ) ? r - k : rho_batch;
+			for ( uint64_t i = 0; i < steps; i++ ) {
+				y = f( y );
+				// gcd( a * R, n ) = gcd( a, n )
+				q = mg.mul( q, ( x > y ) ? x - y : y - x );
+			}
+			g = ugcd64( q, n );
+		}
+	}
+
+	if ( g == n ) {
+		// The batch overshot : step again one by one from the start of the batch.
+		do {
+			ys = f( ys );
+			g = ugcd64( ( x > ys ) ? x - ys : ys - x, n );
+		} while ( g == 1 );
+	}
+	return ( g == 1 || g == n ) ? 0 : g;
+}
+
+/**
+ * squfof64( uint64_t n )
+ * Shanks' square forms factorization with multipliers.
+ * @param n odd composite, not a perfect square
+ * @return a non-trivial factor of n, or 0 if no multiplier succeeded
+ */
+uint64_t squfof64( const uint64_t n ) {
+	const static uint64_t multipliers[] = {
+	    1,          3,          5,          7,          11,         3 * 5,      3 * 7,          3 * 11,
+	    5 * 7,      5 * 11,     7 * 11,     3 * 5 * 7,  3 * 5 * 11, 3 * 7 * 11, 5 * 7 * 11,     3 * 5 * 7 * 11,
+	};
+
+	const uint64_t s = isqrt( n );
+	if ( s * s == n ) {
+		return s;
+	}
+	const uint64_t limit = 3 * 2 * isqrt( 2 * s );
+
+	for ( const uint64_t k : multipliers ) {
+		if ( n > ( std::numeric_limits<uint64_t>::max() >> 2 ) / k ) {
+			break;
+		}
+		const uint64_t d = k * n;
+		const uint64_t p0 = isqrt( d );
+		uint64_t p_prev = p0;
+		uint64_t p = p0;
+		uint64_t q_prev = 1;
+		uint64_t q = d - p0 * p0;
+		if ( q == 0 ) {
+			continue;
+		}
+
+		// Forward cycle : find a square Q at an even step.
+		uint64_t i = 2;
+		uint64_t r = 0;
+		for ( ; i < limit; i++ ) {
+			const uint64_t b = ( p0 + p ) / q;
+			p = b * q - p;
+			const uint64_t t = q;
+			q = q_prev + b * ( p_prev - p );
+			if ( ( i & 1 ) == 0 && is_square( q ) ) {
+				r = isqrt( q );
+				break;
+			}
+			q_prev = t;
+			p_prev = p;
+		}
+		if ( i >= limit ) {
+			continue;
+		}
+
+		// Reverse cycle : from the square root form until P repeats.
+		uint64_t b = ( p0 - p ) / r;
+		p_prev = p = b * r + p;
+		q_prev = r;
+		q = ( d - p_prev * p_prev ) / q_prev;
+		for ( i = 0; i < limit; i++ ) {
+			b = ( p0 + p ) / q;
+			p_prev = p;
+			p = b * q - p;
+			const uint64_t t = q;
+			q = q_prev + b * ( p_prev - p );
+			q_prev = t;
+			if ( p == p_prev ) {
+				break;
+			}
+		}
+		if ( i >= limit ) {
+			continue;
+		}
+
+		const uint64_t g = ugcd64( n, q_prev );
+		if ( g != 1 && g != n ) {
+			return g;
+		}
+	}
+	return 0;
+}
+
+/**
+ * find_factor( uint64_t n )
+ * @param n odd composite without factors below trial_limit
+ * @return a non-trivial factor of n
+ */
+static uint64_t find_factor( const uint64_t n ) {
+	const uint64_t root = isqrt( n );
+	if ( root * root == n ) {
+		return root;
+	}
+	for ( uint64_t c = 1; c < 16; c++ ) {
+		const uint64_t g = pollard_brent64( n, c );
+		if ( g != 0 ) {
+			return g;
+		}
+	}
+	const uint64_t g = squfof64( n );
+	if ( g != 0 ) {
+		return g;
+	}
+	for ( uint64_t c = 16;; c++ ) {
+		const uint64_t g = pollard_brent64( n, c );
+		if ( g != 0 ) {
+			return g;
+		}
+	}
+}
+
+static void factor_odd( const uint64_t n, std::vector<uint64_t> &primes ) {
+	if ( n == 1 ) {
+		return;
+	}
+	if ( n < trial_limit * trial_limit || is_prime( n ) ) {
+		primes.push_back( n );
+		return;
+	}
+	const uint64_t d = find_factor( n );
+	factor_odd( d, primes );
+	factor_odd( n / d, primes );
+}
+
+/**
+ * factor64( uint64_t n )
+ * @param n
+ * @return prime factors of n with multiplicities. Empty for n = 0 and n = 1.
+ */
+factorization factor64( uint64_t n ) {
+	factorization result;
+	if ( n < 2 ) {
+		return result;
+	}
+
+	const int twos = utzcnt64( n );
+	if ( twos > 0 ) {
+		result.emplace_back( 2, twos );
+		n >>= twos;
+	}
+
+	for ( const auto &t : trial_divisors() ) {
+		if ( t.p * t.p > n ) {
+			break;
+		}
+		uint32_t e = 0;
+		// n % p == 0  <=>  n * p^-1 <= ( 2^64 - 1 ) / p, and then n / p = n * p^-1.
+		while ( n * t.inv <= t.max ) {
+			n *= t.inv;
+			e++;
+		}
+		if ( e > 0 ) {
+			result.emplace_back( t.p, e );
+		}
+	}
+
+	std::vector<uint64_t> primes;
+	factor_odd( n, primes );
+	std::sort( primes.begin(), primes.end() );
+	for ( const uint64_t p : primes ) {
+		if ( !result.empty() && result.back().first == p ) {
+			result.back().second++;
+		} else {
+			result.emplace_back( p, 1 );
+		}
+	}
+	return result;
+}
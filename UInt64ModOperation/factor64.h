@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+// Prime factorization of 64-bit integers.
+// Trial division by small primes, is_prime(), Pollard-Brent rho ( Montgomery form, batched GCD ) and SQUFOF.
+
+// ( prime, multiplicity ) in increasing order of prime.
+using factorization = std::vector<std::pair<uint64_t, uint32_t>>;
+
+factorization factor64( uint64_t n );
+uint64_t pollard_brent64( uint64_t n, uint64_t c );
+uint64_t squfof64( uint64_t n );
@@ -0,0 +1,71 @@
+#include "fixed_base_pow.h"
+
+FixedBasePow::FixedBasePow( const uint64_t base, const uint64_t mod, const int teeth )
+    : base_( base ), teeth_( teeth ), spacing_( 0 ), br_( mod ) {
+	if ( teeth < 1 || teeth > 16 ) {
+		throw std::invalid_argument( "teeth must be in 1 .. 16." );
+	}
+	spacing_ = ( 64 + teeth - 1 ) / teeth;
+	if ( mod & 1 ) {
+		mg_.emplace( mod );
+		build( *mg_, mg_->to_mont( base ) );
+	} else {
+		build( br_, br_.reduce( base ) );
+	}
+}
+
+/**
+ * build( const Ring &ring, uint64_t x )
+ * table[ idx ] = product of x^( 2^( j * spacing ) ) over the set bits j of idx.
+ */
+template <typename Ring>
+void FixedBasePow::build( const Ring &ring, uint64_t x ) {
+	table_.assign( size_t( 1 ) << teeth_, ring.one() );
+	for ( int j = 0; j < teeth_; j++ ) {
+		// x = base^( 2^( j * spacing ) )
+		const size_t bit = size_t( 1 ) << j;
+		for ( size_t idx = bit; idx < ( bit << 1 ); idx++ ) {
+			table_[ idx ] = ring.mul( table_[ idx - bit ], x );
+		}
+		for ( int i = 0; i < spacing_; i++ ) {
+			x = ring.mul( x, x );
+		}
+	}
+}
+
+/**
+ * comb( const Ring &ring, uint64_t e )
+ * Column i collects the exponent bits i, i + spacing, i + 2 spacing, ...
+ */
+template <typename Ring>
+uint64_t FixedBasePow::comb( const Ring &ring, const uint64_t e ) const {
+	uint64_t ans = ring.one();
+	bool first = true;
+	for ( int i = spacing_ - 1; i >= 0; i-- ) {
+		size_t idx = 0;
+		for ( int j = 0; j < teeth_ && j * spacing_ + i < 64; j++ ) {
+			idx |= static_cast<size_t>( ( e >> ( j * spacing_ + i ) ) & 1 ) << j;
+		}
+		if ( first ) {
+			// Leading zero columns : no squarings of one.
+			if ( idx == 0 ) {
+				continue;
+			}
+			ans = table_[ idx ];
+			first = false;
+			continue;
+		}
+		ans = ring.mul( ans, ans );
+		if ( idx != 0 ) {
+			ans = ring.mul( ans, table_[ idx ] );
+		}
+	}
+	return ans;
+}
+
+uint64_t FixedBasePow::pow( const uint64_t e ) const {
+	if ( mg_ ) {
+		return mg_->from_mont( comb( *mg_, e ) );
+	}
+	return comb( br_, e );
+}
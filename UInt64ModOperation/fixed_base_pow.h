@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <optional>
+#include <vector>
+
+#include "barrett64.h"
+#include "montgomery64.h"
+
+/**
+ * FixedBasePow
+ * Powers of one base under one modulus, with the comb method ( Lim, Lee ).
+ * The 64 exponent bits are split into teeth rows of spacing = ceil( 64 / teeth ) bits, and the products of
+ * base^( 2^( j * spacing ) ) over every subset of rows are precomputed : 2^teeth entries.
+ * pow() then costs spacing - 1 squarings and spacing multiplications, 7 + 8 with the default 8 teeth.
+ */
+class FixedBasePow {
+   public:
+	/**
+	 * FixedBasePow( uint64_t base, uint64_t mod, int teeth )
+	 * @param base
+	 * @param mod modular, mod >= 1
+	 * @param teeth 1 .. 16, the table has 2^teeth entries
+	 */
+	FixedBasePow( uint64_t base, uint64_t mod, int teeth = 8 );
+
+	uint64_t base() const { return base_; }
+	uint64_t modulus() const { return br_.modulus(); }
+
+	/**
+	 * pow( uint64_t e )
+	 * @param e exponent
+	 * @return ( base ** e ) % mod, 0 ** 0 = 1 % mod
+	 */
+	uint64_t pow( uint64_t e ) const;
+
+   private:
+	template <typename Ring>
+	void build( const Ring &ring, uint64_t x );
+	template <typename Ring>
+	uint64_t comb( const Ring &ring, uint64_t e ) const;
+
+	uint64_t base_;
+	int teeth_;
+	int spacing_;
+	Barrett64 br_;
+	std::optional<Montgomery64> mg_;  // odd modulus
+	std::vector<uint64_t> table_;     // Montgomery form if mg_
+};
@@ -0,0 +1,44 @@
+#include "lucas64.h"
+
+#include <stdexcept>
+
+/**
+ * lucas_uv64( int64_t p, int64_t q, uint64_t k, uint64_t n )
+ * @param p P
+ * @param q Q
+ * @param k index
+ * @param n odd modular
+ * @return U_k( P, Q ) % n, V_k( P, Q ) % n, Q^k % n
+ */
+lucas_terms<uint64_t> lucas_uv64( const int64_t p, const int64_t q, const uint64_t k, const uint64_t n ) {
+	const Montgomery64 mg( n );
+	const lucas_terms<uint64_t> t = lucas::sequence( mg, lucas::from_int( mg, p ), lucas::from_int( mg, q ), k );
+	return lucas_terms<uint64_t>{ mg.from_mont( t.u ), mg.from_mont( t.v ), mg.from_mont( t.qk ) };
+}
+
+/**
+ * is_strong_lucas_prp64( const Montgomery64 &mg )
+ * @param mg Montgomery context of n, n > 1
+ */
+bool is_strong_lucas_prp64( const Montgomery64 &mg ) {
+	const uint64_t n = mg.modulus();
+	int64_t D = 0;
+	const int selfridge = lucas::selfridge( n, &D );
+	if ( selfridge <= 0 ) {
+		return ( selfridge < 0 ) ? is_prime( n ) : false;
+	}
+	// n + 1 = d * 2^s, ( n + 1 ) / 2 = ( n >> 1 ) + 1 does not overflow.
+	const uint64_t half = ( n >> 1 ) + 1;
+	const int s = 1 + utzcnt64( half );
+	return lucas::strong_test( mg, D, half >> ( s - 1 ), s );
+}
+
+bool is_strong_lucas_prp64( const uint64_t n ) {
+	if ( n < 2 ) {
+		return false;
+	}
+	if ( ( n & 1 ) == 0 ) {
+		return n == 2;
+	}
+	return is_strong_lucas_prp64( Montgomery64( n ) );
+}
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <type_traits>
+
+#include "mod_arith.h"
+#include "montgomery64.h"
+#include "sqrtmod64.h"
+
+// Lucas sequences U_k( P, Q ), V_k( P, Q ) modulo an odd n, and the strong Lucas probable prime test
+// ( Baillie, Wagstaff ) with Selfridge's parameters : the first D in 5, -7, 9, -11, ... with ( D / n ) = -1,
+// P = 1, Q = ( 1 - D ) / 4.
+// bpsw_is_prime() is a base 2 strong probable prime test followed by a strong Lucas test. No composite below 2^64
+// passes both ( Feitsma, Galway ), so it is deterministic for uint64_t, and no counterexample is known above.
+// The sequences run on Montgomery64 or MontgomeryN<N> : one template for every width.
+
+/**
+ * lucas_terms<Value>
+ * U_k, V_k and Q^k modulo n.
+ */
+template <typename Value>
+struct lucas_terms {
+	Value u;
+	Value v;
+	Value qk;
+};
+
+namespace lucas {
+
+inline int bit_length( const uint64_t k ) { return 64 - ulzcnt64( k ); }
+inline bool bit( const uint64_t k, const int i ) { return ( k >> i ) & 1; }
+template <size_t N>
+int bit_length( const uint_n<N> &k ) {
+	return k.bit_length();
+}
+template <size_t N>
+bool bit( const uint_n<N> &k, const int i ) {
+	return k.bit( i );
+}
+
+inline uint64_t residue( const uint64_t n, const uint64_t m ) { return n % m; }
+template <size_t N>
+uint64_t residue( const uint_n<N> &n, const uint64_t m ) {
+	return limbs::umod64( n, m );
+}
+
+inline bool at_most( const uint64_t n, const uint64_t a ) { return n <= a; }
+template <size_t N>
+bool at_most( const uint_n<N> &n, const uint64_t a ) {
+	return n.fits64() && n.limb[ 0 ] <= a;
+}
+
+/**
+ * from_int( const Ring &ring, int64_t x )
+ * @return x % n in Montgomery form
+ */
+inline uint64_t from_int( const Montgomery64 &ring, const int64_t x ) {
+	const uint64_t a = ring.to_mont( ( x < 0 ) ? 0 - static_cast<uint64_t>( x ) : static_cast<uint64_t>( x ) );
+	return ( x < 0 ) ? ring.sub( 0, a ) : a;
+}
+template <size_t N>
+uint_n<N> from_int( const MontgomeryN<N> &ring, const int64_t x ) {
+	const uint_n<N> a =
+	    ring.to_mont( uint_n<N>::from( ( x < 0 ) ? 0 - static_cast<uint64_t>( x ) : static_cast<uint64_t>( x ) ) );
+	return ( x < 0 ) ? ring.sub( uint_n<N>{}, a ) : a;
+}
+
+/**
+ * sequence( const Ring &ring, const Value &p, const Value &q, const Exp &k )
+ * Left-to-right binary : U_2k = U_k V_k, V_2k = V_k^2 - 2 Q^k,
+ * U_k+1 = ( P U_k + V_k ) / 2, V_k+1 = ( D U_k + P V_k ) / 2, D = P^2 - 4Q.
+ * @param ring Montgomery context of an odd n
+ * @param p P, Montgomery form
+ * @param q Q, Montgomery form
+ * @param k index
+ * @return U_k, V_k, Q^k in Montgomery form
+ */
+template <typename Ring, typename Value, typename Exp>
+lucas_terms<Value> sequence( const Ring &ring, const Value &p, const Value &q, const Exp &k ) {
+	const Value q2 = ring.add( q, q );
+	const Value d = ring.sub( ring.mul( p, p ), ring.add( q2, q2 ) );
+	Value u{};
+	Value v = ring.add( ring.one(), ring.one() );
+	Value qk = ring.one();
+	for ( int i = bit_length( k ) - 1; i >= 0; i-- ) {
+		u = ring.mul( u, v );
+		v = ring.sub( ring.mul( v, v ), ring.add( qk, qk ) );
+		qk = ring.mul( qk, qk );
+		if ( bit( k, i ) ) {
+			const Value u1 = ring.half( ring.add( ring.mul( p, u ), v ) );
+			v = ring.half( ring.add( ring.mul( d, u ), ring.mul( p, v ) ) );
+			u = u1;
+			qk = ring.mul( qk, q );
+		}
+	}
+	return lucas_terms<Value>{ u, v, qk };
+}
+
+/**
+ * selfridge( const Value &n, int64_t *d )
+ * @param n odd, n > 1
+ * @param d [out] the first D in 5, -7, 9, -11, ... with ( D / n ) = -1
+ * @return 1 : *d is set, 0 : n is composite ( gcd( D, n ) > 1 or a square ), -1 : n <= |D| is left to is_prime()
+ */
+template <typename Value>
+int selfridge( const Value &n, int64_t *d ) {
+	const uint64_t n_mod_4 = residue( n, 4 );
+	for ( int64_t D = 5, i = 0;; i++ ) {
+		const uint64_t a = static_cast<uint64_t>( ( D > 0 ) ? D : -D );
+		// ( D / n ) = ( -1 / n )^[ D < 0 ] ( a / n ), ( a / n ) = ( n / a ) unless a ≡ n ≡ 3 ( mod 4 ).
+		const uint64_t r = residue( n, a );
+		int j = jacobi64( r, a );
+		if ( ( a & 3 ) == 3 && n_mod_4 == 3 ) {
+			j = -j;
+		}
+		if ( D < 0 && n_mod_4 == 3 ) {
+			j = -j;
+		}
+		if ( j == -1 ) {
+			*d = D;
+			return 1;
+		}
+		if ( j == 0 ) {
+			// gcd( D, n ) > 1 : a proper factor unless n <= |D|.
+			return at_most( n, a ) ? -1 : 0;
+		}
+		// No D exists for a square : check once the first few have failed.
+		if ( i == 8 && is_square( n ) ) {
+			return 0;
+		}
+		D = ( D > 0 ) ? -( D + 2 ) : -D + 2;
+	}
+}
+
+/**
+ * strong_test( const Ring &ring, int64_t D, const Exp &d, int s )
+ * V_k, V_k+1 ladder with P = 1 : V_2k = V_k^2 - 2 Q^k, V_2k+1 = V_k V_k+1 - Q^k.
+ * n is a strong Lucas probable prime if U_d ≡ 0, i.e. 2 V_d+1 ≡ V_d as D is invertible, or V_( d 2^r ) ≡ 0 for
+ * some 0 <= r < s.
+ * @param ring Montgomery context of n
+ * @param D Selfridge's D
+ * @param d odd part of n + 1
+ * @param s n + 1 = d * 2^s
+ */
+template <typename Ring, typename Exp>
+bool strong_test( const Ring &ring, const int64_t D, const Exp &d, const int s ) {
+	using Value = std::decay_t<decltype( ring.one() )>;
+	const Value q = from_int( ring, ( 1 - D ) / 4 );
+	const Value zero{};
+	Value v0 = ring.add( ring.one(), ring.one() );
+	Value v1 = ring.one();
+	Value qk = ring.one();
+	for ( int i = bit_length( d ) - 1; i >= 0; i-- ) {
+		const Value odd = ring.sub( ring.mul( v0, v1 ), qk );
+		if ( bit( d, i ) ) {
+			const Value qk1 = ring.mul( qk, q );
+			v1 = ring.sub( ring.mul( v1, v1 ), ring.add( qk1, qk1 ) );
+			v0 = odd;
+			qk = ring.mul( qk, qk1 );
+		} else {
+			v0 = ring.sub( ring.mul( v0, v0 ), ring.add( qk, qk ) );
+			v1 = odd;
+			qk = ring.mul( qk, qk );
+		}
+	}
+	if ( v0 == zero || ring.add( v1, v1 ) == v0 ) {
+		return true;
+	}
+	for ( int r = 1; r < s; r++ ) {
+		v0 = ring.sub( ring.mul( v0, v0 ), ring.add( qk, qk ) );
+		if ( v0 == zero ) {
+			return true;
+		}
+		qk = ring.mul( qk, qk );
+	}
+	return false;
+}
+
+}  // namespace lucas
+
+/**
+ * lucas_uv64( int64_t p, int64_t q, uint64_t k, uint64_t n )
+ * @param p P
+ * @param q Q
+ * @param k index
+ * @param n odd modular
+ * @return U_k( P, Q ) % n, V_k( P, Q ) % n, Q^k % n
+ */
+lucas_terms<uint64_t> lucas_uv64( int64_t p, int64_t q, uint64_t k, uint64_t n );
+
+/**
+ * is_strong_lucas_prp64( uint64_t n )
+ * @return true if n is prime or a strong Lucas pseudoprime ( Selfridge's parameters )
+ */
+bool is_strong_lucas_prp64( uint64_t n );
+bool is_strong_lucas_prp64( const Montgomery64 &mg );
+
+/**
+ * lucas_uv( int64_t p, int64_t q, const uint_n<N> &k, const uint_n<N> &n )
+ * lucas_uv64() for N limbs.
+ */
+template <size_t N>
+lucas_terms<uint_n<N>> lucas_uv( const int64_t p, const int64_t q, const uint_n<N> &k, const uint_n<N> &n ) {
+	const MontgomeryN<N> mg( n );
+	const lucas_terms<uint_n<N>> t = lucas::sequence( mg, lucas::from_int( mg, p ), lucas::from_int( mg, q ), k );
+	return lucas_terms<uint_n<N>>{ mg.from_mont( t.u ), mg.from_mont( t.v ), mg.from_mont( t.qk ) };
+}
+
+/**
+ * is_strong_lucas_prp( const MontgomeryN<N> &mg )
+ * @param mg Montgomery context of n, n >= 2^64
+ */
+template <size_t N>
+bool is_strong_lucas_prp( const MontgomeryN<N> &mg ) {
+	const uint_n<N> &n = mg.modulus();
+	int64_t D = 0;
+	const int selfridge = lucas::selfridge( n, &D );
+	if ( selfridge <= 0 ) {
+		return false;
+	}
+	// n + 1 = d * 2^s, ( n + 1 ) / 2 = ( n >> 1 ) + 1 does not overflow.
+	uint_n<N> d = n;
+	limbs::shr1( &d, 0 );
+	limbs::add( &d, d, uint_n<N>::from( 1 ) );
+	int s = 1;
+	while ( !d.bit( 0 ) ) {
+		limbs::shr1( &d, 0 );
+		s++;
+	}
+	return lucas::strong_test( mg, D, d, s );
+}
+
+/**
+ * is_strong_lucas_prp( const uint_n<N> &n )
+ * is_strong_lucas_prp64() for N limbs.
+ */
+template <size_t N>
+bool is_strong_lucas_prp( const uint_n<N> &n ) {
+	if ( n.fits64() ) {
+		return is_strong_lucas_prp64( n.limb[ 0 ] );
+	}
+	if ( ( n.limb[ 0 ] & 1 ) == 0 ) {
+		return false;
+	}
+	return is_strong_lucas_prp( MontgomeryN<N>( n ) );
+}
+
+/**
+ * bpsw_is_prime( const uint_n<N> &n )
+ * Below 2^64 : bpsw_is_prime( uint64_t ). Above : trial division by the primes below 43, then BPSW, a probable prime.
+ * @return true if n is ( probably ) prime
+ */
+template <size_t N>
+bool bpsw_is_prime( const uint_n<N> &n ) {
+	if ( n.fits64() ) {
+		return bpsw_is_prime( n.limb[ 0 ] );
+	}
+	if ( limbs::has_small_factor( n ) ) {
+		return false;
+	}
+	uint_n<N> d;
+	limbs::sub( &d, n, uint_n<N>::from( 1 ) );
+	int s = 0;
+	while ( !d.bit( 0 ) ) {
+		limbs::shr1( &d, 0 );
+		s++;
+	}
+	const MontgomeryN<N> mg( n );
+	return is_strong_probable_prime( mg, d, s, 2 ) && is_strong_lucas_prp( mg );
+}
@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 
+#include "range_scanner.h"
 #include "uint64_mod_operation.h"
 
 int main() {
@@ -102,4 +103,15 @@ int main() {
 		}
 	}
 	printf( "----\n" );
+
+	// Parallel scan : is_prime() / is_square() on every number of a range.
+	const uint64_t hi = 18446744073709551557U;
+	const uint64_t lo = hi - 10000000;
+	range_scan_options options;
+	printf( "primes  in [ %llu, %llu ] : %llu\n", static_cast<unsigned long long>( lo ),
+	        static_cast<unsigned long long>( hi ),
+	        static_cast<unsigned long long>( parallel_count( lo, hi, is_prime, options ) ) );
+	printf( "squares in [ 0, %llu ] : %llu\n", 100000000ULL,
+	        static_cast<unsigned long long>( parallel_count( 0, 100000000, is_square, options ) ) );
+	printf( "----\n" );
 }
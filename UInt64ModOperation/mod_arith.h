@@ -0,0 +1,613 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "uint128_arith.h"
+#include "uint64_mod_operation.h"
+
+// Fixed-width multi-precision modular arithmetic : moduli of N 64-bit limbs, N fixed at compile time.
+//   ModArith<1>  : the uint64_t functions, uaddmod64(), umulmod64(), powmod64(), umodinv64(), is_prime()
+//   ModArith<N>  : odd moduli below 2^( 64 N ), Montgomery multiplication ( CIOS, Koc et al. )
+// Numbers live on the stack, the limb loops are unrolled at compile time, and nothing is allocated.
+
+/**
+ * uint_n<N>
+ * Unsigned integer of N 64-bit limbs, least significant limb first.
+ */
+template <size_t N>
+struct uint_n {
+	static_assert( N >= 1, "uint_n needs at least one limb." );
+
+	uint64_t limb[ N ];
+
+	static constexpr uint_n from( const uint64_t a ) {
+		uint_n r{};
+		r.limb[ 0 ] = a;
+		return r;
+	}
+
+	bool is_zero() const {
+		uint64_t x = 0;
+		for ( size_t i = 0; i < N; i++ ) {
+			x |= limb[ i ];
+		}
+		return x == 0;
+	}
+
+	/**
+	 * fits64()
+	 * @return true if every limb above the first is 0
+	 */
+	bool fits64() const {
+		uint64_t x = 0;
+		for ( size_t i = 1; i < N; i++ ) {
+			x |= limb[ i ];
+		}
+		return x == 0;
+	}
+
+	bool bit( const int i ) const { return ( limb[ i >> 6 ] >> ( i & 63 ) ) & 1; }
+
+	/**
+	 * bit_length()
+	 * @return number of significant bits, 0 for 0
+	 */
+	int bit_length() const {
+		for ( size_t i = N; i-- > 0; ) {
+			if ( limb[ i ] != 0 ) {
+				return static_cast<int>( 64 * i ) + 64 - ulzcnt64( limb[ i ] );
+			}
+		}
+		return 0;
+	}
+
+	friend bool operator==( const uint_n &a, const uint_n &b ) {
+		uint64_t x = 0;
+		for ( size_t i = 0; i < N; i++ ) {
+			x |= a.limb[ i ] ^ b.limb[ i ];
+		}
+		return x == 0;
+	}
+	friend bool operator!=( const uint_n &a, const uint_n &b ) { return !( a == b ); }
+	friend bool operator<( const uint_n &a, const uint_n &b ) {
+		for ( size_t i = N; i-- > 0; ) {
+			if ( a.limb[ i ] != b.limb[ i ] ) {
+				return a.limb[ i ] < b.limb[ i ];
+			}
+		}
+		return false;
+	}
+};
+
+namespace limbs {
+
+template <typename F, size_t... I>
+inline void unroll( F &&f, std::index_sequence<I...> ) {
+	( f( std::integral_constant<size_t, I>{} ), ... );
+}
+
+/**
+ * unroll<N>( F f )
+ * f( 0 ), f( 1 ), ..., f( N - 1 ), expanded at compile time. The index is a std::integral_constant.
+ */
+template <size_t N, typename F>
+inline void unroll( F &&f ) {
+	unroll( f, std::make_index_sequence<N>{} );
+}
+
+/**
+ * mac( uint64_t a, uint64_t b, uint64_t c, uint64_t carry_in, uint64_t *carry_out )
+ * a + b * c + carry_in < 2^128
+ * @return low word, high word in *carry_out
+ */
+inline uint64_t mac( const uint64_t a, const uint64_t b, const uint64_t c, const uint64_t carry_in,
+                     uint64_t *carry_out ) {
+#if defined( UINT64MOD_BACKEND_INT128 )
+	// One expression : mul, add, adc without the flags going through memory.
+	const unsigned __int128 t = static_cast<unsigned __int128>( b ) * c + a + carry_in;
+	*carry_out = static_cast<uint64_t>( t >> 64 );
+	return static_cast<uint64_t>( t );
+#else
+	uint64_t hi = 0, c1 = 0, c2 = 0;
+	uint64_t lo = umul128( b, c, &hi );
+	lo = uaddc64( lo, a, 0, &c1 );
+	lo = uaddc64( lo, carry_in, 0, &c2 );
+	*carry_out = hi + c1 + c2;
+	return lo;
+#endif
+}
+
+/**
+ * add( uint_n<N> *r, const uint_n<N> &a, const uint_n<N> &b )
+ * *r = ( a + b ) % 2^( 64 N )
+ * @return carry
+ */
+template <size_t N>
+inline uint64_t add( uint_n<N> *r, const uint_n<N> &a, const uint_n<N> &b ) {
+	uint64_t carry = 0;
+	unroll<N>( [&]( const size_t i ) { r->limb[ i ] = uaddc64( a.limb[ i ], b.limb[ i ], carry, &carry ); } );
+	return carry;
+}
+
+/**
+ * sub( uint_n<N> *r, const uint_n<N> &a, const uint_n<N> &b )
+ * *r = ( a - b ) % 2^( 64 N )
+ * @return borrow
+ */
+template <size_t N>
+inline uint64_t sub( uint_n<N> *r, const uint_n<N> &a, const uint_n<N> &b ) {
+	uint64_t borrow = 0;
+	unroll<N>( [&]( const size_t i ) { r->limb[ i ] = usubb64( a.limb[ i ], b.limb[ i ], borrow, &borrow ); } );
+	return borrow;
+}
+
+/**
+ * shr1( uint_n<N> *a, uint64_t top )
+ * *a = ( top * 2^( 64 N ) + *a ) / 2
+ */
+template <size_t N>
+inline void shr1( uint_n<N> *a, const uint64_t top ) {
+	unroll<N>( [&]( auto i ) {
+		if constexpr ( i + 1 < N ) {
+			a->limb[ i ] = ( a->limb[ i ] >> 1 ) | ( a->limb[ i + 1 ] << 63 );
+		} else {
+			a->limb[ i ] = ( a->limb[ i ] >> 1 ) | ( top << 63 );
+		}
+	} );
+}
+
+/**
+ * umod64( const uint_n<N> &a, uint64_t m )
+ * @return a % m
+ */
+template <size_t N>
+inline uint64_t umod64( const uint_n<N> &a, const uint64_t m ) {
+	if ( m == 0 ) {
+		throw std::overflow_error( "Divide by Zero." );
+	}
+	// rem < m : every quotient fits in 64 bits.
+	uint64_t rem = 0;
+	for ( size_t i = N; i-- > 0; ) {
+		udiv128( rem, a.limb[ i ], m, &rem );
+	}
+	return rem;
+}
+
+}  // namespace limbs
+
+/**
+ * umodinv( uint_n<N> a, const uint_n<N> &mod )
+ * Binary extended GCD.
+ * @param a a < mod
+ * @param mod odd modular
+ * @return a^-1 % mod
+ */
+template <size_t N>
+uint_n<N> umodinv( uint_n<N> a, const uint_n<N> &mod ) {
+	if ( ( mod.limb[ 0 ] & 1 ) == 0 ) {
+		throw std::invalid_argument( "Modulus must be odd." );
+	}
+	// a ≡ u * A, b ≡ v * A ( mod mod ), b is odd.
+	uint_n<N> b = mod;
+	uint_n<N> u = uint_n<N>::from( 1 );
+	uint_n<N> v{};
+	while ( !a.is_zero() ) {
+		if ( a.limb[ 0 ] & 1 ) {
+			if ( a < b ) {
+				std::swap( a, b );
+				std::swap( u, v );
+			}
+			limbs::sub( &a, a, b );
+			if ( limbs::sub( &u, u, v ) ) {
+				limbs::add( &u, u, mod );
+			}
+		}
+		// a is even : a /= 2, u /= 2 ( mod mod )
+		limbs::shr1( &a, 0 );
+		const uint64_t carry = ( u.limb[ 0 ] & 1 ) ? limbs::add( &u, u, mod ) : 0;
+		limbs::shr1( &u, carry );
+	}
+	if ( b != uint_n<N>::from( 1 ) ) {
+		throw std::overflow_error( "The inverse does not exist." );
+	}
+	return v;
+}
+
+/**
+ * MontgomeryN<N>
+ * Modular arithmetic context for a fixed odd modulus of N limbs.
+ * Values are kept in Montgomery form ( a * R % mod, R = 2^( 64 N ) ).
+ */
+template <size_t N>
+class MontgomeryN {
+   public:
+	using value_type = uint_n<N>;
+
+	/**
+	 * MontgomeryN( const uint_n<N> &mod )
+	 * @param mod odd modular
+	 */
+	explicit MontgomeryN( const value_type &mod ) : mod_( mod ) {
+		if ( ( mod.limb[ 0 ] & 1 ) == 0 ) {
+			throw std::invalid_argument( "Modulus must be odd." );
+		}
+		// -mod^-1 % 2^64, Newton's method from mod * mod ≡ 1 ( mod 8 ).
+		uint64_t inv = mod.limb[ 0 ];
+		for ( int i = 0; i < 5; i++ ) {
+			inv *= 2 - mod.limb[ 0 ] * inv;
+		}
+		neg_inv_ = 0 - inv;
+
+		// R % mod and R^2 % mod by doubling 1 : 2 * 64 N steps of shift and conditional subtract.
+		value_type x = value_type::from( ( mod_ == value_type::from( 1 ) ) ? 0 : 1 );
+		for ( size_t i = 0; i < 2 * 64 * N; i++ ) {
+			const uint64_t carry = limbs::add( &x, x, x );
+			if ( carry || !( x < mod_ ) ) {
+				limbs::sub( &x, x, mod_ );
+			}
+			if ( i + 1 == 64 * N ) {
+				r1_ = x;
+			}
+		}
+		r2_ = x;
+	}
+
+	const value_type &modulus() const { return mod_; }
+
+	/**
+	 * one()
+	 * @return 1 in Montgomery form
+	 */
+	const value_type &one() const { return r1_; }
+
+	/**
+	 * to_mont( const uint_n<N> &a )
+	 * @param a any value below 2^( 64 N )
+	 * @return a * R % mod
+	 */
+	value_type to_mont( const value_type &a ) const { return mul( a, r2_ ); }
+
+	/**
+	 * from_mont( const uint_n<N> &a )
+	 * @param a Montgomery form
+	 * @return a * R^-1 % mod
+	 */
+	value_type from_mont( const value_type &a ) const { return mul( a, value_type::from( 1 ) ); }
+
+	/**
+	 * mul( const uint_n<N> &a, const uint_n<N> &b )
+	 * Coarsely integrated operand scanning : one limb of b is multiplied in, then one limb is reduced.
+	 * @param a a * b < mod * R, e.g. a, b < mod
+	 * @param b
+	 * @return a * b * R^-1 % mod
+	 */
+	value_type mul( const value_type &a, const value_type &b ) const {
+		uint64_t t[ N + 2 ] = {};
+		for ( size_t i = 0; i < N; i++ ) {
+			uint64_t c = 0, carry = 0;
+			limbs::unroll<N>( [&]( const size_t j ) { t[ j ] = limbs::mac( t[ j ], a.limb[ j ], b.limb[ i ], c, &c ); } );
+			t[ N ] = uaddc64( t[ N ], c, 0, &carry );
+			t[ N + 1 ] = carry;
+
+			// t + m * mod ≡ 0 ( mod 2^64 ) : shift down one limb.
+			const uint64_t m = t[ 0 ] * neg_inv_;
+			limbs::mac( t[ 0 ], m, mod_.limb[ 0 ], 0, &c );
+			limbs::unroll<N - 1>(
+			    [&]( const size_t j ) { t[ j ] = limbs::mac( t[ j + 1 ], m, mod_.limb[ j + 1 ], c, &c ); } );
+			t[ N - 1 ] = uaddc64( t[ N ], c, 0, &carry );
+			t[ N ] = t[ N + 1 ] + carry;
+		}
+		// t < 2 mod
+		value_type r;
+		limbs::unroll<N>( [&]( const size_t j ) { r.limb[ j ] = t[ j ]; } );
+		if ( t[ N ] != 0 || !( r < mod_ ) ) {
+			limbs::sub( &r, r, mod_ );
+		}
+		return r;
+	}
+
+	value_type add( const value_type &a, const value_type &b ) const {
+		value_type s;
+		const uint64_t carry = limbs::add( &s, a, b );
+		if ( carry || !( s < mod_ ) ) {
+			limbs::sub( &s, s, mod_ );
+		}
+		return s;
+	}
+
+	value_type sub( const value_type &a, const value_type &b ) const {
+		value_type d;
+		if ( limbs::sub( &d, a, b ) ) {
+			limbs::add( &d, d, mod_ );
+		}
+		return d;
+	}
+
+	/**
+	 * half( const uint_n<N> &a )
+	 * @return a / 2 % mod, in either form
+	 */
+	value_type half( value_type a ) const {
+		const uint64_t carry = ( a.limb[ 0 ] & 1 ) ? limbs::add( &a, a, mod_ ) : 0;
+		limbs::shr1( &a, carry );
+		return a;
+	}
+
+	/**
+	 * pow( const uint_n<N> &a, const uint_n<N> &e )
+	 * Left-to-right 4-bit fixed window.
+	 * @param a base, Montgomery form
+	 * @param e exponent
+	 * @return a ** e in Montgomery form, 0 ** 0 = one()
+	 */
+	value_type pow( const value_type &a, const value_type &e ) const {
+		const int bits = e.bit_length();
+		if ( bits == 0 ) {
+			return r1_;
+		}
+		// table[ w ] = a^w
+		value_type table[ 16 ];
+		table[ 0 ] = r1_;
+		table[ 1 ] = a;
+		for ( int w = 2; w < 16; w++ ) {
+			table[ w ] = mul( table[ w - 1 ], a );
+		}
+		const int windows = ( bits + 3 ) / 4;
+
+		value_type ans = r1_;
+		for ( int i = 4 * ( windows - 1 ); i >= 0; i -= 4 ) {
+			if ( i != 4 * ( windows - 1 ) ) {
+				for ( int k = 0; k < 4; k++ ) {
+					ans = mul( ans, ans );
+				}
+			}
+			// A window never straddles two limbs : i is a multiple of 4.
+			const uint64_t w = ( e.limb[ i >> 6 ] >> ( i & 63 ) ) & 15;
+			ans = ( i == 4 * ( windows - 1 ) ) ? table[ w ] : ( w != 0 ) ? mul( ans, table[ w ] ) : ans;
+		}
+		return ans;
+	}
+
+	value_type pow( const value_type &a, const uint64_t e ) const { return pow( a, value_type::from( e ) ); }
+
+	/**
+	 * inverse( const uint_n<N> &a )
+	 * @param a Montgomery form
+	 * @return a^-1 in Montgomery form
+	 */
+	value_type inverse( const value_type &a ) const { return to_mont( umodinv( from_mont( a ), mod_ ) ); }
+
+   private:
+	value_type mod_;
+	uint64_t neg_inv_;  // -mod^-1 % 2^64
+	value_type r1_;     // R % mod
+	value_type r2_;     // R^2 % mod
+};
+
+/**
+ * ModArith<N>
+ * add / sub / mul / pow / inv on ordinary residues modulo a fixed odd modulus of N limbs.
+ * Operands must be reduced ( a, b < mod ), reduce() takes any value. For repeated products, work in Montgomery form
+ * with montgomery() instead : mul() here is two Montgomery multiplications.
+ */
+template <size_t N>
+class ModArith {
+   public:
+	using value_type = uint_n<N>;
+
+	/**
+	 * ModArith( const uint_n<N> &mod )
+	 * @param mod odd modular
+	 */
+	explicit ModArith( const value_type &mod ) : mg_( mod ) {}
+
+	const value_type &modulus() const { return mg_.modulus(); }
+
+	const MontgomeryN<N> &montgomery() const { return mg_; }
+
+	/**
+	 * reduce( const uint_n<N> &a )
+	 * @return a % mod
+	 */
+	value_type reduce( const value_type &a ) const { return mg_.from_mont( mg_.to_mont( a ) ); }
+
+	value_type add( const value_type &a, const value_type &b ) const { return mg_.add( a, b ); }
+
+	value_type sub( const value_type &a, const value_type &b ) const { return mg_.sub( a, b ); }
+
+	/**
+	 * mul( const uint_n<N> &a, const uint_n<N> &b )
+	 * @return a * b % mod : ( a * R ) * b * R^-1
+	 */
+	value_type mul( const value_type &a, const value_type &b ) const { return mg_.mul( mg_.to_mont( a ), b ); }
+
+	/**
+	 * pow( const uint_n<N> &a, const uint_n<N> &e )
+	 * @return a ** e % mod, 0 ** 0 = 1 % mod
+	 */
+	value_type pow( const value_type &a, const value_type &e ) const {
+		return mg_.from_mont( mg_.pow( mg_.to_mont( a ), e ) );
+	}
+
+	/**
+	 * inv( const uint_n<N> &a )
+	 * @return a^-1 % mod
+	 */
+	value_type inv( const value_type &a ) const { return umodinv( a, mg_.modulus() ); }
+
+   private:
+	MontgomeryN<N> mg_;
+};
+
+/**
+ * ModArith<1>
+ * The uint64_t functions : any modulus, even or odd, operands need not be reduced.
+ */
+template <>
+class ModArith<1> {
+   public:
+	using value_type = uint64_t;
+
+	explicit ModArith( const uint64_t mod ) : mod_( mod ) {
+		if ( mod == 0 ) {
+			throw std::overflow_error( "Divide by Zero." );
+		}
+	}
+
+	uint64_t modulus() const { return mod_; }
+
+	uint64_t reduce( const uint64_t a ) const { return a % mod_; }
+
+	uint64_t add( const uint64_t a, const uint64_t b ) const { return uaddmod64( a, b, mod_ ); }
+
+	uint64_t sub( const uint64_t a, const uint64_t b ) const { return usubmod64( a, b, mod_ ); }
+
+	uint64_t mul( const uint64_t a, const uint64_t b ) const { return umulmod64( a, b, mod_ ); }
+
+	uint64_t pow( const uint64_t a, const uint64_t e ) const { return powmod64( a, e, mod_ ); }
+
+	uint64_t inv( const uint64_t a ) const { return umodinv64( a, mod_ ); }
+
+   private:
+	uint64_t mod_;
+};
+
+/**
+ * isqrt( const uint_n<N> &x )
+ * Digit-by-digit square root, two bits per step.
+ * @return floor( sqrt( x ) )
+ */
+template <size_t N>
+uint_n<N> isqrt( uint_n<N> x ) {
+	uint_n<N> root{};
+	const int bits = x.bit_length();
+	if ( bits == 0 ) {
+		return root;
+	}
+	// bit = the highest power of 4 <= x
+	uint_n<N> bit{};
+	const int top = ( bits - 1 ) & ~1;
+	bit.limb[ top >> 6 ] = 1ULL << ( top & 63 );
+	while ( !bit.is_zero() ) {
+		uint_n<N> t;
+		limbs::add( &t, root, bit );
+		limbs::shr1( &root, 0 );
+		if ( !( x < t ) ) {
+			limbs::sub( &x, x, t );
+			limbs::add( &root, root, bit );
+		}
+		limbs::shr1( &bit, 0 );
+		limbs::shr1( &bit, 0 );
+	}
+	return root;
+}
+
+/**
+ * is_square( const uint_n<N> &x )
+ * @return true if x is a perfect square
+ */
+template <size_t N>
+bool is_square( const uint_n<N> &x ) {
+	if ( x.fits64() ) {
+		return is_square( x.limb[ 0 ] );
+	}
+	// Squares are 0, 1, 4 or 9 modulo 16.
+	if ( ( ( 0x0213 >> ( x.limb[ 0 ] & 15 ) ) & 1 ) == 0 ) {
+		return false;
+	}
+	const uint_n<N> root = isqrt( x );
+	uint_n<N> square{};
+	for ( size_t i = 0; i < N; i++ ) {
+		uint64_t c = 0;
+		for ( size_t j = 0; i + j < N; j++ ) {
+			square.limb[ i + j ] = limbs::mac( square.limb[ i + j ], root.limb[ i ], root.limb[ j ], c, &c );
+		}
+	}
+	return square == x;
+}
+
+namespace limbs {
+
+/**
+ * has_small_factor( const uint_n<N> &n )
+ * @return true if a prime below 43 divides n
+ */
+template <size_t N>
+bool has_small_factor( const uint_n<N> &n ) {
+	if ( ( n.limb[ 0 ] & 1 ) == 0 ) {
+		return true;
+	}
+	static const uint64_t small_primes[] = { 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41 };
+	for ( auto &&p : small_primes ) {
+		if ( umod64( n, p ) == 0 ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+}  // namespace limbs
+
+/**
+ * is_strong_probable_prime( const MontgomeryN<N> &mg, const uint_n<N> &d, int s, uint64_t base )
+ * @param mg Montgomery context of n
+ * @param d odd part of n - 1
+ * @param s n - 1 = d * 2^s
+ * @param base witness, base < n
+ * @return false if base proves that n is composite
+ */
+template <size_t N>
+bool is_strong_probable_prime( const MontgomeryN<N> &mg, const uint_n<N> &d, const int s, const uint64_t base ) {
+	const uint_n<N> minus_one = mg.sub( uint_n<N>{}, mg.one() );
+	uint_n<N> x = mg.pow( mg.to_mont( uint_n<N>::from( base ) ), d );
+	if ( x == mg.one() || x == minus_one ) {
+		return true;
+	}
+	for ( int i = 1; i < s; i++ ) {
+		x = mg.mul( x, x );
+		if ( x == minus_one ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * is_prime( const uint_n<N> &n )
+ * Below 2^64 : is_prime( uint64_t ), deterministic.
+ * Above : trial division by the primes below 43, then Miller-Rabin to the 13 prime bases 2 .. 41. Deterministic below
+ * 3.3 * 10^24 ( Sorenson, Webster ), a probable prime above.
+ * @param n
+ * @return true if n is ( probably ) prime
+ */
+template <size_t N>
+bool is_prime( const uint_n<N> &n ) {
+	if ( n.fits64() ) {
+		return is_prime( n.limb[ 0 ] );
+	}
+	if ( limbs::has_small_factor( n ) ) {
+		return false;
+	}
+
+	// n - 1 = d * 2^s
+	uint_n<N> d;
+	limbs::sub( &d, n, uint_n<N>::from( 1 ) );
+	int s = 0;
+	while ( !d.bit( 0 ) ) {
+		limbs::shr1( &d, 0 );
+		s++;
+	}
+	const MontgomeryN<N> mg( n );
+	static const uint64_t bases[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41 };
+	for ( auto &&base : bases ) {
+		if ( !is_strong_probable_prime( mg, d, s, base ) ) {
+			return false;
+		}
+	}
+	return true;
+}
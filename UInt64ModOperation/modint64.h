@@ -0,0 +1,247 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <stdexcept>
+
+#include "uint128_arith.h"
+
+// Modular arithmetic for a modulus fixed at compile time.
+// The reduction is selected from the shape of the modulus, and every constant is computed at compile time :
+//   mod < 2^32              : 64-bit % by a constant ( the compiler emits a multiply and shift )
+//   mod = 2^k - 1, k > 32   : Mersenne fold
+//   mod = 2^64 - c, c < 2^32 : pseudo-Mersenne fold
+//   other odd mod          : Montgomery ( values are kept in Montgomery form )
+//   other even mod         : division by an invariant integer ( Moller-Granlund 2-by-1 with a precomputed reciprocal )
+// uaddmod64(), umulmod64(), ... remain the generic functions for a modulus known only at runtime.
+
+enum class modint_reduction {
+	native,
+	mersenne,
+	pseudo_mersenne,
+	montgomery,
+	barrett,
+};
+
+/**
+ * ModInt<Mod>
+ * An element of Z / Mod Z. Every operation is constexpr.
+ */
+template <uint64_t Mod>
+class ModInt {
+	static_assert( Mod >= 2, "Modulus must be at least 2." );
+
+   public:
+	static constexpr modint_reduction reduction = [] {
+		if ( Mod < 0x1'0000'0000ULL ) {
+			return modint_reduction::native;
+		}
+		if ( ( Mod & ( Mod + 1 ) ) == 0 && Mod + 1 != 0 ) {
+			return modint_reduction::mersenne;
+		}
+		if ( 0 - Mod < 0x1'0000'0000ULL ) {
+			return modint_reduction::pseudo_mersenne;
+		}
+		return ( Mod & 1 ) ? modint_reduction::montgomery : modint_reduction::barrett;
+	}();
+
+	constexpr ModInt() : v_( 0 ) {}
+	constexpr ModInt( const uint64_t a ) : v_( encode( a % Mod ) ) {}
+
+	static constexpr uint64_t modulus() { return Mod; }
+
+	/**
+	 * val()
+	 * @return the representative in [ 0, Mod )
+	 */
+	constexpr uint64_t val() const { return decode( v_ ); }
+
+	constexpr ModInt &operator+=( const ModInt &b ) {
+		const uint64_t s = v_ + b.v_;
+		// s < v_ : v_ + b.v_ overflowed.
+		v_ = ( s < v_ || s >= Mod ) ? s - Mod : s;
+		return *this;
+	}
+	constexpr ModInt &operator-=( const ModInt &b ) {
+		v_ = ( v_ < b.v_ ) ? v_ - b.v_ + Mod : v_ - b.v_;
+		return *this;
+	}
+	constexpr ModInt &operator*=( const ModInt &b ) {
+		if constexpr ( reduction == modint_reduction::native ) {
+			v_ = v_ * b.v_ % Mod;
+		} else {
+			uint64_t hi = 0;
+			const uint64_t lo = umul128( v_, b.v_, &hi );
+			v_ = reduce( hi, lo );
+		}
+		return *this;
+	}
+	constexpr ModInt operator-() const { return ModInt() - *this; }
+
+	friend constexpr ModInt operator+( ModInt a, const ModInt &b ) { return a += b; }
+	friend constexpr ModInt operator-( ModInt a, const ModInt &b ) { return a -= b; }
+	friend constexpr ModInt operator*( ModInt a, const ModInt &b ) { return a *= b; }
+	friend constexpr bool operator==( const ModInt &a, const ModInt &b ) { return a.v_ == b.v_; }
+	friend constexpr bool operator!=( const ModInt &a, const ModInt &b ) { return a.v_ != b.v_; }
+
+	/**
+	 * pow( uint64_t e )
+	 * @param e exponent
+	 * @return this ** e, 0 ** 0 = 1
+	 */
+	constexpr ModInt pow( uint64_t e ) const {
+		ModInt ans( 1 );
+		ModInt a = *this;
+		while ( e ) {
+			if ( e & 1 ) {
+				ans *= a;
+			}
+			e >>= 1;
+			if ( e == 0 ) {
+				break;
+			}
+			a *= a;
+		}
+		return ans;
+	}
+
+	/**
+	 * inv()
+	 * Same semantics as umodinv64().
+	 * @return this^-1
+	 */
+	constexpr ModInt inv() const {
+		// Iterative extended Euclid on ( Mod, a ), coefficients of a kept as magnitudes with alternating signs.
+		uint64_t r0 = Mod, r1 = val();
+		uint64_t t0 = 0, t1 = 1;
+		bool positive = false;
+		while ( r1 != 0 ) {
+			const uint64_t q = r0 / r1;
+			const uint64_t r = r0 - q * r1;
+			r0 = r1;
+			r1 = r;
+			const uint64_t t = t0 + q * t1;
+			t0 = t1;
+			t1 = t;
+			positive = !positive;
+		}
+		if ( r0 != 1 ) {
+			throw std::overflow_error( "The inverse does not exist." );
+		}
+		// t0 is the coefficient of a with sign ( -1 )^( steps + 1 ).
+		return ModInt( positive ? t0 : Mod - t0 );
+	}
+
+   private:
+	// bit length of Mod. Mersenne : Mod = 2^mod_bits - 1
+	static constexpr int mod_bits = [] {
+		int k = 0;
+		while ( k < 64 && ( Mod >> k ) != 0 ) {
+			k++;
+		}
+		return k;
+	}();
+
+	// Montgomery : Mod^-1 % 2^64, R % Mod, R^2 % Mod
+	static constexpr uint64_t mont_inv = [] {
+		uint64_t inv = Mod;
+		for ( int i = 0; i < 5; i++ ) {
+			inv *= 2 - Mod * inv;
+		}
+		return inv;
+	}();
+	static constexpr uint64_t mont_r1 = ( 0 - Mod ) % Mod;
+	static constexpr uint64_t mont_r2 = [] {
+		uint64_t r = mont_r1;
+		for ( int i = 0; i < 64; i++ ) {
+			r = ( r >= Mod - r ) ? r - ( Mod - r ) : r + r;
+		}
+		return r;
+	}();
+
+	// Division by an invariant integer : d = Mod << shift, reciprocal = floor( ( 2^128 - 1 ) / d ) - 2^64
+	static constexpr int div_shift = 64 - mod_bits;
+	static constexpr uint64_t div_norm = Mod << div_shift;
+	static constexpr uint64_t div_reciprocal = [] {
+		// Restoring division of ( ~d ) * 2^64 + ( 2^64 - 1 ) by d, one bit at a time.
+		uint64_t rem = ~div_norm;
+		uint64_t q = 0;
+		for ( int i = 63; i >= 0; i-- ) {
+			const bool carry = ( rem >> 63 ) != 0;
+			rem = ( rem << 1 ) | 1;
+			q <<= 1;
+			if ( carry || rem >= div_norm ) {
+				rem -= div_norm;
+				q |= 1;
+			}
+		}
+		return q;
+	}();
+
+	static constexpr uint64_t encode( const uint64_t a ) {
+		if constexpr ( reduction == modint_reduction::montgomery ) {
+			uint64_t hi = 0;
+			const uint64_t lo = umul128( a, mont_r2, &hi );
+			return reduce( hi, lo );
+		} else {
+			return a;
+		}
+	}
+
+	static constexpr uint64_t decode( const uint64_t a ) {
+		if constexpr ( reduction == modint_reduction::montgomery ) {
+			return reduce( 0, a );
+		} else {
+			return a;
+		}
+	}
+
+	/**
+	 * reduce( uint64_t hi, uint64_t lo )
+	 * @return ( hi * 2^64 + lo ) % Mod ( Montgomery : * R^-1 ), requires hi * 2^64 + lo < Mod^2
+	 */
+	static constexpr uint64_t reduce( const uint64_t hi, const uint64_t lo ) {
+		if constexpr ( reduction == modint_reduction::native ) {
+			// hi == 0
+			return lo % Mod;
+		} else if constexpr ( reduction == modint_reduction::mersenne ) {
+			// 2^k ≡ 1 : x ≡ ( x >> k ) + ( x & Mod ), and x >> k < Mod.
+			const uint64_t s = ( ( hi << ( 64 - mod_bits ) ) | ( lo >> mod_bits ) ) + ( lo & Mod );
+			return ( s >= Mod ) ? s - Mod : s;
+		} else if constexpr ( reduction == modint_reduction::pseudo_mersenne ) {
+			// 2^64 ≡ c : x ≡ hi * c + lo. Fold twice, the second high word is at most c.
+			constexpr uint64_t c = 0 - Mod;
+			uint64_t h = 0;
+			uint64_t s = umul128( hi, c, &h );
+			s += lo;
+			h += ( s < lo ) ? 1 : 0;
+			const uint64_t t = s + h * c;
+			// t < s : the sum wrapped, t < c^2 and 2^64 ≡ c.
+			s = ( t < s ) ? t + c : t;
+			return ( s >= Mod ) ? s - Mod : s;
+		} else if constexpr ( reduction == modint_reduction::montgomery ) {
+			const uint64_t m = lo * mont_inv;
+			uint64_t mh = 0;
+			umul128( m, Mod, &mh );
+			return ( hi < mh ) ? hi - mh + Mod : hi - mh;
+		} else {
+			// x * 2^shift = u1 * 2^64 + u0, u1 < d
+			const uint64_t u1 = ( div_shift == 0 ) ? hi : ( hi << div_shift ) | ( lo >> ( 64 - div_shift ) );
+			const uint64_t u0 = lo << div_shift;
+			uint64_t q1 = 0;
+			uint64_t q0 = umul128( div_reciprocal, u1, &q1 );
+			q0 += u0;
+			q1 += u1 + 1 + ( ( q0 < u0 ) ? 1 : 0 );
+			uint64_t r = u0 - q1 * div_norm;
+			if ( r > q0 ) {
+				r += div_norm;
+			}
+			if ( r >= div_norm ) {
+				r -= div_norm;
+			}
+			return r >> div_shift;
+		}
+	}
+
+	uint64_t v_;
+};
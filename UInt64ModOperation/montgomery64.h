@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <stdexcept>
+
+#include "uint64_mod_operation.h"
+
+/**
+ * Montgomery64
+ * Modular arithmetic context for a fixed odd modulus.
+ * Values are kept in Montgomery form ( a * R % mod, R = 2^64 ).
+ * Multiplication uses Montgomery reduction, so no division is executed after construction.
+ */
+class Montgomery64 {
+   public:
+	/**
+	 * Montgomery64( uint64_t mod )
+	 * @param mod odd modular
+	 */
+	explicit Montgomery64( const uint64_t mod ) : mod_( mod ) {
+		if ( ( mod & 1 ) == 0 ) {
+			throw std::invalid_argument( "Modulus must be odd." );
+		}
+		// mod * mod ≡ 1 ( mod 8 ) : 3 bits. Newton's method doubles the number of correct bits.
+		uint64_t inv = mod;
+		for ( int i = 0; i < 5; i++ ) {
+			inv *= 2 - mod * inv;
+		}
+		inv_ = inv;
+
+		// R % mod = ( 2^64 - mod ) % mod
+		r1_ = ( 0 - mod ) % mod;
+		// R^2 % mod = ( ( R % mod ) * 2^64 ) % mod
+		uint64_t rem = 0;
+		udiv128( r1_, 0, mod, &rem );
+		r2_ = rem;
+	}
+
+	uint64_t modulus() const { return mod_; }
+
+	/**
+	 * one()
+	 * @return 1 in Montgomery form
+	 */
+	uint64_t one() const { return r1_; }
+
+	/**
+	 * to_mont( uint64_t a )
+	 * @param a
+	 * @return a * R % mod
+	 */
+	uint64_t to_mont( const uint64_t a ) const {
+		uint64_t hi = 0;
+		const uint64_t lo = umul128( a < mod_ ? a : a % mod_, r2_, &hi );
+		return reduce( hi, lo );
+	}
+
+	/**
+	 * from_mont( uint64_t a )
+	 * @param a Montgomery form
+	 * @return a * R^-1 % mod
+	 */
+	uint64_t from_mont( const uint64_t a ) const { return reduce( 0, a ); }
+
+	/**
+	 * mul( uint64_t a, uint64_t b )
+	 * @param a Montgomery form
+	 * @param b Montgomery form
+	 * @return a * b in Montgomery form
+	 */
+	uint64_t mul( const uint64_t a, const uint64_t b ) const {
+		uint64_t hi = 0;
+		const uint64_t lo = umul128( a, b, &hi );
+		return reduce( hi, lo );
+	}
+
+	uint64_t add( const uint64_t a, const uint64_t b ) const {
+		const uint64_t s = a + b;
+		// s < a : a + b overflowed.
+		return ( s < a || s >= mod_ ) ? s - mod_ : s;
+	}
+
+	uint64_t sub( const uint64_t a, const uint64_t b ) const { return ( a < b ) ? a - b + mod_ : a - b; }
+
+	/**
+	 * half( uint64_t a )
+	 * @return a / 2 % mod, in either form
+	 */
+	uint64_t half( const uint64_t a ) const { return ( a & 1 ) ? ( a >> 1 ) + ( mod_ >> 1 ) + 1 : a >> 1; }
+
+	/**
+	 * pow( uint64_t a, uint64_t e )
+	 * @param a base, Montgomery form
+	 * @param e exponent
+	 * @return a ** e in Montgomery form
+	 */
+	uint64_t pow( const uint64_t a, const uint64_t e ) const { return sliding_window_pow( *this, a, e ); }
+
+	/**
+	 * inverse( uint64_t a )
+	 * @param a Montgomery form
+	 * @return a^-1 in Montgomery form
+	 */
+	uint64_t inverse( const uint64_t a ) const { return to_mont( umodinv64( from_mont( a ), mod_ ) ); }
+
+   private:
+	/**
+	 * reduce( uint64_t hi, uint64_t lo )
+	 * @return ( hi * 2^64 + lo ) * R^-1 % mod, requires hi < mod
+	 */
+	uint64_t reduce( const uint64_t hi, const uint64_t lo ) const {
+		const uint64_t m = lo * inv_;
+		uint64_t mh = 0;
+		umul128( m, mod_, &mh );
+		// hi * 2^64 + lo - m * mod is divisible by 2^64, and the low words cancel.
+		return ( hi < mh ) ? hi - mh + mod_ : hi - mh;
+	}
+
+	uint64_t mod_;
+	uint64_t inv_;  // mod^-1 % 2^64
+	uint64_t r1_;   // R % mod
+	uint64_t r2_;   // R^2 % mod
+};
@@ -0,0 +1,294 @@
+#include "multiplicative64.h"
+
+#include <random>
+#include <stdexcept>
+
+#include "factor64.h"
+#include "uint64_mod_operation.h"
+
+/**
+ * totient64( uint64_t n )
+ * Euler's phi : the product of p^( e - 1 ) * ( p - 1 ) over the prime powers p^e of n.
+ * @param n n >= 1
+ * @return phi( n )
+ */
+uint64_t totient64( const uint64_t n ) {
+	if ( n == 0 ) {
+		throw std::invalid_argument( "n must be positive." );
+	}
+	uint64_t phi = n;
+	for ( auto &&[ p, e ] : factor64( n ) ) {
+		phi = phi / p * ( p - 1 );
+	}
+	return phi;
+}
+
+/**
+ * carmichael64( uint64_t n )
+ * Carmichael's lambda, the exponent of ( Z / nZ )* : the lcm of lambda( p^e ) = p^( e - 1 ) * ( p - 1 ), except
+ * lambda( 2^e ) = 2^( e - 2 ) for e >= 3.
+ * @param n n >= 1
+ * @return lambda( n )
+ */
+uint64_t carmichael64( const uint64_t n ) {
+	if ( n == 0 ) {
+		throw std::invalid_argument( "n must be positive." );
+	}
+	uint64_t lambda = 1;
+	for ( auto &&[ p, e ] : factor64( n ) ) {
+		uint64_t l = p - 1;
+		for ( uint32_t i = 1; i < e; i++ ) {
+			l *= p;
+		}
+		if ( p == 2 && e >= 3 ) {
+			l >>= 1;
+		}
+		// lambda( n ) divides phi( n ) < 2^64 : no overflow.
+		lambda = lambda / ugcd64( lambda, l ) * l;
+	}
+	return lambda;
+}
+
+/**
+ * primitive_root64( uint64_t p )
+ * @param p prime
+ * @return the smallest generator of ( Z / pZ )*
+ */
+uint64_t primitive_root64( const uint64_t p ) {
+	if ( !is_prime( p ) ) {
+		throw std::invalid_argument( "p must be prime." );
+	}
+	if ( p == 2 ) {
+		return 1;
+	}
+	const factorization factors = factor64( p - 1 );
+	const Montgomery64 mg( p );
+	for ( uint64_t g = 2;; g++ ) {
+		const uint64_t x = mg.to_mont( g );
+		bool generator = true;
+		for ( auto &&f : factors ) {
+			if ( mg.pow( x, ( p - 1 ) / f.first ) == mg.one() ) {
+				generator = false;
+				break;
+			}
+		}
+		if ( generator ) {
+			return g;
+		}
+	}
+}
+
+/**
+ * discrete_log64( uint64_t g, uint64_t h, uint64_t p )
+ * One logarithm : the baby-step tables are built and dropped, see DiscreteLog64 for repeated logs.
+ * @param g base, g % p != 0
+ * @param h h % p != 0
+ * @param p prime
+ * @return the smallest x >= 0 with g^x ≡ h ( mod p )
+ */
+uint64_t discrete_log64( const uint64_t g, const uint64_t h, const uint64_t p ) { return DiscreteLog64( g, p ).log( h ); }
+
+inline uint64_t slot_hash( const uint64_t key, const int shift ) { return ( key * 0x9E37'79B9'7F4A'7C15ULL ) >> shift; }
+
+// Baby steps per prime factor : a table of 2^21 16-byte slots, 32 MiB. Prime factors q > max_baby_steps^2 take
+// Pollard's rho instead : about sqrt( q ) steps and no table, where q / max_baby_steps giant steps would be more.
+const uint64_t max_baby_steps = 1 << 20;
+
+// Rho : multipliers of the r-adding walk ( Teske : r >= 16 walks about as well as a random mapping ).
+const int rho_walk_bits = 5;
+
+DiscreteLog64::DiscreteLog64( const uint64_t g, const uint64_t p, const uint32_t scale ) : g_( g ), p_( p ), order_( 1 ) {
+	if ( !is_prime( p ) ) {
+		throw std::invalid_argument( "p must be prime." );
+	}
+	if ( g % p == 0 ) {
+		throw std::invalid_argument( "g must be coprime to p." );
+	}
+	if ( scale == 0 ) {
+		throw std::invalid_argument( "scale must be positive." );
+	}
+	if ( p == 2 ) {
+		return;
+	}
+	mg_.emplace( p );
+	const Montgomery64 &mg = *mg_;
+	const uint64_t x = mg.to_mont( g );
+
+	// Order of g : drop the prime factors of p - 1 that g^( n / q ) = 1 allows.
+	factorization factors = factor64( p - 1 );
+	uint64_t n = p - 1;
+	for ( auto &&f : factors ) {
+		while ( f.second > 0 && mg.pow( x, n / f.first ) == mg.one() ) {
+			n /= f.first;
+			f.second--;
+		}
+	}
+	order_ = n;
+
+	uint64_t crt_modulus = 1;
+	for ( auto &&[ q, e ] : factors ) {
+		if ( e == 0 ) {
+			continue;
+		}
+		prime_power f;
+		f.q = q;
+		f.e = e;
+		f.q_e = 1;
+		for ( uint32_t i = 0; i < e; i++ ) {
+			f.q_e *= q;
+		}
+		// Order q^e, inverted by raising to q^e - 1.
+		const uint64_t sub = mg.pow( x, n / f.q_e );
+		f.generator = mg.pow( sub, f.q_e - 1 );
+		const uint64_t gamma = mg.pow( sub, f.q_e / q );
+		f.gamma = gamma;
+		f.crt = umodinv64( crt_modulus % f.q_e, f.q_e );
+		crt_modulus *= f.q_e;
+
+		// baby = min( q, scale * ceil( sqrt( q ) ), max_baby_steps ).
+		uint64_t root = isqrt( q );
+		root += ( root * root < q ) ? 1 : 0;
+		if ( root > max_baby_steps ) {
+			// Pollard's rho, no table.
+			f.baby = 0;
+			f.shift = 0;
+			f.giant = 0;
+			factors_.push_back( std::move( f ) );
+			continue;
+		}
+		f.baby = ( root > q / scale ) ? q : root * scale;
+		if ( f.baby > max_baby_steps ) {
+			f.baby = max_baby_steps;
+		}
+		int bits = 1;
+		while ( ( 1ULL << bits ) < 2 * f.baby ) {
+			bits++;
+		}
+		f.shift = 64 - bits;
+		f.table.assign( size_t( 1 ) << bits, slot{ 0, 0 } );
+		const size_t mask = f.table.size() - 1;
+		// gamma^step is never 0, and distinct for step < q.
+		uint64_t y = mg.one();
+		for ( uint64_t step = 0; step < f.baby; step++ ) {
+			size_t i = static_cast<size_t>( slot_hash( y, f.shift ) );
+			while ( f.table[ i ].key != 0 ) {
+				i = ( i + 1 ) & mask;
+			}
+			f.table[ i ] = slot{ y, static_cast<uint32_t>( step ) };
+			y = mg.mul( y, gamma );
+		}
+		// y = gamma^baby
+		f.giant = mg.pow( y, q - 1 );
+		factors_.push_back( std::move( f ) );
+	}
+}
+
+/**
+ * solve( const prime_power &f, uint64_t y )
+ * Baby-step giant-step in the subgroup of order q.
+ * @param y Montgomery form of an element of the subgroup
+ * @return d < q with gamma^d = y
+ */
+uint64_t DiscreteLog64::solve( const prime_power &f, uint64_t y ) const {
+	if ( f.table.empty() ) {
+		return solve_rho( f, y );
+	}
+	const Montgomery64 &mg = *mg_;
+	const size_t mask = f.table.size() - 1;
+	for ( uint64_t giant = 0; giant < f.q; giant += f.baby ) {
+		// y = target * gamma^-giant
+		for ( size_t i = static_cast<size_t>( slot_hash( y, f.shift ) ); f.table[ i ].key != 0; i = ( i + 1 ) & mask ) {
+			if ( f.table[ i ].key == y ) {
+				return giant + f.table[ i ].step;
+			}
+		}
+		y = mg.mul( y, f.giant );
+	}
+	throw std::overflow_error( "The logarithm does not exist." );
+}
+
+/**
+ * solve_rho( const prime_power &f, uint64_t y )
+ * Pollard's rho in the subgroup of order q : an r-adding walk on x = gamma^a y^b, with Brent's cycle detection.
+ * A collision gamma^a1 y^b1 = gamma^a2 y^b2 gives d ( b2 - b1 ) ≡ a1 - a2 ( mod q ). About 1.3 sqrt( q ) steps.
+ * @param y Montgomery form of an element of the subgroup
+ * @return d < q with gamma^d = y
+ */
+uint64_t DiscreteLog64::solve_rho( const prime_power &f, const uint64_t y ) const {
+	const Montgomery64 &mg = *mg_;
+	const uint64_t q = f.q;
+	if ( y == mg.one() ) {
+		return 0;
+	}
+	struct point {
+		uint64_t x, a, b;
+	};
+	std::mt19937_64 rng( q );
+	for ( ;; ) {
+		point step[ 1 << rho_walk_bits ];
+		for ( auto &&m : step ) {
+			m.a = rng() % q;
+			m.b = rng() % q;
+			m.x = mg.mul( mg.pow( f.gamma, m.a ), mg.pow( y, m.b ) );
+		}
+		const auto next = [ & ]( point *u ) {
+			const point &m = step[ slot_hash( u->x, 64 - rho_walk_bits ) ];
+			u->x = mg.mul( u->x, m.x );
+			u->a = uaddmod64( u->a, m.a, q );
+			u->b = uaddmod64( u->b, m.b, q );
+		};
+
+		point tortoise{ y, 0, 1 };
+		point hare = tortoise;
+		next( &hare );
+		for ( uint64_t power = 1, lambda = 1; hare.x != tortoise.x; lambda++ ) {
+			if ( lambda == power ) {
+				tortoise = hare;
+				power <<= 1;
+				lambda = 0;
+			}
+			next( &hare );
+		}
+		// b equal : a useless collision, walk again with other multipliers.
+		if ( hare.b != tortoise.b ) {
+			const uint64_t d = umulmod64( usubmod64( tortoise.a, hare.a, q ),
+			                              umodinv64( usubmod64( hare.b, tortoise.b, q ), q ), q );
+			if ( mg.pow( f.gamma, d ) == y ) {
+				return d;
+			}
+		}
+	}
+}
+
+uint64_t DiscreteLog64::log( const uint64_t h ) const {
+	if ( h % p_ == 0 ) {
+		throw std::invalid_argument( "h must be coprime to p." );
+	}
+	if ( p_ == 2 ) {
+		return 0;
+	}
+	const Montgomery64 &mg = *mg_;
+	const uint64_t y = mg.to_mont( h );
+	// ( Z / pZ )* is cyclic : h is a power of g iff h^order = 1.
+	if ( mg.pow( y, order_ ) != mg.one() ) {
+		throw std::overflow_error( "The logarithm does not exist." );
+	}
+
+	uint64_t x = 0, modulus = 1;
+	for ( auto &&f : factors_ ) {
+		// Digits of the log in the subgroup of order q^e, lowest first :
+		// d_k = log_gamma( ( sub^-x_k * h' )^( q^( e - 1 - k ) ) ), x_k = d_0 + d_1 q + ... + d_( k - 1 ) q^( k - 1 ).
+		const uint64_t target = mg.pow( y, order_ / f.q_e );
+		uint64_t xq = 0, qk = 1;
+		for ( uint32_t k = 0; k < f.e; k++ ) {
+			const uint64_t t = mg.pow( mg.mul( mg.pow( f.generator, xq ), target ), f.q_e / qk / f.q );
+			xq += solve( f, t ) * qk;
+			qk *= f.q;
+		}
+		// Garner : x ≡ xq ( mod q^e ), modulus * q^e divides the order.
+		const uint64_t t = umulmod64( usubmod64( xq, x % f.q_e, f.q_e ), f.crt, f.q_e );
+		x += modulus * t;
+		modulus *= f.q_e;
+	}
+	return x;
+}
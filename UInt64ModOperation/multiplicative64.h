@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <optional>
+#include <vector>
+
+#include "montgomery64.h"
+
+// The multiplicative group ( Z / nZ )*.
+// totient64() and carmichael64() are computed from factor64( n ).
+// primitive_root64( p ) is the smallest g with g^( ( p - 1 ) / q ) != 1 for every prime factor q of p - 1.
+// discrete_log64() is Pohlig-Hellman over the prime factors of the order of g, with baby-step giant-step in every
+// subgroup of prime order q, or Pollard's rho for q > 2^40. All in Montgomery form.
+
+uint64_t totient64( uint64_t n );
+uint64_t carmichael64( uint64_t n );
+uint64_t primitive_root64( uint64_t p );
+uint64_t discrete_log64( uint64_t g, uint64_t h, uint64_t p );
+
+/**
+ * DiscreteLog64
+ * Discrete logarithms to one base modulo one prime.
+ * The order of g, its factorization and the baby steps of every prime factor q are precomputed, so log() only pays
+ * the giant steps : about sqrt( q ) / scale multiplications for every prime factor q, counted with multiplicity.
+ * The baby steps are an open-addressing hash table with linear probing, at most half full.
+ * Memory : at most 2^20 baby steps, 32 MiB, per prime factor q. Above 2^40, q takes Pollard's rho instead : no table,
+ * about 1.3 sqrt( q ) multiplications for every log, a minute for a safe prime p = 2q + 1 near 2^64.
+ */
+class DiscreteLog64 {
+   public:
+	/**
+	 * DiscreteLog64( uint64_t g, uint64_t p, uint32_t scale )
+	 * @param g base, g % p != 0
+	 * @param p prime
+	 * @param scale baby steps per prime factor q : scale * ceil( sqrt( q ) ), at most q and 2^20. Raise it for many logs.
+	 */
+	DiscreteLog64( uint64_t g, uint64_t p, uint32_t scale = 1 );
+
+	uint64_t base() const { return g_; }
+	uint64_t modulus() const { return p_; }
+
+	/**
+	 * order()
+	 * @return the multiplicative order of g modulo p
+	 */
+	uint64_t order() const { return order_; }
+
+	/**
+	 * log( uint64_t h )
+	 * @param h h % p != 0
+	 * @return the smallest x >= 0 with g^x ≡ h ( mod p )
+	 */
+	uint64_t log( uint64_t h ) const;
+
+   private:
+	struct slot {
+		uint64_t key;  // Montgomery form of gamma^step, 0 : empty
+		uint32_t step;
+	};
+
+	// Subgroup of order q^e : g^( order / q^e ), and gamma = g^( order / q ) of order q for the baby-step giant-step.
+	struct prime_power {
+		uint64_t q;
+		uint32_t e;
+		uint64_t q_e;        // q^e
+		uint64_t generator;  // Montgomery form of ( g^( order / q^e ) )^-1
+		uint64_t gamma;      // Montgomery form of gamma
+		uint64_t giant;      // Montgomery form of gamma^-baby
+		uint64_t baby;       // baby steps, 0 : Pollard's rho
+		uint64_t crt;        // ( product of the earlier q_e )^-1 % q_e
+		int shift;           // 64 - log2( table size )
+		std::vector<slot> table;  // empty : Pollard's rho
+	};
+
+	uint64_t solve( const prime_power &f, uint64_t y ) const;
+	uint64_t solve_rho( const prime_power &f, uint64_t y ) const;
+
+	uint64_t g_;
+	uint64_t p_;
+	uint64_t order_;
+	std::optional<Montgomery64> mg_;  // odd p
+	std::vector<prime_power> factors_;
+};
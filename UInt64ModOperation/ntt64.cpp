@@ -0,0 +1,433 @@
+#include "ntt64.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#include "montgomery64.h"
+#include "uint128_arith.h"
+#include "uint64_mod_operation.h"
+
+// Sub-transforms of at most ntt_block elements ( 32 KiB ) are done level by level.
+const size_t ntt_block = 1 << 12;
+
+// Below this length, schoolbook multiplication.
+const size_t ntt_schoolbook = 32;
+
+// Twiddle tables kept per thread, least recently used first out : the three CRT primes and one other.
+const size_t ntt_cache_entries = 4;
+
+// c * 2^k + 1 < 2^62, k >= 41. The product exceeds 2^185 > 2^41 * ( 2^64 )^2.
+const uint64_t crt_primes[ 3 ] = { 0x3FFF'C000'0000'0001, 0x3FFF'BE00'0000'0001, 0x3FFF'8400'0000'0001 };
+
+/**
+ * shoup_arith
+ * p < 2^62. A twiddle w carries w' = floor( w * 2^64 / p ), and x * w % p is obtained in [ 0, 2p ) with two
+ * multiplications. Harvey's butterflies keep values in [ 0, 4p ) in the forward transform and in [ 0, 2p ) in the
+ * inverse transform, and reduce only at the end.
+ */
+struct shoup_arith {
+	struct twiddle {
+		uint64_t w;
+		uint64_t w_shoup;
+	};
+
+	explicit shoup_arith( const uint64_t p ) : p( p ), p2( 2 * p ), mg( p ) {}
+
+	twiddle make_twiddle( const uint64_t w ) const {
+		uint64_t rem = 0;
+		return twiddle{ w, udiv128( w, 0, p, &rem ) };
+	}
+
+	// ( a * b / n ) % p : scale = n^-1 * R
+	twiddle make_scale( const uint64_t n_inv ) const { return make_twiddle( mg.to_mont( n_inv ) ); }
+
+	// x * w, in [ 0, 2p )
+	uint64_t mul( const uint64_t x, const twiddle &t ) const {
+		uint64_t q = 0;
+		umul128( x, t.w_shoup, &q );
+		return x * t.w - q * p;
+	}
+
+	void forward( uint64_t &x, uint64_t &y, const twiddle &t ) const {
+		const uint64_t u = ( x >= p2 ) ? x - p2 : x;
+		const uint64_t v = mul( y, t );
+		x = u + v;
+		y = u - v + p2;
+	}
+
+	void inverse( uint64_t &x, uint64_t &y, const twiddle &t ) const {
+		const uint64_t u = x + y;
+		const uint64_t v = x - y + p2;
+		x = ( u >= p2 ) ? u - p2 : u;
+		y = mul( v, t );
+	}
+
+	uint64_t pointwise( const uint64_t a, const uint64_t b, const twiddle &scale ) const {
+		// mg.mul() needs a * b < p * 2^64.
+		return mul( mg.mul( reduce( a ), reduce( b ) ), scale );
+	}
+
+	uint64_t finish( const uint64_t x ) const { return ( x >= p ) ? x - p : x; }
+
+	// [ 0, 4p ) -> [ 0, p )
+	uint64_t reduce( uint64_t x ) const {
+		x = ( x >= p2 ) ? x - p2 : x;
+		return ( x >= p ) ? x - p : x;
+	}
+
+	uint64_t p;
+	uint64_t p2;
+	Montgomery64 mg;
+};
+
+/**
+ * montgomery_arith
+ * Any odd p. Values are reduced after every butterfly, twiddles are in Montgomery form.
+ */
+struct montgomery_arith {
+	using twiddle = uint64_t;
+
+	explicit montgomery_arith( const uint64_t p ) : mg( p ) {}
+
+	twiddle make_twiddle( const uint64_t w ) const { return mg.to_mont( w ); }
+
+	// ( a * b / n ) % p : scale = n^-1 * R^2
+	twiddle make_scale( const uint64_t n_inv ) const { return mg.to_mont( mg.to_mont( n_inv ) ); }
+
+	void forward( uint64_t &x, uint64_t &y, const twiddle &t ) const {
+		const uint64_t v = mg.mul( y, t );
+		y = mg.sub( x, v );
+		x = mg.add( x, v );
+	}
+
+	void inverse( uint64_t &x, uint64_t &y, const twiddle &t ) const {
+		const uint64_t u = mg.add( x, y );
+		y = mg.mul( mg.sub( x, y ), t );
+		x = u;
+	}
+
+	uint64_t pointwise( const uint64_t a, const uint64_t b, const twiddle &scale ) const {
+		return mg.mul( mg.mul( a, b ), scale );
+	}
+
+	uint64_t finish( const uint64_t x ) const { return x; }
+
+	Montgomery64 mg;
+};
+
+/**
+ * ntt_max_length( uint64_t p )
+ * @param p
+ * @return the largest power of two n with n | p - 1 if p is an odd prime, otherwise 0
+ */
+uint64_t ntt_max_length( const uint64_t p ) {
+	if ( p < 3 || !is_prime( p ) ) {
+		return 0;
+	}
+	return 1ULL << utzcnt64( p - 1 );
+}
+
+/**
+ * root_of_unity( uint64_t p, uint64_t n )
+ * @param p prime
+ * @param n power of two, n | p - 1
+ * @return a primitive n-th root of unity
+ */
+static uint64_t root_of_unity( const uint64_t p, const uint64_t n ) {
+	const int s = utzcnt64( p - 1 );
+	const uint64_t odd = ( p - 1 ) >> s;
+	for ( uint64_t g = 2;; g++ ) {
+		// g^odd has order 2^s iff g is a quadratic non-residue.
+		const uint64_t x = powmod64( g, odd, p );
+		uint64_t y = x;
+		for ( int i = 1; i < s; i++ ) {
+			y = umulmod64( y, y, p );
+		}
+		if ( y == p - 1 ) {
+			return powmod64( x, ( 1ULL << s ) / n, p );
+		}
+	}
+}
+
+/**
+ * ntt_tables<Arith>
+ * Twiddles indexed by node : the root is node 1, the children of node k are 2k and 2k + 1.
+ * Node k = 2^d + i holds w_{2^(d+1)}^bitreverse_d( i ), so the table of length n serves every transform length <= n.
+ */
+template <typename Arith>
+struct ntt_tables {
+	ntt_tables( const uint64_t p, const size_t n ) : p( p ), arith( p ), forward( n ), inverse( n ) {
+		const uint64_t w = root_of_unity( p, n );
+		const uint64_t w_inv = umodinv64( w, p );
+		std::vector<uint64_t> powers( n / 2 ), inv_powers( n / 2 );
+		uint64_t x = 1, y = 1;
+		for ( size_t j = 0; j < n / 2; j++ ) {
+			powers[ j ] = x;
+			inv_powers[ j ] = y;
+			x = umulmod64( x, w, p );
+			y = umulmod64( y, w_inv, p );
+		}
+		for ( size_t k = 1; k < n; k++ ) {
+			const int depth = 63 - ulzcnt64( k );
+			const uint64_t i = k - ( 1ULL << depth );
+			uint64_t reversed = 0;
+			for ( int bit = 0; bit < depth; bit++ ) {
+				reversed |= ( ( i >> bit ) & 1 ) << ( depth - 1 - bit );
+			}
+			const size_t e = static_cast<size_t>( reversed * ( n >> ( depth + 1 ) ) );
+			forward[ k ] = arith.make_twiddle( powers[ e ] );
+			inverse[ k ] = arith.make_twiddle( inv_powers[ e ] );
+		}
+	}
+
+	uint64_t p;
+	Arith arith;
+	std::vector<typename Arith::twiddle> forward;
+	std::vector<typename Arith::twiddle> inverse;
+};
+
+/**
+ * get_tables<Arith>( uint64_t p, size_t n )
+ * Tables are built once per thread and prime, and rebuilt when a longer transform is requested.
+ * At most ntt_cache_entries primes are kept per thread, the most recently used first. The reference is valid until
+ * the next call.
+ */
+template <typename Arith>
+static const ntt_tables<Arith> &get_tables( const uint64_t p, const size_t n ) {
+	thread_local std::vector<std::unique_ptr<ntt_tables<Arith>>> cache;
+	auto it = std::find_if( cache.begin(), cache.end(), [ & ]( const auto &t ) { return t->p == p; } );
+	if ( it == cache.end() ) {
+		if ( cache.size() == ntt_cache_entries ) {
+			cache.pop_back();
+		}
+		it = cache.insert( cache.end(), nullptr );
+	}
+	if ( *it == nullptr || ( *it )->forward.size() < n ) {
+		*it = std::make_unique<ntt_tables<Arith>>( p, n );
+	}
+	std::rotate( cache.begin(), it, it + 1 );
+	return *cache.front();
+}
+
+/**
+ * forward4( const Arith &ar, const twiddle *w, uint64_t *a, size_t q, size_t node )
+ * Two levels of the forward transform on the 4q elements of node : node, then its children 2 node and 2 node + 1.
+ */
+template <typename Arith>
+static void forward4( const Arith &ar, const typename Arith::twiddle *w, uint64_t *a, const size_t q, const size_t node ) {
+	const auto w1 = w[ node ];
+	const auto w2 = w[ 2 * node ];
+	const auto w3 = w[ 2 * node + 1 ];
+	for ( size_t j = 0; j < q; j++ ) {
+		uint64_t x0 = a[ j ], x1 = a[ j + q ], x2 = a[ j + 2 * q ], x3 = a[ j + 3 * q ];
+		ar.forward( x0, x2, w1 );
+		ar.forward( x1, x3, w1 );
+		ar.forward( x0, x1, w2 );
+		ar.forward( x2, x3, w3 );
+		a[ j ] = x0;
+		a[ j + q ] = x1;
+		a[ j + 2 * q ] = x2;
+		a[ j + 3 * q ] = x3;
+	}
+}
+
+template <typename Arith>
+static void inverse4( const Arith &ar, const typename Arith::twiddle *w, uint64_t *a, const size_t q, const size_t node ) {
+	const auto w1 = w[ node ];
+	const auto w2 = w[ 2 * node ];
+	const auto w3 = w[ 2 * node + 1 ];
+	for ( size_t j = 0; j < q; j++ ) {
+		uint64_t x0 = a[ j ], x1 = a[ j + q ], x2 = a[ j + 2 * q ], x3 = a[ j + 3 * q ];
+		ar.inverse( x0, x1, w2 );
+		ar.inverse( x2, x3, w3 );
+		ar.inverse( x0, x2, w1 );
+		ar.inverse( x1, x3, w1 );
+		a[ j ] = x0;
+		a[ j + q ] = x1;
+		a[ j + 2 * q ] = x2;
+		a[ j + 3 * q ] = x3;
+	}
+}
+
+/**
+ * forward_transform( const Arith &ar, const twiddle *w, uint64_t *a, size_t len, size_t node )
+ * Decimation in frequency, natural order in, bit-reversed order out.
+ */
+template <typename Arith>
+static void forward_transform( const Arith &ar, const typename Arith::twiddle *w, uint64_t *a, const size_t len,
+                               const size_t node ) {
+	if ( len > ntt_block ) {
+		const size_t q = len / 4;
+		forward4( ar, w, a, q, node );
+		for ( size_t i = 0; i < 4; i++ ) {
+			forward_transform( ar, w, a + i * q, q, 4 * node + i );
+		}
+		return;
+	}
+	size_t size = len, first = node, count = 1;
+	for ( ; size >= 4; size /= 4, first *= 4, count *= 4 ) {
+		for ( size_t b = 0; b < count; b++ ) {
+			forward4( ar, w, a + b * size, size / 4, first + b );
+		}
+	}
+	if ( size == 2 ) {
+		for ( size_t b = 0; b < count; b++ ) {
+			ar.forward( a[ 2 * b ], a[ 2 * b + 1 ], w[ first + b ] );
+		}
+	}
+}
+
+/**
+ * inverse_transform( const Arith &ar, const twiddle *w, uint64_t *a, size_t len, size_t node )
+ * Decimation in time, bit-reversed order in, natural order out. Not scaled by 1 / len.
+ */
+template <typename Arith>
+static void inverse_transform( const Arith &ar, const typename Arith::twiddle *w, uint64_t *a, const size_t len,
+                               const size_t node ) {
+	if ( len > ntt_block ) {
+		const size_t q = len / 4;
+		for ( size_t i = 0; i < 4; i++ ) {
+			inverse_transform( ar, w, a + i * q, q, 4 * node + i );
+		}
+		inverse4( ar, w, a, q, node );
+		return;
+	}
+	size_t size = 1;
+	if ( utzcnt64( len ) & 1 ) {
+		const size_t count = len / 2;
+		for ( size_t b = 0; b < count; b++ ) {
+			ar.inverse( a[ 2 * b ], a[ 2 * b + 1 ], w[ node * count + b ] );
+		}
+		size = 2;
+	}
+	while ( size < len ) {
+		size *= 4;
+		const size_t count = len / size;
+		for ( size_t b = 0; b < count; b++ ) {
+			inverse4( ar, w, a + b * size, size / 4, node * count + b );
+		}
+	}
+}
+
+/**
+ * ntt_multiply<Arith>( uint64_t p, const std::vector<uint64_t> &a, const std::vector<uint64_t> &b, size_t len )
+ * @param p prime, ntt_max_length( p ) >= len
+ * @return a * b % p, len coefficients
+ */
+template <typename Arith>
+static std::vector<uint64_t> ntt_multiply( const uint64_t p, const std::vector<uint64_t> &a,
+                                           const std::vector<uint64_t> &b, const size_t len ) {
+	size_t n = 1;
+	while ( n < len ) {
+		n <<= 1;
+	}
+	const ntt_tables<Arith> &tables = get_tables<Arith>( p, n );
+	const Arith &ar = tables.arith;
+
+	std::vector<uint64_t> fa( n ), fb;
+	for ( size_t i = 0; i < a.size(); i++ ) {
+		fa[ i ] = a[ i ] % p;
+	}
+	forward_transform( ar, tables.forward.data(), fa.data(), n, 1 );
+	if ( &a != &b ) {
+		fb.resize( n );
+		for ( size_t i = 0; i < b.size(); i++ ) {
+			fb[ i ] = b[ i ] % p;
+		}
+		forward_transform( ar, tables.forward.data(), fb.data(), n, 1 );
+	}
+	// Squaring : a * a
+	const std::vector<uint64_t> &gb = fb.empty() ? fa : fb;
+
+	const auto scale = ar.make_scale( umodinv64( n, p ) );
+	for ( size_t i = 0; i < n; i++ ) {
+		fa[ i ] = ar.pointwise( fa[ i ], gb[ i ], scale );
+	}
+	inverse_transform( ar, tables.inverse.data(), fa.data(), n, 1 );
+
+	fa.resize( len );
+	for ( auto &&x : fa ) {
+		x = ar.finish( x );
+	}
+	return fa;
+}
+
+static std::vector<uint64_t> ntt_multiply( const uint64_t p, const std::vector<uint64_t> &a,
+                                           const std::vector<uint64_t> &b, const size_t len ) {
+	if ( p < ( 1ULL << 62 ) ) {
+		return ntt_multiply<shoup_arith>( p, a, b, len );
+	}
+	return ntt_multiply<montgomery_arith>( p, a, b, len );
+}
+
+/**
+ * poly_mul_mod( const std::vector<uint64_t> &a, const std::vector<uint64_t> &b, uint64_t p )
+ * @param a coefficients, a[ i ] is the coefficient of x^i
+ * @param b coefficients
+ * @param p modular
+ * @return a * b % p, a.size() + b.size() - 1 coefficients, empty if a or b is empty
+ */
+std::vector<uint64_t> poly_mul_mod( const std::vector<uint64_t> &a, const std::vector<uint64_t> &b, const uint64_t p ) {
+	if ( p == 0 ) {
+		throw std::overflow_error( "Divide by Zero." );
+	}
+	if ( a.empty() || b.empty() ) {
+		return {};
+	}
+	const size_t len = a.size() + b.size() - 1;
+
+	if ( std::min( a.size(), b.size() ) <= ntt_schoolbook || p == 1 ) {
+		std::vector<uint64_t> c( len, 0 );
+		for ( size_t i = 0; i < a.size(); i++ ) {
+			for ( size_t j = 0; j < b.size(); j++ ) {
+				c[ i + j ] = uaddmod64( c[ i + j ], umulmod64( a[ i ], b[ j ], p ), p );
+			}
+		}
+		return c;
+	}
+
+	if ( ntt_max_length( p ) >= len ) {
+		return ntt_multiply( p, a, b, len );
+	}
+
+	// Coefficients of a * b are < len * p^2 before reduction : exact modulo m1 * m2 * m3.
+	const bool square = ( &a == &b );
+	std::vector<uint64_t> ra( a.size() ), rb;
+	for ( size_t i = 0; i < a.size(); i++ ) {
+		ra[ i ] = a[ i ] % p;
+	}
+	if ( !square ) {
+		rb.resize( b.size() );
+		for ( size_t i = 0; i < b.size(); i++ ) {
+			rb[ i ] = b[ i ] % p;
+		}
+	}
+	const std::vector<uint64_t> &sb = square ? ra : rb;
+	const std::vector<uint64_t> c1 = ntt_multiply( crt_primes[ 0 ], ra, sb, len );
+	const std::vector<uint64_t> c2 = ntt_multiply( crt_primes[ 1 ], ra, sb, len );
+	const std::vector<uint64_t> c3 = ntt_multiply( crt_primes[ 2 ], ra, sb, len );
+
+	// Garner : x = r1 + m1 * t2 + m1 * m2 * t3
+	const uint64_t m1 = crt_primes[ 0 ], m2 = crt_primes[ 1 ], m3 = crt_primes[ 2 ];
+	const uint64_t m1_inv_m2 = umodinv64( m1, m2 );
+	const uint64_t m12_inv_m3 = umodinv64( umulmod64( m1, m2, m3 ), m3 );
+	const uint64_t m1_p = m1 % p;
+	const uint64_t m12_p = umulmod64( m1, m2, p );
+	const Montgomery64 mg2( m2 ), mg3( m3 );
+	const uint64_t m1_inv_m2_mont = mg2.to_mont( m1_inv_m2 );
+	const uint64_t m12_inv_m3_mont = mg3.to_mont( m12_inv_m3 );
+	const uint64_t m1_m3 = mg3.to_mont( m1 );
+
+	std::vector<uint64_t> c( len );
+	for ( size_t i = 0; i < len; i++ ) {
+		const uint64_t r1 = c1[ i ], r2 = c2[ i ], r3 = c3[ i ];
+		// r1 < m1 < 2 * m2
+		const uint64_t t2 = mg2.mul( mg2.sub( r2, ( r1 >= m2 ) ? r1 - m2 : r1 ), m1_inv_m2_mont );
+		// ( r1 + m1 * t2 ) % m3, r1 < 2 * m3
+		const uint64_t x3 = mg3.add( ( r1 >= m3 ) ? r1 - m3 : r1, mg3.mul( t2, m1_m3 ) );
+		const uint64_t t3 = mg3.mul( mg3.sub( r3, x3 ), m12_inv_m3_mont );
+		c[ i ] = uaddmod64( uaddmod64( r1 % p, umulmod64( m1_p, t2, p ), p ), umulmod64( m12_p, t3, p ), p );
+	}
+	return c;
+}
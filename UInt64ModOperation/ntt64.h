@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+// Polynomial multiplication with the number-theoretic transform.
+// A prime p with 2^k | p - 1 supports transforms of length up to 2^k. Other moduli, and lengths the prime does not
+// support, are multiplied modulo three 62-bit NTT primes and recombined with the CRT ( Garner ).
+// Transforms are radix-4 with lazy Shoup butterflies ( p < 2^62 ) or Montgomery butterflies ( larger p ).
+// Transforms larger than L1 are done depth first, so every sub-transform of L1 size runs in cache.
+// Twiddle tables are cached per thread for the 4 most recently used primes : at most 32 n bytes each for length n.
+
+std::vector<uint64_t> poly_mul_mod( const std::vector<uint64_t> &a, const std::vector<uint64_t> &b, uint64_t p );
+uint64_t ntt_max_length( uint64_t p );
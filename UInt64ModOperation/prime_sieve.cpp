@@ -0,0 +1,442 @@
+#include "prime_sieve.h"
+
+#include <string.h>
+
+#include <limits>
+#include <stdexcept>
+
+#include "barrett64.h"
+#include "uint64_mod_operation.h"
+
+// Numbers coprime to 30 in [ 0, 30 ), bit i of a byte is wheel_residues[ i ].
+const static uint32_t wheel_residues[ 8 ] = { 1, 7, 11, 13, 17, 19, 23, 29 };
+
+// Bit of a residue mod 30, 0xFF if the residue is not coprime to 30.
+const static uint8_t wheel_bit[ 30 ] = {
+    0xFF, 0,    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 1,    0xFF, 0xFF, 0xFF, 2,    0xFF, 3,    0xFF,
+    0xFF, 0xFF, 4,    0xFF, 5,    0xFF, 0xFF, 0xFF, 6,    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 7,
+};
+
+const size_t l1_segment_bytes = 32 * 1024;
+const size_t l2_segment_bytes = 256 * 1024;
+
+// Limit of the sieving primes. Above it, survivors are checked by is_prime().
+const uint64_t max_sieve_bound = 1ULL << 26;
+const uint64_t min_sieve_bound = 1ULL << 16;
+
+/**
+ * sieving_primes( uint64_t bound )
+ * @param bound
+ * @return primes 7 <= p <= bound
+ */
+static std::vector<uint32_t> sieving_primes( const uint64_t bound ) {
+	std::vector<uint32_t> primes;
+	if ( bound < 7 ) {
+		return primes;
+	}
+	// odd[ i ] : 2 * i + 1
+	std::vector<bool> composite( bound / 2 + 1, false );
+	for ( uint64_t i = 3; i * i <= bound; i += 2 ) {
+		if ( !composite[ i / 2 ] ) {
+			for ( uint64_t j = i * i; j <= bound; j += 2 * i ) {
+				composite[ j / 2 ] = true;
+			}
+		}
+	}
+	for ( uint64_t i = 7; i <= bound; i += 2 ) {
+		if ( !composite[ i / 2 ] ) {
+			primes.push_back( static_cast<uint32_t>( i ) );
+		}
+	}
+	return primes;
+}
+
+/**
+ * sieve_range( uint64_t lo, uint64_t hi, F on_prime )
+ * Calls on_prime( p ) for every prime lo <= p <= hi in increasing order.
+ * on_segment( const uint8_t *bits, size_t bytes ) is called instead for fully sieved segments when it returns true.
+ */
+template <typename OnPrime, typename OnSegment>
+static void sieve_range( const uint64_t lo, const uint64_t hi, OnPrime on_prime, OnSegment on_segment ) {
+	if ( lo > hi ) {
+		return;
+	}
+	for ( const uint64_t p : { 2ULL, 3ULL, 5ULL } ) {
+		if ( lo <= p && p <= hi ) {
+			on_prime( p );
+		}
+	}
+	if ( hi < 7 ) {
+		return;
+	}
+
+	const uint64_t root = isqrt( hi );
+	uint64_t bound = root;
+	if ( bound > hi - lo && bound > min_sieve_bound ) {
+		// Narrow range : sieving by all primes <= sqrt( hi ) costs more than Miller-Rabin on the survivors.
+		bound = ( hi - lo > min_sieve_bound ) ? hi - lo : min_sieve_bound;
+	}
+	if ( bound > max_sieve_bound ) {
+		bound = max_sieve_bound;
+	}
+	const bool full = ( bound >= root );
+	// Survivors <= bound^2 are prime.
+	const uint64_t bound_square = bound * bound;
+
+	const std::vector<uint32_t> primes = sieving_primes( bound );
+	const size_t segment_bytes = ( bound <= 30 * l1_segment_bytes ) ? l1_segment_bytes : l2_segment_bytes;
+	std::vector<uint8_t> segment( segment_bytes );
+
+	const uint64_t first_byte = lo / 30;
+	const uint64_t last_byte = hi / 30;
+
+	for ( uint64_t seg_lo = first_byte; seg_lo <= last_byte; ) {
+		const size_t bytes =
+		    static_cast<size_t>( ( last_byte - seg_lo < segment_bytes ) ? last_byte - seg_lo + 1 : segment_bytes );
+		uint8_t *bits = segment.data();
+		memset( bits, 0xFF, bytes );
+
+		// [ seg_lo * 30, ( seg_lo + bytes ) * 30 )
+		const uint64_t low = seg_lo * 30;
+		const uint64_t high_byte = seg_lo + bytes;
+		for ( const uint32_t p : primes ) {
+			// q >= p, p * q >= low
+			uint64_t q_start = low / p + ( ( low % p ) != 0 );
+			if ( q_start < p ) {
+				q_start = p;
+			}
+			if ( q_start / 30 > high_byte / p ) {
+				continue;
+			}
+			for ( const uint32_t r : wheel_residues ) {
+				// The first q >= q_start with q ≡ r ( mod 30 ).
+				const uint64_t q = q_start + ( r + 30 - q_start % 30 ) % 30;
+				if ( q > std::numeric_limits<uint64_t>::max() / p ) {
+					continue;
+				}
+				const uint64_t m = q * p;
+				const uint8_t mask = static_cast<uint8_t>( ~( 1U << wheel_bit[ m % 30 ] ) );
+				// m + 30p * t : byte index increases by p.
+				for ( uint64_t k = m / 30 - seg_lo; k < bytes; k += p ) {
+					bits[ k ] &= mask;
+				}
+			}
+		}
+
+		// 1 is not a prime.
+		if ( seg_lo == 0 ) {
+			bits[ 0 ] &= 0xFE;
+		}
+		// Clear numbers outside [ lo, hi ] in the first and last bytes.
+		if ( seg_lo == first_byte ) {
+			for ( int i = 0; i < 8; i++ ) {
+				if ( first_byte * 30 + wheel_residues[ i ] < lo ) {
+					bits[ 0 ] &= static_cast<uint8_t>( ~( 1U << i ) );
+				}
+			}
+		}
+		if ( seg_lo + bytes - 1 == last_byte ) {
+			for ( int i = 0; i < 8; i++ ) {
+				// last_byte * 30 + residue may exceed 2^64 - 1.
+				if ( wheel_residues[ i ] > hi - last_byte * 30 ) {
+					bits[ bytes - 1 ] &= static_cast<uint8_t>( ~( 1U << i ) );
+				}
+			}
+		}
+
+		if ( !( full && on_segment( bits, bytes ) ) ) {
+			for ( size_t k = 0; k < bytes; k++ ) {
+				for ( uint32_t b = bits[ k ]; b != 0; b &= b - 1 ) {
+					const uint64_t n = ( seg_lo + k ) * 30 + wheel_residues[ utzcnt64( b ) ];
+					if ( full || n <= bound_square || is_prime( n ) ) {
+						on_prime( n );
+					}
+				}
+			}
+		}
+
+		if ( last_byte - seg_lo < bytes ) {
+			break;
+		}
+		seg_lo += bytes;
+	}
+}
+
+/**
+ * primes_in_range( uint64_t lo, uint64_t hi )
+ * @param lo
+ * @param hi
+ * @return primes lo <= p <= hi in increasing order
+ */
+std::vector<uint64_t> primes_in_range( const uint64_t lo, const uint64_t hi ) {
+	std::vector<uint64_t> primes;
+	sieve_range(
+	    lo, hi, [ & ]( const uint64_t p ) { primes.push_back( p ); },
+	    []( const uint8_t *, size_t ) { return false; } );
+	return primes;
+}
+
+/**
+ * count_primes( uint64_t lo, uint64_t hi )
+ * @param lo
+ * @param hi
+ * @return number of primes lo <= p <= hi
+ */
+uint64_t count_primes( const uint64_t lo, const uint64_t hi ) {
+	uint64_t count = 0;
+	sieve_range(
+	    lo, hi, [ & ]( uint64_t ) { count++; },
+	    [ & ]( const uint8_t *bits, const size_t bytes ) {
+		    size_t k = 0;
+		    for ( ; k + 8 <= bytes; k += 8 ) {
+			    uint64_t w;
+			    memcpy( &w, bits + k, sizeof( w ) );
+			    count += upopcnt64( w );
+		    }
+		    for ( ; k < bytes; k++ ) {
+			    count += upopcnt64( bits[ k ] );
+		    }
+		    return true;
+	    } );
+	return count;
+}
+
+// Prime search.
+// A single search tests the odd candidates one by one : the gap to the next prime is a few dozen numbers and
+// is_prime() already rejects most of them by trial division, so the divisions that set up a sieve window are not
+// repaid ( measured with UInt64Bench next_prime ). Runs of primes sieve windows by the primes below search_sieve_bound
+// and carry the offsets from one window to the next, so only the first window divides.
+const uint32_t search_sieve_bound = 1U << 12;
+// Odd candidates per window : doubles from search_first_window, a prime gap near 2^64, up to search_window.
+const size_t search_first_window = 32;
+const size_t search_window = 256;
+
+struct search_prime {
+	uint32_t p;
+	uint32_t half;   // ( p + 1 ) / 2 = 2^-1 % p
+	uint64_t magic;  // floor( ( 2^64 - 1 ) / p ) + 1 : x % p for x < 2^32 by two multiplications ( Lemire )
+};
+
+// Sieving primes grouped so that the product of a group fits 32 bits :
+// n % p = ( n % product ) % p, one Barrett reduction per group.
+struct search_group {
+	Barrett64 product;
+	size_t end;  // primes of the group : [ previous end, end )
+};
+
+struct search_primes {
+	std::vector<search_prime> primes;
+	std::vector<search_group> groups;
+};
+
+static const search_primes &get_search_primes() {
+	static const search_primes table = [] {
+		search_primes t;
+		std::vector<uint32_t> primes{ 3, 5 };
+		for ( const uint32_t p : sieving_primes( search_sieve_bound ) ) {
+			primes.push_back( p );
+		}
+		uint64_t product = 1;
+		for ( const uint32_t p : primes ) {
+			if ( product > 0xFFFF'FFFFU / p ) {
+				t.groups.push_back( search_group{ Barrett64( product ), t.primes.size() } );
+				product = 1;
+			}
+			product *= p;
+			t.primes.push_back( search_prime{ p, ( p + 1 ) / 2, 0xFFFF'FFFF'FFFF'FFFFULL / p + 1 } );
+		}
+		t.groups.push_back( search_group{ Barrett64( product ), t.primes.size() } );
+		return t;
+	}();
+	return table;
+}
+
+inline uint32_t search_mod( const uint64_t x, const search_prime &sp ) {
+	uint64_t hi = 0;
+	umul128( sp.magic * x, sp.p, &hi );
+	return static_cast<uint32_t>( hi );
+}
+
+/**
+ * search_sieve
+ * Sieves consecutive windows of odd candidates base, base + 2, ... by the primes 3 <= p < search_sieve_bound.
+ */
+class search_sieve {
+   public:
+	/**
+	 * search_sieve( uint64_t base )
+	 * @param base odd, base >= 3
+	 */
+	explicit search_sieve( const uint64_t base ) : table_( get_search_primes() ), offset_( table_.primes.size() ) {
+		size_t begin = 0;
+		for ( auto &&group : table_.groups ) {
+			const uint64_t r = group.product.reduce( base );
+			for ( size_t j = begin; j < group.end; j++ ) {
+				const search_prime &sp = table_.primes[ j ];
+				const uint64_t square = static_cast<uint64_t>( sp.p ) * sp.p;
+				// base + 2i ≡ 0 ( mod p ) : i ≡ -base / 2 ( mod p ). Below p^2, start at p^2 so p itself is kept.
+				offset_[ j ] = ( base <= square ) ? static_cast<uint32_t>( ( square - base ) / 2 )
+				                                  : search_mod( ( sp.p - search_mod( r, sp ) ) * sp.half, sp );
+			}
+			begin = group.end;
+		}
+	}
+
+	/**
+	 * next( size_t count, uint8_t *composite )
+	 * Sieves the next count candidates, the first window starts at base.
+	 * @param composite out : composite[ i ] != 0 if the i-th candidate has a sieving prime factor other than itself
+	 */
+	void next( const size_t count, uint8_t *composite ) {
+		memset( composite, 0, count );
+		for ( size_t j = 0; j < offset_.size(); j++ ) {
+			const uint32_t p = table_.primes[ j ].p;
+			size_t i = offset_[ j ];
+			for ( ; i < count; i += p ) {
+				composite[ i ] = 1;
+			}
+			offset_[ j ] = static_cast<uint32_t>( i - count );
+		}
+	}
+
+   private:
+	const search_primes &table_;
+	std::vector<uint32_t> offset_;  // index of the next multiple of each sieving prime in the next window
+};
+
+/**
+ * search_up( uint64_t lo, uint64_t hi, F on_prime )
+ * Calls on_prime( p ) for the primes lo <= p <= hi in increasing order until it returns false.
+ * @return false if on_prime() stopped the search
+ */
+template <typename OnPrime>
+static bool search_up( const uint64_t lo, const uint64_t hi, OnPrime on_prime ) {
+	if ( lo > hi || hi < 2 ) {
+		return true;
+	}
+	if ( lo <= 2 && !on_prime( 2 ) ) {
+		return false;
+	}
+	uint64_t base = ( lo <= 3 ) ? 3 : ( lo | 1 );
+	if ( base > hi ) {
+		return true;
+	}
+	// No prime factor below search_sieve_bound : survivors below its square are prime.
+	const uint64_t square = static_cast<uint64_t>( search_sieve_bound ) * search_sieve_bound;
+	search_sieve sieve( base );
+	uint8_t composite[ search_window ];
+	for ( size_t window = search_first_window;; window = ( window < search_window ) ? window * 2 : window ) {
+		const uint64_t left = ( hi - base ) / 2 + 1;
+		const size_t count = ( left < window ) ? static_cast<size_t>( left ) : window;
+		sieve.next( count, composite );
+		for ( size_t i = 0; i < count; i++ ) {
+			const uint64_t n = base + 2 * i;
+			if ( !composite[ i ] && ( n < square || is_prime( n ) ) && !on_prime( n ) ) {
+				return false;
+			}
+		}
+		if ( count == left ) {
+			return true;
+		}
+		base += 2 * count;
+	}
+}
+
+/**
+ * first_prime( uint64_t lo, uint64_t hi )
+ * @return the smallest prime lo <= p <= hi, 0 if there is none
+ */
+static uint64_t first_prime( const uint64_t lo, const uint64_t hi ) {
+	if ( lo > hi || hi < 2 ) {
+		return 0;
+	}
+	if ( lo <= 2 ) {
+		return 2;
+	}
+	for ( uint64_t n = lo | 1; n <= hi; n += 2 ) {
+		if ( is_prime( n ) ) {
+			return n;
+		}
+		if ( hi - n < 2 ) {
+			break;
+		}
+	}
+	return 0;
+}
+
+/**
+ * next_prime( uint64_t n )
+ * @param n
+ * @return the smallest prime > n
+ */
+uint64_t next_prime( const uint64_t n ) {
+	const uint64_t max = std::numeric_limits<uint64_t>::max();
+	const uint64_t p = ( n == max ) ? 0 : first_prime( n + 1, max );
+	if ( p == 0 ) {
+		throw std::overflow_error( "No 64-bit prime above n." );
+	}
+	return p;
+}
+
+/**
+ * prev_prime( uint64_t n )
+ * @param n n >= 3
+ * @return the largest prime < n
+ */
+uint64_t prev_prime( const uint64_t n ) {
+	if ( n <= 2 ) {
+		throw std::invalid_argument( "No prime below 2." );
+	}
+	if ( n == 3 ) {
+		return 2;
+	}
+	// Largest odd < n. 3 is prime, the loop stops there.
+	uint64_t m = ( n - 2 ) | 1;
+	while ( !is_prime( m ) ) {
+		m -= 2;
+	}
+	return m;
+}
+
+/**
+ * next_primes( uint64_t n, size_t k )
+ * @param n
+ * @param k
+ * @return the k smallest primes > n in increasing order
+ */
+std::vector<uint64_t> next_primes( const uint64_t n, const size_t k ) {
+	std::vector<uint64_t> primes;
+	if ( k == 0 ) {
+		return primes;
+	}
+	primes.reserve( k );
+	const uint64_t max = std::numeric_limits<uint64_t>::max();
+	const auto take = [ & ]( const uint64_t p ) {
+		primes.push_back( p );
+		return primes.size() < k;
+	};
+	if ( n == max || search_up( n + 1, max, take ) ) {
+		throw std::overflow_error( "No 64-bit prime above n." );
+	}
+	return primes;
+}
+
+/**
+ * random_prime( int bits, std::mt19937_64 &rng )
+ * The first prime at or after a uniform random starting point, wrapping around to 2^( bits - 1 ).
+ * Primes after long gaps are more likely than others.
+ * @param bits 2 <= bits <= 64
+ * @param rng
+ * @return a prime 2^( bits - 1 ) <= p < 2^bits
+ */
+uint64_t random_prime( const int bits, std::mt19937_64 &rng ) {
+	if ( bits < 2 || bits > 64 ) {
+		throw std::invalid_argument( "bits must be in [ 2, 64 ]." );
+	}
+	const uint64_t lo = 1ULL << ( bits - 1 );
+	const uint64_t hi = lo | ( lo - 1 );
+	const uint64_t start = ( rng() & hi ) | lo;
+	// There is a prime in [ lo, 2 lo ) ( Bertrand ).
+	const uint64_t p = first_prime( start, hi );
+	return ( p != 0 ) ? p : first_prime( lo, start - 1 );
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <random>
+#include <vector>
+
+// Segmented sieve of Eratosthenes.
+// Wheel-30 bitset : one byte holds the 8 numbers coprime to 30 in [ 30k, 30k + 30 ).
+// Segments are L1 / L2 sized. When sqrt( hi ) is large compared with the range, the range is only pre-sieved by
+// small primes and the survivors are checked by is_prime().
+
+std::vector<uint64_t> primes_in_range( uint64_t lo, uint64_t hi );
+uint64_t count_primes( uint64_t lo, uint64_t hi );
+
+// Prime search.
+// next_primes() sieves windows of odd candidates by the primes below 2^12 and only the survivors reach Miller-Rabin in
+// is_prime(). The single searches test candidates with is_prime() directly.
+
+uint64_t next_prime( uint64_t n );
+uint64_t prev_prime( uint64_t n );
+std::vector<uint64_t> next_primes( uint64_t n, size_t k );
+uint64_t random_prime( int bits, std::mt19937_64 &rng );
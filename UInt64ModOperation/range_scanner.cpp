@@ -0,0 +1,340 @@
+#include "range_scanner.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * chunk_scheduler
+ * Every thread owns a contiguous range of chunk indices and takes chunks from its front.
+ * A thread whose range is empty steals the upper half of another thread's range.
+ */
+class chunk_scheduler {
+   public:
+	chunk_scheduler( const uint64_t chunks, const unsigned threads ) {
+		for ( unsigned i = 0; i < threads; i++ ) {
+			auto r = std::make_unique<worker_range>();
+			r->begin = chunks / threads * i + ( i < chunks % threads ? i : chunks % threads );
+			r->end = r->begin + chunks / threads + ( i < chunks % threads ? 1 : 0 );
+			ranges_.push_back( std::move( r ) );
+		}
+	}
+
+	/**
+	 * next( unsigned self, uint64_t *chunk )
+	 * @param self thread index
+	 * @param chunk [out] chunk index
+	 * @return false if no chunk is left
+	 */
+	bool next( const unsigned self, uint64_t *chunk ) {
+		if ( pop( self, chunk ) ) {
+			return true;
+		}
+		const unsigned threads = static_cast<unsigned>( ranges_.size() );
+		for ( unsigned i = 1; i < threads; i++ ) {
+			worker_range &victim = *ranges_[ ( self + i ) % threads ];
+			uint64_t begin, end;
+			{
+				std::lock_guard<std::mutex> guard( victim.lock );
+				if ( victim.begin == victim.end ) {
+					continue;
+				}
+				// Take the upper half, or the last chunk.
+				begin = victim.begin + ( victim.end - victim.begin ) / 2;
+				end = victim.end;
+				victim.end = begin;
+			}
+			*chunk = begin;
+			worker_range &own = *ranges_[ self ];
+			std::lock_guard<std::mutex> guard( own.lock );
+			own.begin = begin + 1;
+			own.end = end;
+			return true;
+		}
+		return false;
+	}
+
+	void stop() {}
+
+   private:
+	struct alignas( 64 ) worker_range {
+		std::mutex lock;
+		uint64_t begin = 0;
+		uint64_t end = 0;
+	};
+
+	bool pop( const unsigned self, uint64_t *chunk ) {
+		worker_range &own = *ranges_[ self ];
+		std::lock_guard<std::mutex> guard( own.lock );
+		if ( own.begin == own.end ) {
+			return false;
+		}
+		*chunk = own.begin++;
+		return true;
+	}
+
+	std::vector<std::unique_ptr<worker_range>> ranges_;
+};
+
+/**
+ * ordered_emitter
+ * Chunks are handed out in increasing order, at most window ahead of the oldest chunk not yet emitted, so that at
+ * most window finished chunks wait for an earlier one.
+ */
+class ordered_emitter {
+   public:
+	ordered_emitter( const uint64_t chunks, const uint64_t window, const std::function<void( uint64_t )> &callback )
+	    : chunks_( chunks ), window_( window ), callback_( callback ) {}
+
+	/**
+	 * next( unsigned self, uint64_t *chunk )
+	 * Waits while the window is full.
+	 * @return false if no chunk is left, or after stop()
+	 */
+	bool next( unsigned, uint64_t *chunk ) {
+		std::unique_lock<std::mutex> guard( lock_ );
+		// Timed wait : the untimed one needs a newer libstdc++ runtime ( GLIBCXX_3.4.30 ) than some toolchains ship.
+		while ( !ready_.wait_for( guard, std::chrono::milliseconds( 10 ),
+		                          [ & ] { return stopped_ || issued_ == chunks_ || issued_ - next_emit_ < window_; } ) ) {
+		}
+		if ( stopped_ || issued_ == chunks_ ) {
+			return false;
+		}
+		*chunk = issued_++;
+		return true;
+	}
+
+	/**
+	 * emit( uint64_t chunk, std::vector<uint64_t> &&found )
+	 * Calls callback for found, and for every waiting chunk that follows, once every earlier chunk has been emitted.
+	 */
+	void emit( const uint64_t chunk, std::vector<uint64_t> &&found ) {
+		std::lock_guard<std::mutex> guard( lock_ );
+		pending_.emplace( chunk, std::move( found ) );
+		const uint64_t emitted = next_emit_;
+		while ( !pending_.empty() && pending_.begin()->first == next_emit_ ) {
+			for ( auto &&x : pending_.begin()->second ) {
+				callback_( x );
+			}
+			pending_.erase( pending_.begin() );
+			next_emit_++;
+		}
+		if ( next_emit_ != emitted ) {
+			ready_.notify_all();
+		}
+	}
+
+	void stop() {
+		std::lock_guard<std::mutex> guard( lock_ );
+		stopped_ = true;
+		ready_.notify_all();
+	}
+
+   private:
+	const uint64_t chunks_;
+	const uint64_t window_;
+	const std::function<void( uint64_t )> &callback_;
+	std::mutex lock_;
+	std::condition_variable ready_;
+	uint64_t issued_ = 0;
+	uint64_t next_emit_ = 0;
+	bool stopped_ = false;
+	std::map<uint64_t, std::vector<uint64_t>> pending_;
+};
+
+/**
+ * scan_threads( uint64_t chunks, const range_scan_options &options )
+ * @return worker threads : options.threads, or the hardware concurrency, at most chunks
+ */
+static unsigned scan_threads( const uint64_t chunks, const range_scan_options &options ) {
+	unsigned threads = options.threads;
+	if ( threads == 0 ) {
+		threads = std::thread::hardware_concurrency();
+	}
+	if ( threads == 0 ) {
+		threads = 1;
+	}
+	if ( threads > chunks ) {
+		threads = static_cast<unsigned>( chunks );
+	}
+	return threads;
+}
+
+static uint64_t scan_chunk_size( const range_scan_options &options ) { return ( options.chunk == 0 ) ? 1 : options.chunk; }
+
+/**
+ * run_chunks( uint64_t lo, uint64_t hi, const range_scan_options &options, Scheduler &scheduler, F process )
+ * Calls process( thread, chunk, first, last ) for every chunk [ first, last ] of [ lo, hi ] handed out by scheduler.
+ * The first exception thrown by process stops the scan and is rethrown.
+ */
+template <typename Scheduler, typename F>
+static void run_chunks( const uint64_t lo, const uint64_t hi, const unsigned threads, const uint64_t chunk_size,
+                        Scheduler &scheduler, F process ) {
+	std::atomic<bool> failed( false );
+	std::exception_ptr error;
+	std::mutex error_lock;
+
+	auto worker = [ & ]( const unsigned self ) {
+		try {
+			uint64_t chunk;
+			while ( !failed.load( std::memory_order_relaxed ) && scheduler.next( self, &chunk ) ) {
+				const uint64_t first = lo + chunk * chunk_size;
+				const uint64_t last = ( hi - first < chunk_size ) ? hi : first + chunk_size - 1;
+				process( self, chunk, first, last );
+			}
+		} catch ( ... ) {
+			std::lock_guard<std::mutex> guard( error_lock );
+			if ( !error ) {
+				error = std::current_exception();
+			}
+			failed = true;
+			scheduler.stop();
+		}
+	};
+
+	if ( threads == 1 ) {
+		worker( 0 );
+	} else {
+		std::vector<std::thread> pool;
+		for ( unsigned i = 0; i < threads; i++ ) {
+			pool.emplace_back( worker, i );
+		}
+		for ( auto &&t : pool ) {
+			t.join();
+		}
+	}
+	if ( error ) {
+		std::rethrow_exception( error );
+	}
+}
+
+/**
+ * run_chunks( uint64_t lo, uint64_t hi, const range_scan_options &options, F process )
+ * run_chunks() over a work-stealing chunk_scheduler.
+ */
+template <typename F>
+static void run_chunks( const uint64_t lo, const uint64_t hi, const range_scan_options &options, F process ) {
+	if ( lo > hi ) {
+		return;
+	}
+	const uint64_t chunk_size = scan_chunk_size( options );
+	const uint64_t chunks = ( hi - lo ) / chunk_size + 1;
+	const unsigned threads = scan_threads( chunks, options );
+	chunk_scheduler scheduler( chunks, threads );
+	run_chunks( lo, hi, threads, chunk_size, scheduler, process );
+}
+
+/**
+ * ordered_for_each( uint64_t lo, uint64_t hi, range_predicate pred, const std::function<void( uint64_t )> &callback,
+ *                   const range_scan_options &options )
+ * parallel_for_each() in increasing order, one callback at a time.
+ */
+static void ordered_for_each( const uint64_t lo, const uint64_t hi, const range_predicate pred,
+                              const std::function<void( uint64_t )> &callback, const range_scan_options &options ) {
+	if ( lo > hi ) {
+		return;
+	}
+	const uint64_t chunk_size = scan_chunk_size( options );
+	const uint64_t chunks = ( hi - lo ) / chunk_size + 1;
+	const unsigned threads = scan_threads( chunks, options );
+	const uint64_t window = ( options.window == 0 ) ? 4 * static_cast<uint64_t>( threads ) : options.window;
+	ordered_emitter emitter( chunks, window, callback );
+
+	run_chunks( lo, hi, threads, chunk_size, emitter,
+	            [ & ]( unsigned, const uint64_t chunk, const uint64_t first, const uint64_t last ) {
+		            std::vector<uint64_t> found;
+		            for ( uint64_t x = first;; x++ ) {
+			            if ( pred( x ) ) {
+				            found.push_back( x );
+			            }
+			            if ( x == last ) {
+				            break;
+			            }
+		            }
+		            emitter.emit( chunk, std::move( found ) );
+	            } );
+}
+
+/**
+ * parallel_count( uint64_t lo, uint64_t hi, range_predicate pred, const range_scan_options &options )
+ * @param lo
+ * @param hi
+ * @param pred is_prime, is_square, ...
+ * @param options
+ * @return number of x in [ lo, hi ] with pred( x )
+ */
+uint64_t parallel_count( const uint64_t lo, const uint64_t hi, const range_predicate pred,
+                         const range_scan_options &options ) {
+	std::atomic<uint64_t> count( 0 );
+	run_chunks( lo, hi, options, [ & ]( unsigned, uint64_t, const uint64_t first, const uint64_t last ) {
+		uint64_t n = 0;
+		for ( uint64_t x = first;; x++ ) {
+			n += pred( x ) ? 1 : 0;
+			if ( x == last ) {
+				break;
+			}
+		}
+		count += n;
+	} );
+	return count;
+}
+
+/**
+ * parallel_for_each( uint64_t lo, uint64_t hi, range_predicate pred, const std::function<void( uint64_t )> &callback,
+ *                    const range_scan_options &options )
+ * Calls callback( x ) for every x in [ lo, hi ] with pred( x ).
+ * options.ordered : callback is called in increasing order, one call at a time.
+ * otherwise       : callback is called concurrently from the worker threads.
+ */
+void parallel_for_each( const uint64_t lo, const uint64_t hi, const range_predicate pred,
+                        const std::function<void( uint64_t )> &callback, const range_scan_options &options ) {
+	if ( !options.ordered ) {
+		run_chunks( lo, hi, options, [ & ]( unsigned, uint64_t, const uint64_t first, const uint64_t last ) {
+			for ( uint64_t x = first;; x++ ) {
+				if ( pred( x ) ) {
+					callback( x );
+				}
+				if ( x == last ) {
+					break;
+				}
+			}
+		} );
+		return;
+	}
+
+	ordered_for_each( lo, hi, pred, callback, options );
+}
+
+/**
+ * parallel_collect( uint64_t lo, uint64_t hi, range_predicate pred, const range_scan_options &options )
+ * @return every x in [ lo, hi ] with pred( x ), in increasing order if options.ordered
+ */
+std::vector<uint64_t> parallel_collect( const uint64_t lo, const uint64_t hi, const range_predicate pred,
+                                        const range_scan_options &options ) {
+	std::vector<uint64_t> found;
+	if ( options.ordered ) {
+		parallel_for_each( lo, hi, pred, [ & ]( const uint64_t x ) { found.push_back( x ); }, options );
+		return found;
+	}
+
+	std::mutex found_lock;
+	run_chunks( lo, hi, options, [ & ]( unsigned, uint64_t, const uint64_t first, const uint64_t last ) {
+		std::vector<uint64_t> local;
+		for ( uint64_t x = first;; x++ ) {
+			if ( pred( x ) ) {
+				local.push_back( x );
+			}
+			if ( x == last ) {
+				break;
+			}
+		}
+		std::lock_guard<std::mutex> guard( found_lock );
+		found.insert( found.end(), local.begin(), local.end() );
+	} );
+	return found;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+// Parallel scan of [ lo, hi ] with a predicate such as is_prime() or is_square().
+// The range is split into chunks, and idle threads steal chunks from the other threads.
+// Ordered scans hand out chunks in increasing order instead, at most window chunks ahead of the oldest one not yet
+// emitted : at most window chunks of results are held back.
+
+struct range_scan_options {
+	unsigned threads = 0;      // 0 : std::thread::hardware_concurrency()
+	uint64_t chunk = 1 << 14;  // numbers per chunk
+	bool ordered = true;       // parallel_collect / parallel_for_each return values in increasing order
+	uint64_t window = 0;       // ordered : chunks in flight ahead of the oldest one not emitted, 0 : 4 * threads
+};
+
+using range_predicate = bool ( * )( uint64_t );
+
+uint64_t parallel_count( uint64_t lo, uint64_t hi, range_predicate pred, const range_scan_options &options = {} );
+std::vector<uint64_t> parallel_collect( uint64_t lo, uint64_t hi, range_predicate pred,
+                                        const range_scan_options &options = {} );
+void parallel_for_each( uint64_t lo, uint64_t hi, range_predicate pred, const std::function<void( uint64_t )> &callback,
+                        const range_scan_options &options = {} );
@@ -0,0 +1,182 @@
+#include "rns64.h"
+
+#include <stdexcept>
+
+RnsBasis::RnsBasis( const std::vector<uint64_t> &moduli ) {
+	if ( moduli.empty() ) {
+		throw std::invalid_argument( "The basis needs at least one modulus." );
+	}
+	const size_t n = moduli.size();
+	for ( size_t k = 0; k < n; k++ ) {
+		if ( ( moduli[ k ] & 1 ) == 0 || moduli[ k ] == 1 ) {
+			throw std::invalid_argument( "Moduli must be odd and greater than 1." );
+		}
+		for ( size_t j = 0; j < k; j++ ) {
+			if ( ugcd64( moduli[ j ], moduli[ k ] ) != 1 ) {
+				throw std::invalid_argument( "Moduli must be pairwise coprime." );
+			}
+		}
+	}
+
+	mod_ = moduli;
+	inv_.resize( n );
+	for ( size_t k = 0; k < n; k++ ) {
+		contexts_.emplace_back( moduli[ k ] );
+		uint64_t inv = moduli[ k ];
+		for ( int i = 0; i < 5; i++ ) {
+			inv *= 2 - moduli[ k ] * inv;
+		}
+		inv_[ k ] = inv;
+	}
+
+	garner_.assign( n * n, 0 );
+	for ( size_t k = 0; k < n; k++ ) {
+		const Montgomery64 &mg = contexts_[ k ];
+		uint64_t prefix = mg.one();
+		for ( size_t j = 0; j < k; j++ ) {
+			garner_[ k * n + j ] = mg.to_mont( moduli[ j ] );
+			prefix = mg.mul( prefix, garner_[ k * n + j ] );
+		}
+		garner_[ k * n + k ] = mg.inverse( prefix );
+	}
+
+	product_.assign( 1, 1 );
+	for ( size_t k = 0; k < n; k++ ) {
+		uint64_t carry = 0;
+		for ( auto &&limb : product_ ) {
+			uint64_t hi = 0;
+			const uint64_t lo = umul128( limb, moduli[ k ], &hi );
+			limb = lo + carry;
+			carry = hi + ( ( limb < lo ) ? 1 : 0 );
+		}
+		if ( carry ) {
+			product_.push_back( carry );
+		}
+	}
+}
+
+RnsVector RnsBasis::make_vector( const size_t length ) const {
+	// 0 is 0 in Montgomery form.
+	return RnsVector{ length, std::vector<uint64_t>( length * size(), 0 ) };
+}
+
+void RnsBasis::set( RnsVector &v, const size_t i, const uint64_t x ) const {
+	uint64_t *r = v.residues.data() + i * size();
+	for ( size_t k = 0; k < size(); k++ ) {
+		r[ k ] = contexts_[ k ].to_mont( x );
+	}
+}
+
+/**
+ * set( RnsVector &v, size_t i, const std::vector<uint64_t> &limbs )
+ * Horner from the top limb : x = ( ... ( l[ top ] * 2^64 + l[ top - 1 ] ) * 2^64 + ... ) + l[ 0 ], reduced mod M.
+ */
+void RnsBasis::set( RnsVector &v, const size_t i, const std::vector<uint64_t> &limbs ) const {
+	uint64_t *r = v.residues.data() + i * size();
+	for ( size_t k = 0; k < size(); k++ ) {
+		const Montgomery64 &mg = contexts_[ k ];
+		// 2^64 % m in Montgomery form : R^2 % m
+		const uint64_t radix = mg.to_mont( mg.one() );
+		uint64_t x = 0;
+		for ( size_t l = limbs.size(); l-- > 0; ) {
+			x = mg.add( mg.mul( x, radix ), mg.to_mont( limbs[ l ] ) );
+		}
+		r[ k ] = x;
+	}
+}
+
+std::vector<uint64_t> RnsBasis::get( const RnsVector &v, const size_t i ) const {
+	const size_t n = size();
+	const uint64_t *r = v.residues.data() + i * n;
+
+	// x = d[ 0 ] + d[ 1 ] * m[ 0 ] + d[ 2 ] * m[ 0 ] * m[ 1 ] + ..., d[ k ] < m[ k ]
+	std::vector<uint64_t> digits( n );
+	for ( size_t k = 0; k < n; k++ ) {
+		const Montgomery64 &mg = contexts_[ k ];
+		const uint64_t *g = garner_.data() + k * n;
+		// ( d[ 0 ] + ... + d[ k - 1 ] * m[ 0 ] * ... * m[ k - 2 ] ) % m[ k ], Horner
+		uint64_t t = 0;
+		for ( size_t j = k; j-- > 0; ) {
+			t = mg.add( mg.mul( t, g[ j ] ), mg.to_mont( digits[ j ] ) );
+		}
+		digits[ k ] = mg.from_mont( mg.mul( mg.sub( r[ k ], t ), g[ k ] ) );
+	}
+
+	// Horner in multiprecision : x = ( ... d[ n - 1 ] * m[ n - 2 ] + d[ n - 2 ] ) * m[ n - 3 ] + ...
+	std::vector<uint64_t> x{ digits[ n - 1 ] };
+	for ( size_t j = n - 1; j-- > 0; ) {
+		uint64_t carry = digits[ j ];
+		for ( auto &&limb : x ) {
+			uint64_t hi = 0;
+			const uint64_t lo = umul128( limb, mod_[ j ], &hi );
+			limb = lo + carry;
+			carry = hi + ( ( limb < lo ) ? 1 : 0 );
+		}
+		if ( carry ) {
+			x.push_back( carry );
+		}
+	}
+	while ( !x.empty() && x.back() == 0 ) {
+		x.pop_back();
+	}
+	return x;
+}
+
+void RnsBasis::check( const RnsVector &a, const RnsVector &b, RnsVector &out ) const {
+	if ( a.length != b.length || a.residues.size() != a.length * size() || b.residues.size() != b.length * size() ) {
+		throw std::invalid_argument( "RNS vectors do not match the basis." );
+	}
+	if ( out.length != a.length || out.residues.size() != a.residues.size() ) {
+		out.length = a.length;
+		out.residues.resize( a.residues.size() );
+	}
+}
+
+void RnsBasis::add( const RnsVector &a, const RnsVector &b, RnsVector &out ) const {
+	check( a, b, out );
+	const size_t n = size();
+	const uint64_t *m = mod_.data();
+	const uint64_t *x = a.residues.data();
+	const uint64_t *y = b.residues.data();
+	uint64_t *z = out.residues.data();
+	for ( size_t i = 0; i < a.length; i++, x += n, y += n, z += n ) {
+		for ( size_t k = 0; k < n; k++ ) {
+			const uint64_t s = x[ k ] + y[ k ];
+			// s < x : x + y overflowed.
+			z[ k ] = ( s < x[ k ] || s >= m[ k ] ) ? s - m[ k ] : s;
+		}
+	}
+}
+
+void RnsBasis::sub( const RnsVector &a, const RnsVector &b, RnsVector &out ) const {
+	check( a, b, out );
+	const size_t n = size();
+	const uint64_t *m = mod_.data();
+	const uint64_t *x = a.residues.data();
+	const uint64_t *y = b.residues.data();
+	uint64_t *z = out.residues.data();
+	for ( size_t i = 0; i < a.length; i++, x += n, y += n, z += n ) {
+		for ( size_t k = 0; k < n; k++ ) {
+			z[ k ] = ( x[ k ] < y[ k ] ) ? x[ k ] - y[ k ] + m[ k ] : x[ k ] - y[ k ];
+		}
+	}
+}
+
+void RnsBasis::mul( const RnsVector &a, const RnsVector &b, RnsVector &out ) const {
+	check( a, b, out );
+	const size_t n = size();
+	const uint64_t *m = mod_.data();
+	const uint64_t *inv = inv_.data();
+	const uint64_t *x = a.residues.data();
+	const uint64_t *y = b.residues.data();
+	uint64_t *z = out.residues.data();
+	for ( size_t i = 0; i < a.length; i++, x += n, y += n, z += n ) {
+		for ( size_t k = 0; k < n; k++ ) {
+			// Montgomery reduction, as Montgomery64::mul() with the constants of modulus k.
+			uint64_t hi = 0, mh = 0;
+			const uint64_t lo = umul128( x[ k ], y[ k ], &hi );
+			umul128( lo * inv[ k ], m[ k ], &mh );
+			z[ k ] = ( hi < mh ) ? hi - mh + m[ k ] : hi - mh;
+		}
+	}
+}
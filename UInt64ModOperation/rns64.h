@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "montgomery64.h"
+
+// Residue number system over odd, pairwise coprime 64-bit moduli m[ 0 ], ..., m[ N - 1 ].
+// An integer 0 <= x < M = m[ 0 ] * ... * m[ N - 1 ] is held as its N residues, in Montgomery form.
+// The moduli constants are stored as arrays ( structure of arrays ), and the N residues of one number are contiguous,
+// so the element-wise loops run across the moduli with no per-limb call to umulmod64() / umodinv64().
+// Multiprecision integers are little-endian vectors of 64-bit limbs.
+
+/**
+ * RnsVector
+ * length numbers, residues[ i * N + k ] is number i modulo m[ k ].
+ */
+struct RnsVector {
+	size_t length = 0;
+	std::vector<uint64_t> residues;
+};
+
+class RnsBasis {
+   public:
+	/**
+	 * RnsBasis( const std::vector<uint64_t> &moduli )
+	 * @param moduli odd, pairwise coprime, at least one
+	 */
+	explicit RnsBasis( const std::vector<uint64_t> &moduli );
+
+	size_t size() const { return mod_.size(); }
+	uint64_t modulus( const size_t k ) const { return mod_[ k ]; }
+
+	/**
+	 * product()
+	 * @return M = m[ 0 ] * ... * m[ N - 1 ], limbs
+	 */
+	const std::vector<uint64_t> &product() const { return product_; }
+
+	/**
+	 * make_vector( size_t length )
+	 * @return length zeros
+	 */
+	RnsVector make_vector( size_t length ) const;
+
+	void set( RnsVector &v, size_t i, uint64_t x ) const;
+	void set( RnsVector &v, size_t i, const std::vector<uint64_t> &limbs ) const;
+
+	/**
+	 * get( const RnsVector &v, size_t i )
+	 * Garner's mixed-radix reconstruction.
+	 * @return number i of v, 0 <= x < M, limbs without leading zeros ( empty for 0 )
+	 */
+	std::vector<uint64_t> get( const RnsVector &v, size_t i ) const;
+
+	// out = a op b % M, element-wise. out may alias a or b.
+	void add( const RnsVector &a, const RnsVector &b, RnsVector &out ) const;
+	void sub( const RnsVector &a, const RnsVector &b, RnsVector &out ) const;
+	void mul( const RnsVector &a, const RnsVector &b, RnsVector &out ) const;
+
+   private:
+	void check( const RnsVector &a, const RnsVector &b, RnsVector &out ) const;
+
+	std::vector<Montgomery64> contexts_;
+	// Structure of arrays for the element-wise loops.
+	std::vector<uint64_t> mod_;
+	std::vector<uint64_t> inv_;  // mod^-1 % 2^64
+	// Garner : garner_[ k * N + j ] = m[ j ] % m[ k ] ( j < k ), garner_[ k * N + k ] = ( m[ 0 ] * ... * m[ k - 1 ] )^-1 % m[ k ].
+	// Montgomery form.
+	std::vector<uint64_t> garner_;
+	std::vector<uint64_t> product_;
+};
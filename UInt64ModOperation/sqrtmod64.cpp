@@ -0,0 +1,178 @@
+#include "sqrtmod64.h"
+
+#include <stdexcept>
+
+#include "montgomery64.h"
+#include "uint64_mod_operation.h"
+
+// p - 1 = q * 2^s : above this s, Cipolla ( ~ 2 log p multiplications in F_p^2 ) beats Tonelli-Shanks ( ~ s^2 / 4 ).
+const int cipolla_min_twos = 32;
+
+// Cipolla : t^2 - a is a non-residue for half of t if p is a prime. Check p once this many t have failed.
+const int cipolla_prime_check = 64;
+
+/**
+ * jacobi64( uint64_t a, uint64_t n )
+ * Binary Jacobi symbol. a need not be reduced.
+ * @param a
+ * @param n odd
+ * @return ( a / n ) : 1, -1, or 0 if gcd( a, n ) > 1
+ */
+int jacobi64( uint64_t a, uint64_t n ) {
+	if ( ( n & 1 ) == 0 ) {
+		throw std::invalid_argument( "n must be odd." );
+	}
+	int t = 1;
+	while ( a != 0 ) {
+		// ( 2 / n ) = -1 iff n ≡ 3, 5 ( mod 8 )
+		const int twos = utzcnt64( a );
+		a >>= twos;
+		if ( ( twos & 1 ) && ( ( n & 7 ) == 3 || ( n & 7 ) == 5 ) ) {
+			t = -t;
+		}
+		// Reciprocity : ( a / n ) = -( n / a ) iff a ≡ n ≡ 3 ( mod 4 )
+		if ( a < n ) {
+			const uint64_t x = a;
+			a = n;
+			n = x;
+			if ( a & n & 2 ) {
+				t = -t;
+			}
+		}
+		// a, n odd : ( a / n ) = ( ( a - n ) / n ), a - n is even.
+		a -= n;
+	}
+	return ( n == 1 ) ? t : 0;
+}
+
+/**
+ * tonelli_shanks( const Montgomery64 &mg, uint64_t a, uint64_t z, int s )
+ * @param a quadratic residue, Montgomery form
+ * @param z quadratic non-residue, Montgomery form
+ * @param s p - 1 = q * 2^s
+ * @return a root of a, Montgomery form. Throws std::invalid_argument if t = a^q has no order 2^i < 2^s : p is not a prime.
+ */
+static uint64_t tonelli_shanks( const Montgomery64 &mg, const uint64_t a, const uint64_t z, int s ) {
+	const uint64_t q = ( mg.modulus() - 1 ) >> s;
+	const uint64_t one = mg.one();
+	// r = a^( ( q + 1 ) / 2 ), t = a^q
+	const uint64_t x = mg.pow( a, q >> 1 );
+	uint64_t r = mg.mul( a, x );
+	uint64_t t = mg.mul( r, x );
+	uint64_t c = mg.pow( z, q );
+	while ( t != one ) {
+		// t has order 2^i
+		int i = 0;
+		for ( uint64_t u = t; u != one; u = mg.mul( u, u ) ) {
+			if ( ++i == s ) {
+				throw std::invalid_argument( "p must be a prime." );
+			}
+		}
+		uint64_t b = c;
+		for ( int j = 0; j < s - i - 1; j++ ) {
+			b = mg.mul( b, b );
+		}
+		r = mg.mul( r, b );
+		c = mg.mul( b, b );
+		t = mg.mul( t, c );
+		s = i;
+	}
+	return r;
+}
+
+/**
+ * cipolla( const Montgomery64 &mg, uint64_t a )
+ * ( t + sqrt( t^2 - a ) )^( ( p + 1 ) / 2 ) in F_p[ x ] / ( x^2 - w ), w = t^2 - a a non-residue.
+ * @param a quadratic residue, Montgomery form
+ * @return a root of a, Montgomery form. Throws std::invalid_argument if p is not a prime.
+ */
+static uint64_t cipolla( const Montgomery64 &mg, const uint64_t a ) {
+	const uint64_t p = mg.modulus();
+	uint64_t t = mg.one(), w = 0;
+	for ( int tries = 1;; tries++, t = mg.add( t, mg.one() ) ) {
+		w = mg.sub( mg.mul( t, t ), a );
+		const int j = jacobi64( mg.from_mont( w ), p );
+		if ( j == -1 ) {
+			break;
+		}
+		// gcd( w, p ) > 1 for w ≢ 0, or no non-residue turns up : p may not be a prime.
+		if ( ( j == 0 && w != 0 ) || ( tries == cipolla_prime_check && !is_prime( p ) ) ) {
+			throw std::invalid_argument( "p must be a prime." );
+		}
+	}
+	// ( x0 + x1 sqrt( w ) )^e
+	uint64_t r0 = mg.one(), r1 = 0;
+	uint64_t x0 = t, x1 = mg.one();
+	for ( uint64_t e = ( p >> 1 ) + 1; e; e >>= 1 ) {
+		if ( e & 1 ) {
+			const uint64_t y0 = mg.add( mg.mul( r0, x0 ), mg.mul( mg.mul( r1, x1 ), w ) );
+			r1 = mg.add( mg.mul( r0, x1 ), mg.mul( r1, x0 ) );
+			r0 = y0;
+		}
+		const uint64_t y0 = mg.add( mg.mul( x0, x0 ), mg.mul( mg.mul( x1, x1 ), w ) );
+		x1 = mg.mul( mg.add( x0, x0 ), x1 );
+		x0 = y0;
+	}
+	return r0;
+}
+
+/**
+ * sqrtmod64( uint64_t a, uint64_t p )
+ * @param a
+ * @param p prime
+ * @return r with r^2 ≡ a ( mod p ), the smaller of the two roots. Throws std::overflow_error if a is not a square,
+ *         std::invalid_argument if p is found not to be a prime.
+ */
+uint64_t sqrtmod64( uint64_t a, const uint64_t p ) {
+	if ( p < 2 ) {
+		throw std::invalid_argument( "p must be a prime." );
+	}
+	if ( a >= p ) {
+		a %= p;
+	}
+	if ( p == 2 || a <= 1 ) {
+		return a;
+	}
+	if ( jacobi64( a, p ) != 1 ) {
+		throw std::overflow_error( "The square root does not exist." );
+	}
+
+	const Montgomery64 mg( p );
+	const uint64_t ma = mg.to_mont( a );
+	uint64_t r;
+	if ( ( p & 3 ) == 3 ) {
+		// a^( ( p + 1 ) / 4 )
+		r = mg.pow( ma, ( p >> 2 ) + 1 );
+	} else if ( ( p & 7 ) == 5 ) {
+		// Atkin : b = ( 2a )^( ( p - 5 ) / 8 ), i = 2a b^2 ( i^2 = -1 ), r = a b ( i - 1 )
+		const uint64_t a2 = mg.add( ma, ma );
+		const uint64_t b = mg.pow( a2, p >> 3 );
+		const uint64_t i = mg.mul( a2, mg.mul( b, b ) );
+		r = mg.mul( mg.mul( ma, b ), mg.sub( i, mg.one() ) );
+	} else {
+		// ( x / p ) = 1 or 0 for every x if p is a square : there is no non-residue to search for.
+		if ( is_square( p ) ) {
+			throw std::invalid_argument( "p must be a prime." );
+		}
+		const int s = utzcnt64( p - 1 );
+		if ( s >= cipolla_min_twos ) {
+			r = cipolla( mg, ma );
+		} else {
+			// A non-residue below p exists as p is not a square, unless some z < p shares a factor with p first.
+			uint64_t z = 2;
+			for ( int j; ( j = jacobi64( z, p ) ) != -1; z++ ) {
+				if ( j == 0 ) {
+					throw std::invalid_argument( "p must be a prime." );
+				}
+			}
+			r = tonelli_shanks( mg, ma, mg.to_mont( z ), s );
+		}
+	}
+
+	// p is not a prime.
+	if ( mg.mul( r, r ) != ma ) {
+		throw std::invalid_argument( "p must be a prime." );
+	}
+	r = mg.from_mont( r );
+	return ( r > p - r ) ? p - r : r;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+// Jacobi symbol and square roots modulo a prime.
+// jacobi64() is the binary algorithm : shifts, subtractions and reciprocity, no division.
+// sqrtmod64() uses a^( ( p + 1 ) / 4 ) for p ≡ 3 ( mod 4 ), Atkin's formula for p ≡ 5 ( mod 8 ), otherwise
+// Tonelli-Shanks, or Cipolla when 2^s | p - 1 with large s. All in Montgomery form.
+
+int jacobi64( uint64_t a, uint64_t n );
+uint64_t sqrtmod64( uint64_t a, uint64_t p );
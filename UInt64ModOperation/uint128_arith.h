@@ -0,0 +1,224 @@
+#pragma once
+
+#include <stdint.h>
+
+// 128-bit multiply / divide backend.
+//   MSVC x64          : _umul128(), _udiv128(), _addcarry_u64(), _subborrow_u64(), __lzcnt64(), _tzcnt_u64(), __popcnt64()
+//   GCC/Clang x86-64  : unsigned __int128, mulq / divq, __builtin_clzll(), __builtin_ctzll(), __builtin_popcountll()
+//   GCC/Clang (other) : unsigned __int128, __builtin_clzll(), __builtin_ctzll(), __builtin_popcountll()
+//   otherwise         : portable C++ ( 32-bit limbs )
+// Define UINT64MOD_PORTABLE to force the portable C++ implementation.
+
+#if defined( UINT64MOD_PORTABLE )
+#define UINT64MOD_BACKEND_PORTABLE 1
+#elif defined( _MSC_VER ) && defined( _M_X64 ) && !defined( __clang__ )
+#define UINT64MOD_BACKEND_MSVC 1
+#include <intrin.h>
+#elif defined( __GNUC__ ) && defined( __SIZEOF_INT128__ )
+#define UINT64MOD_BACKEND_INT128 1
+#else
+#define UINT64MOD_BACKEND_PORTABLE 1
+#endif
+
+/**
+ * ulzcnt64( uint64_t x )
+ * @param x
+ * @return number of leading zero bits, 64 if x == 0
+ */
+inline int ulzcnt64( const uint64_t x ) {
+#if defined( UINT64MOD_BACKEND_MSVC )
+	return static_cast<int>( __lzcnt64( x ) );
+#elif defined( UINT64MOD_BACKEND_INT128 )
+	return x == 0 ? 64 : __builtin_clzll( x );
+#else
+	if ( x == 0 ) {
+		return 64;
+	}
+	int n = 0;
+	uint64_t t = x;
+	for ( int shift = 32; shift > 0; shift >>= 1 ) {
+		if ( ( t >> ( 64 - shift ) ) == 0 ) {
+			n += shift;
+			t <<= shift;
+		}
+	}
+	return n;
+#endif
+}
+
+/**
+ * utzcnt64( uint64_t x )
+ * @param x
+ * @return number of trailing zero bits, 64 if x == 0
+ */
+inline int utzcnt64( const uint64_t x ) {
+#if defined( UINT64MOD_BACKEND_MSVC )
+	return static_cast<int>( _tzcnt_u64( x ) );
+#elif defined( UINT64MOD_BACKEND_INT128 )
+	return x == 0 ? 64 : __builtin_ctzll( x );
+#else
+	if ( x == 0 ) {
+		return 64;
+	}
+	// x & -x isolates the lowest set bit.
+	return 63 - ulzcnt64( x & ( 0 - x ) );
+#endif
+}
+
+/**
+ * upopcnt64( uint64_t x )
+ * @param x
+ * @return number of set bits
+ */
+inline int upopcnt64( const uint64_t x ) {
+#if defined( UINT64MOD_BACKEND_MSVC )
+	return static_cast<int>( __popcnt64( x ) );
+#elif defined( UINT64MOD_BACKEND_INT128 )
+	return __builtin_popcountll( x );
+#else
+	uint64_t t = x - ( ( x >> 1 ) & 0x5555'5555'5555'5555 );
+	t = ( t & 0x3333'3333'3333'3333 ) + ( ( t >> 2 ) & 0x3333'3333'3333'3333 );
+	t = ( t + ( t >> 4 ) ) & 0x0F0F'0F0F'0F0F'0F0F;
+	return static_cast<int>( ( t * 0x0101'0101'0101'0101 ) >> 56 );
+#endif
+}
+
+/**
+ * uaddc64( uint64_t a, uint64_t b, uint64_t carry_in, uint64_t *carry_out )
+ * Add with carry, no branch.
+ * @param carry_in 0 or 1
+ * @param carry_out [out] 0 or 1
+ * @return lower 64 bits of a + b + carry_in
+ */
+inline uint64_t uaddc64( const uint64_t a, const uint64_t b, const uint64_t carry_in, uint64_t *carry_out ) {
+#if defined( UINT64MOD_BACKEND_MSVC )
+	unsigned long long s;
+	*carry_out = _addcarry_u64( static_cast<unsigned char>( carry_in ), a, b, &s );
+	return s;
+#elif defined( UINT64MOD_BACKEND_INT128 )
+	const unsigned __int128 s = static_cast<unsigned __int128>( a ) + b + carry_in;
+	*carry_out = static_cast<uint64_t>( s >> 64 );
+	return static_cast<uint64_t>( s );
+#else
+	const uint64_t s = a + b + carry_in;
+	// Carry out of the top bit : majority of a, b and not s.
+	*carry_out = ( ( a & b ) | ( ( a | b ) & ~s ) ) >> 63;
+	return s;
+#endif
+}
+
+/**
+ * usubb64( uint64_t a, uint64_t b, uint64_t borrow_in, uint64_t *borrow_out )
+ * Subtract with borrow, no branch.
+ * @param borrow_in 0 or 1
+ * @param borrow_out [out] 0 or 1
+ * @return lower 64 bits of a - b - borrow_in
+ */
+inline uint64_t usubb64( const uint64_t a, const uint64_t b, const uint64_t borrow_in, uint64_t *borrow_out ) {
+#if defined( UINT64MOD_BACKEND_MSVC )
+	unsigned long long d;
+	*borrow_out = _subborrow_u64( static_cast<unsigned char>( borrow_in ), a, b, &d );
+	return d;
+#elif defined( UINT64MOD_BACKEND_INT128 )
+	const unsigned __int128 d = static_cast<unsigned __int128>( a ) - b - borrow_in;
+	*borrow_out = static_cast<uint64_t>( d >> 64 ) & 1;
+	return static_cast<uint64_t>( d );
+#else
+	const uint64_t d = a - b - borrow_in;
+	*borrow_out = ( ( ~a & b ) | ( ~( a ^ b ) & d ) ) >> 63;
+	return d;
+#endif
+}
+
+/**
+ * umul128( uint64_t a, uint64_t b, uint64_t *hi )
+ * constexpr, for ModInt.
+ * @param a
+ * @param b
+ * @param hi [out] upper 64 bits of a * b
+ * @return lower 64 bits of a * b
+ */
+constexpr uint64_t umul128( const uint64_t a, const uint64_t b, uint64_t *hi ) {
+#if defined( UINT64MOD_BACKEND_INT128 )
+	const unsigned __int128 p = static_cast<unsigned __int128>( a ) * b;
+	*hi = static_cast<uint64_t>( p >> 64 );
+	return static_cast<uint64_t>( p );
+#else
+#if defined( UINT64MOD_BACKEND_MSVC )
+	// _umul128() is not constexpr : constant evaluation takes the portable path.
+	if ( !__builtin_is_constant_evaluated() ) {
+		return _umul128( a, b, hi );
+	}
+#endif
+	const uint64_t a0 = a & 0xFFFF'FFFF, a1 = a >> 32;
+	const uint64_t b0 = b & 0xFFFF'FFFF, b1 = b >> 32;
+	const uint64_t p00 = a0 * b0;
+	const uint64_t p01 = a0 * b1;
+	const uint64_t p10 = a1 * b0;
+	const uint64_t p11 = a1 * b1;
+	// middle : ( p00 >> 32 ) + lo32( p01 ) + lo32( p10 ) < 3 * 2^32
+	const uint64_t middle = ( p00 >> 32 ) + ( p01 & 0xFFFF'FFFF ) + ( p10 & 0xFFFF'FFFF );
+	*hi = p11 + ( p01 >> 32 ) + ( p10 >> 32 ) + ( middle >> 32 );
+	return ( middle << 32 ) | ( p00 & 0xFFFF'FFFF );
+#endif
+}
+
+/**
+ * udiv128( uint64_t hi, uint64_t lo, uint64_t d, uint64_t *rem )
+ * ( hi * 2^64 + lo ) / d. The quotient must fit in 64 bits : hi < d.
+ * @param hi upper 64 bits of dividend
+ * @param lo lower 64 bits of dividend
+ * @param d divisor
+ * @param rem [out] remainder
+ * @return quotient
+ */
+inline uint64_t udiv128( const uint64_t hi, const uint64_t lo, const uint64_t d, uint64_t *rem ) {
+#if defined( UINT64MOD_BACKEND_MSVC )
+	return _udiv128( hi, lo, d, rem );
+#elif defined( UINT64MOD_BACKEND_INT128 ) && defined( __x86_64__ )
+	// unsigned __int128 division calls __udivti3(). divq is a single instruction.
+	uint64_t q, r;
+	__asm__( "divq %4" : "=a"( q ), "=d"( r ) : "a"( lo ), "d"( hi ), "rm"( d ) );
+	*rem = r;
+	return q;
+#elif defined( UINT64MOD_BACKEND_INT128 )
+	const unsigned __int128 n = ( static_cast<unsigned __int128>( hi ) << 64 ) | lo;
+	*rem = static_cast<uint64_t>( n % d );
+	return static_cast<uint64_t>( n / d );
+#else
+	// Hacker's Delight, divlu().
+	const uint64_t b = 0x1'0000'0000;
+	const int s = ulzcnt64( d );
+	const uint64_t v = d << s;
+	const uint64_t vn1 = v >> 32;
+	const uint64_t vn0 = v & 0xFFFF'FFFF;
+	const uint64_t un32 = ( s == 0 ) ? hi : ( hi << s ) | ( lo >> ( 64 - s ) );
+	const uint64_t un10 = lo << s;
+	const uint64_t un1 = un10 >> 32;
+	const uint64_t un0 = un10 & 0xFFFF'FFFF;
+
+	uint64_t q1 = un32 / vn1;
+	uint64_t rhat = un32 - q1 * vn1;
+	while ( q1 >= b || q1 * vn0 > ( ( rhat << 32 ) | un1 ) ) {
+		q1--;
+		rhat += vn1;
+		if ( rhat >= b ) {
+			break;
+		}
+	}
+
+	const uint64_t un21 = ( un32 << 32 ) + un1 - q1 * v;
+	uint64_t q0 = un21 / vn1;
+	rhat = un21 - q0 * vn1;
+	while ( q0 >= b || q0 * vn0 > ( ( rhat << 32 ) | un0 ) ) {
+		q0--;
+		rhat += vn1;
+		if ( rhat >= b ) {
+			break;
+		}
+	}
+
+	*rem = ( ( un21 << 32 ) + un0 - q0 * v ) >> s;
+	return ( q1 << 32 ) | q0;
+#endif
+}
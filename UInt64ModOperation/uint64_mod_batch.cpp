@@ -0,0 +1,550 @@
+#include "uint64_mod_batch.h"
+
+#include "barrett64.h"
+#include "montgomery64.h"
+#include "uint64_mod_operation.h"
+
+#if defined( __x86_64__ ) || defined( _M_X64 )
+#define UINT64MOD_BATCH_X86 1
+#include <immintrin.h>
+#if defined( _MSC_VER ) && !defined( __clang__ )
+#include <intrin.h>
+#define UINT64MOD_TARGET( isa )
+#else
+#define UINT64MOD_TARGET( isa ) __attribute__( ( target( isa ) ) )
+#endif
+#endif
+
+/**
+ * Runtime kernel selection.
+ */
+batch_isa detect_batch_isa() {
+#if defined( UINT64MOD_BATCH_X86 ) && defined( _MSC_VER ) && !defined( __clang__ )
+	int info[ 4 ];
+	__cpuid( info, 0 );
+	if ( info[ 0 ] < 7 ) {
+		return batch_isa::scalar;
+	}
+	__cpuid( info, 1 );
+	// OSXSAVE
+	if ( ( info[ 2 ] & ( 1 << 27 ) ) == 0 ) {
+		return batch_isa::scalar;
+	}
+	const uint64_t xcr0 = _xgetbv( 0 );
+	__cpuidex( info, 7, 0 );
+	const bool avx2 = ( info[ 1 ] & ( 1 << 5 ) ) != 0 && ( xcr0 & 0x06 ) == 0x06;
+	const bool avx512ifma =
+	    ( info[ 1 ] & ( 1 << 16 ) ) != 0 && ( info[ 1 ] & ( 1 << 21 ) ) != 0 && ( xcr0 & 0xE6 ) == 0xE6;
+	if ( avx512ifma ) {
+		return batch_isa::avx512ifma;
+	}
+	return avx2 ? batch_isa::avx2 : batch_isa::scalar;
+#elif defined( UINT64MOD_BATCH_X86 )
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx512f" ) && __builtin_cpu_supports( "avx512ifma" ) ) {
+		return batch_isa::avx512ifma;
+	}
+	if ( __builtin_cpu_supports( "avx2" ) ) {
+		return batch_isa::avx2;
+	}
+	return batch_isa::scalar;
+#else
+	return batch_isa::scalar;
+#endif
+}
+
+static batch_isa selected_isa = detect_batch_isa();
+
+batch_isa get_batch_isa() { return selected_isa; }
+
+/**
+ * set_batch_isa( batch_isa isa )
+ * Selects the kernels. An instruction set the CPU does not support falls back to the best supported one.
+ * @param isa
+ */
+void set_batch_isa( const batch_isa isa ) {
+	const batch_isa supported = detect_batch_isa();
+	selected_isa = ( static_cast<int>( isa ) <= static_cast<int>( supported ) ) ? isa : supported;
+}
+
+/**
+ * Scalar kernels
+ */
+static void uaddmod64_scalar( const uint64_t *a, const uint64_t *b, uint64_t *out, const size_t n, const uint64_t mod ) {
+	for ( size_t i = 0; i < n; i++ ) {
+		if ( a[ i ] < mod && b[ i ] < mod ) {
+			const uint64_t s = a[ i ] + b[ i ];
+			out[ i ] = ( s < a[ i ] || s >= mod ) ? s - mod : s;
+		} else {
+			out[ i ] = uaddmod64( a[ i ], b[ i ], mod );
+		}
+	}
+}
+
+static void usubmod64_scalar( const uint64_t *a, const uint64_t *b, uint64_t *out, const size_t n, const uint64_t mod ) {
+	for ( size_t i = 0; i < n; i++ ) {
+		if ( a[ i ] < mod && b[ i ] < mod ) {
+			out[ i ] = ( a[ i ] < b[ i ] ) ? a[ i ] - b[ i ] + mod : a[ i ] - b[ i ];
+		} else {
+			out[ i ] = usubmod64( a[ i ], b[ i ], mod );
+		}
+	}
+}
+
+static void umulmod64_scalar( const uint64_t *a, const uint64_t *b, uint64_t *out, const size_t n, const uint64_t mod ) {
+	if ( ( mod & 1 ) == 0 ) {
+		const Barrett64 br( mod );
+		for ( size_t i = 0; i < n; i++ ) {
+			out[ i ] = umulmod64( a[ i ], b[ i ], br );
+		}
+		return;
+	}
+	// a * ( b * R ) * R^-1 = a * b
+	const Montgomery64 mg( mod );
+	for ( size_t i = 0; i < n; i++ ) {
+		const uint64_t x = ( a[ i ] < mod ) ? a[ i ] : a[ i ] % mod;
+		out[ i ] = mg.mul( x, mg.to_mont( b[ i ] ) );
+	}
+}
+
+static void powmod64_scalar( const uint64_t *a, const uint64_t *e, uint64_t *out, const size_t n, const uint64_t mod ) {
+	if ( ( mod & 1 ) == 0 || mod == 1 ) {
+		for ( size_t i = 0; i < n; i++ ) {
+			out[ i ] = powmod64( a[ i ], e[ i ], mod );
+		}
+		return;
+	}
+	const Montgomery64 mg( mod );
+	for ( size_t i = 0; i < n; i++ ) {
+		out[ i ] = mg.from_mont( mg.pow( mg.to_mont( a[ i ] ), e[ i ] ) );
+	}
+}
+
+#if defined( UINT64MOD_BATCH_X86 )
+
+/**
+ * AVX2 kernels
+ * add / sub : 4 x 64-bit lanes, any modulus.
+ * mul / pow : 4 x 32-bit Montgomery ( R = 2^32 ), odd mod < 2^32.
+ */
+
+// Unsigned 64-bit a < b.
+UINT64MOD_TARGET( "avx2" ) inline __m256i avx2_cmplt_epu64( const __m256i a, const __m256i b ) {
+	const __m256i sign = _mm256_set1_epi64x( static_cast<int64_t>( 0x8000'0000'0000'0000ULL ) );
+	return _mm256_cmpgt_epi64( _mm256_xor_si256( b, sign ), _mm256_xor_si256( a, sign ) );
+}
+
+// true if some lane of a or b is >= mod.
+UINT64MOD_TARGET( "avx2" ) inline bool avx2_any_ge( const __m256i a, const __m256i b, const __m256i mod ) {
+	const __m256i ok = _mm256_and_si256( avx2_cmplt_epu64( a, mod ), avx2_cmplt_epu64( b, mod ) );
+	return _mm256_movemask_epi8( ok ) != -1;
+}
+
+UINT64MOD_TARGET( "avx2" )
+static void uaddmod64_avx2( const uint64_t *a, const uint64_t *b, uint64_t *out, const size_t n, const uint64_t mod ) {
+	const __m256i vmod = _mm256_set1_epi64x( static_cast<int64_t>( mod ) );
+	size_t i = 0;
+	for ( ; i + 4 <= n; i += 4 ) {
+		const __m256i va = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( a + i ) );
+		const __m256i vb = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( b + i ) );
+		if ( avx2_any_ge( va, vb, vmod ) ) {
+			uaddmod64_scalar( a + i, b + i, out + i, 4, mod );
+			continue;
+		}
+		const __m256i s = _mm256_add_epi64( va, vb );
+		// s < a : overflow. !( s < mod ) : s >= mod.
+		const __m256i ge = _mm256_andnot_si256( avx2_cmplt_epu64( s, vmod ), _mm256_set1_epi64x( -1 ) );
+		const __m256i over = _mm256_or_si256( avx2_cmplt_epu64( s, va ), ge );
+		_mm256_storeu_si256( reinterpret_cast<__m256i *>( out + i ), _mm256_sub_epi64( s, _mm256_and_si256( over, vmod ) ) );
+	}
+	uaddmod64_scalar( a + i, b + i, out + i, n - i, mod );
+}
+
+UINT64MOD_TARGET( "avx2" )
+static void usubmod64_avx2( const uint64_t *a, const uint64_t *b, uint64_t *out, const size_t n, const uint64_t mod ) {
+	const __m256i vmod = _mm256_set1_epi64x( static_cast<int64_t>( mod ) );
+	size_t i = 0;
+	for ( ; i + 4 <= n; i += 4 ) {
+		const __m256i va = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( a + i ) );
+		const __m256i vb = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( b + i ) );
+		if ( avx2_any_ge( va, vb, vmod ) ) {
+			usubmod64_scalar( a + i, b + i, out + i, 4, mod );
+			continue;
+		}
+		const __m256i d = _mm256_sub_epi64( va, vb );
+		const __m256i borrow = avx2_cmplt_epu64( va, vb );
+		_mm256_storeu_si256( reinterpret_cast<__m256i *>( out + i ), _mm256_add_epi64( d, _mm256_and_si256( borrow, vmod ) ) );
+	}
+	usubmod64_scalar( a + i, b + i, out + i, n - i, mod );
+}
+
+// 32-bit Montgomery constants.
+struct mont32_constants {
+	uint64_t mod;
+	uint64_t inv;  // mod^-1 % 2^32
+	uint64_t r1;   // 2^32 % mod
+	uint64_t r2;   // 2^64 % mod
+};
+
+static mont32_constants make_mont32_constants( const uint64_t mod ) {
+	uint32_t inv = static_cast<uint32_t>( mod );
+	for ( int i = 0; i < 4; i++ ) {
+		inv *= 2 - static_cast<uint32_t>( mod ) * inv;
+	}
+	const uint64_t r1 = 0x1'0000'0000ULL % mod;
+	return mont32_constants{ mod, inv, r1, ( r1 * r1 ) % mod };
+}
+
+// x * y * 2^-32 % mod, x, y < mod < 2^32
+UINT64MOD_TARGET( "avx2" )
+inline __m256i avx2_mont32_mul( const __m256i x, const __m256i y, const __m256i mod, const __m256i inv ) {
+	const __m256i t = _mm256_mul_epu32( x, y );
+	const __m256i m = _mm256_mul_epu32( t, inv );
+	const __m256i u = _mm256_mul_epu32( m, mod );
+	// The low 32 bits of t and u are equal.
+	const __m256i r = _mm256_sub_epi64( _mm256_srli_epi64( t, 32 ), _mm256_srli_epi64( u, 32 ) );
+	return _mm256_add_epi64( r, _mm256_and_si256( _mm256_cmpgt_epi64( _mm256_setzero_si256(), r ), mod ) );
+}
+
+UINT64MOD_TARGET( "avx2" )
+static void umulmod64_avx2( const uint64_t *a, const uint64_t *b, uint64_t *out, const size_t n, const uint64_t mod ) {
+	const mont32_constants c = make_mont32_constants( mod );
+	const __m256i vmod = _mm256_set1_epi64x( static_cast<int64_t>( mod ) );
+	const __m256i vinv = _mm256_set1_epi64x( static_cast<int64_t>( c.inv ) );
+	const __m256i vr2 = _mm256_set1_epi64x( static_cast<int64_t>( c.r2 ) );
+	size_t i = 0;
+	for ( ; i + 4 <= n; i += 4 ) {
+		const __m256i va = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( a + i ) );
+		const __m256i vb = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( b + i ) );
+		if ( avx2_any_ge( va, vb, vmod ) ) {
+			umulmod64_scalar( a + i, b + i, out + i, 4, mod );
+			continue;
+		}
+		// a * ( b * R ) * R^-1 = a * b
+		const __m256i mb = avx2_mont32_mul( vb, vr2, vmod, vinv );
+		_mm256_storeu_si256( reinterpret_cast<__m256i *>( out + i ), avx2_mont32_mul( va, mb, vmod, vinv ) );
+	}
+	umulmod64_scalar( a + i, b + i, out + i, n - i, mod );
+}
+
+UINT64MOD_TARGET( "avx2" )
+static void powmod64_avx2( const uint64_t *a, const uint64_t *e, uint64_t *out, const size_t n, const uint64_t mod ) {
+	const mont32_constants c = make_mont32_constants( mod );
+	const __m256i vmod = _mm256_set1_epi64x( static_cast<int64_t>( mod ) );
+	const __m256i vinv = _mm256_set1_epi64x( static_cast<int64_t>( c.inv ) );
+	const __m256i vr2 = _mm256_set1_epi64x( static_cast<int64_t>( c.r2 ) );
+	const __m256i vone = _mm256_set1_epi64x( 1 );
+	size_t i = 0;
+	for ( ; i + 4 <= n; i += 4 ) {
+		alignas( 32 ) uint64_t ta[ 4 ];
+		for ( int j = 0; j < 4; j++ ) {
+			ta[ j ] = ( a[ i + j ] < mod ) ? a[ i + j ] : a[ i + j ] % mod;
+		}
+		__m256i x = avx2_mont32_mul( _mm256_load_si256( reinterpret_cast<const __m256i *>( ta ) ), vr2, vmod, vinv );
+		__m256i ve = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( e + i ) );
+		__m256i ans = _mm256_set1_epi64x( static_cast<int64_t>( c.r1 ) );
+		while ( !_mm256_testz_si256( ve, ve ) ) {
+			const __m256i bit = _mm256_cmpeq_epi64( _mm256_and_si256( ve, vone ), vone );
+			ans = _mm256_blendv_epi8( ans, avx2_mont32_mul( ans, x, vmod, vinv ), bit );
+			x = avx2_mont32_mul( x, x, vmod, vinv );
+			ve = _mm256_srli_epi64( ve, 1 );
+		}
+		_mm256_storeu_si256( reinterpret_cast<__m256i *>( out + i ), avx2_mont32_mul( ans, vone, vmod, vinv ) );
+	}
+	powmod64_scalar( a + i, e + i, out + i, n - i, mod );
+}
+
+/**
+ * AVX-512 IFMA52 kernels
+ * mul / pow : 8 x 52-bit Montgomery ( R = 2^52 ), odd mod < 2^52.
+ */
+const uint64_t mask52 = ( 1ULL << 52 ) - 1;
+
+// 52-bit Montgomery constants.
+struct mont52_constants {
+	uint64_t mod;
+	uint64_t neg_inv;  // -mod^-1 % 2^52
+	uint64_t r1;       // 2^52 % mod
+	uint64_t r2;       // 2^104 % mod
+};
+
+static mont52_constants make_mont52_constants( const uint64_t mod ) {
+	uint64_t inv = mod;
+	for ( int i = 0; i < 5; i++ ) {
+		inv *= 2 - mod * inv;
+	}
+	const uint64_t r1 = ( 1ULL << 52 ) % mod;
+	return mont52_constants{ mod, ( 0 - inv ) & mask52, r1, umulmod64( r1, r1, mod ) };
+}
+
+// x * y * 2^-52 % mod, x, y < mod < 2^52
+UINT64MOD_TARGET( "avx512f,avx512ifma" )
+inline __m512i ifma_mont52_mul( const __m512i x, const __m512i y, const __m512i mod, const __m512i neg_inv ) {
+	const __m512i zero = _mm512_setzero_si512();
+	const __m512i lo = _mm512_madd52lo_epu64( zero, x, y );
+	__m512i hi = _mm512_madd52hi_epu64( zero, x, y );
+	const __m512i m = _mm512_and_si512( _mm512_madd52lo_epu64( zero, lo, neg_inv ), _mm512_set1_epi64( mask52 ) );
+	// lo + ( m * mod )_lo is 0 or 2^52.
+	const __m512i carry = _mm512_srli_epi64( _mm512_madd52lo_epu64( lo, m, mod ), 52 );
+	hi = _mm512_add_epi64( _mm512_madd52hi_epu64( hi, m, mod ), carry );
+	return _mm512_mask_sub_epi64( hi, _mm512_cmpge_epu64_mask( hi, mod ), hi, mod );
+}
+
+UINT64MOD_TARGET( "avx512f,avx512ifma" )
+static void umulmod64_ifma( const uint64_t *a, const uint64_t *b, uint64_t *out, const size_t n, const uint64_t mod ) {
+	const mont52_constants c = make_mont52_constants( mod );
+	const __m512i vmod = _mm512_set1_epi64( static_cast<int64_t>( mod ) );
+	const __m512i vinv = _mm512_set1_epi64( static_cast<int64_t>( c.neg_inv ) );
+	const __m512i vr2 = _mm512_set1_epi64( static_cast<int64_t>( c.r2 ) );
+	size_t i = 0;
+	for ( ; i + 8 <= n; i += 8 ) {
+		const __m512i va = _mm512_loadu_si512( a + i );
+		const __m512i vb = _mm512_loadu_si512( b + i );
+		if ( ( _mm512_cmpge_epu64_mask( va, vmod ) | _mm512_cmpge_epu64_mask( vb, vmod ) ) != 0 ) {
+			umulmod64_scalar( a + i, b + i, out + i, 8, mod );
+			continue;
+		}
+		const __m512i mb = ifma_mont52_mul( vb, vr2, vmod, vinv );
+		_mm512_storeu_si512( out + i, ifma_mont52_mul( va, mb, vmod, vinv ) );
+	}
+	umulmod64_scalar( a + i, b + i, out + i, n - i, mod );
+}
+
+UINT64MOD_TARGET( "avx512f,avx512ifma" )
+static void powmod64_ifma( const uint64_t *a, const uint64_t *e, uint64_t *out, const size_t n, const uint64_t mod ) {
+	const mont52_constants c = make_mont52_constants( mod );
+	const __m512i vmod = _mm512_set1_epi64( static_cast<int64_t>( mod ) );
+	const __m512i vinv = _mm512_set1_epi64( static_cast<int64_t>( c.neg_inv ) );
+	const __m512i vr2 = _mm512_set1_epi64( static_cast<int64_t>( c.r2 ) );
+	const __m512i vone = _mm512_set1_epi64( 1 );
+	size_t i = 0;
+	for ( ; i + 8 <= n; i += 8 ) {
+		alignas( 64 ) uint64_t ta[ 8 ];
+		for ( int j = 0; j < 8; j++ ) {
+			ta[ j ] = ( a[ i + j ] < mod ) ? a[ i + j ] : a[ i + j ] % mod;
+		}
+		__m512i x = ifma_mont52_mul( _mm512_load_si512( ta ), vr2, vmod, vinv );
+		__m512i ve = _mm512_loadu_si512( e + i );
+		__m512i ans = _mm512_set1_epi64( static_cast<int64_t>( c.r1 ) );
+		while ( _mm512_test_epi64_mask( ve, ve ) != 0 ) {
+			const __mmask8 bit = _mm512_test_epi64_mask( ve, vone );
+			ans = _mm512_mask_mov_epi64( ans, bit, ifma_mont52_mul( ans, x, vmod, vinv ) );
+			x = ifma_mont52_mul( x, x, vmod, vinv );
+			ve = _mm512_srli_epi64( ve, 1 );
+		}
+		_mm512_storeu_si512( out + i, ifma_mont52_mul( ans, vone, vmod, vinv ) );
+	}
+	powmod64_scalar( a + i, e + i, out + i, n - i, mod );
+}
+
+#endif
+
+/**
+ * void uaddmod64_batch( const uint64_t *a, const uint64_t *b, uint64_t *out, size_t n, uint64_t mod )
+ * @param a
+ * @param b
+ * @param out [out] out[ i ] = ( a[ i ] + b[ i ] ) % mod
+ * @param n number of elements
+ * @param mod modular
+ */
+void uaddmod64_batch( const uint64_t *a, const uint64_t *b, uint64_t *out, const size_t n, const uint64_t mod ) {
+	if ( mod == 0 ) {
+		throw std::overflow_error( "Divide by Zero." );
+	}
+#if defined( UINT64MOD_BATCH_X86 )
+	if ( selected_isa != batch_isa::scalar ) {
+		uaddmod64_avx2( a, b, out, n, mod );
+		return;
+	}
+#endif
+	uaddmod64_scalar( a, b, out, n, mod );
+}
+
+/**
+ * void usubmod64_batch( const uint64_t *a, const uint64_t *b, uint64_t *out, size_t n, uint64_t mod )
+ * @param a
+ * @param b
+ * @param out [out] out[ i ] = ( a[ i ] - b[ i ] ) % mod
+ * @param n number of elements
+ * @param mod modular
+ */
+void usubmod64_batch( const uint64_t *a, const uint64_t *b, uint64_t *out, const size_t n, const uint64_t mod ) {
+	if ( mod == 0 ) {
+		throw std::overflow_error( "Divide by Zero." );
+	}
+#if defined( UINT64MOD_BATCH_X86 )
+	if ( selected_isa != batch_isa::scalar ) {
+		usubmod64_avx2( a, b, out, n, mod );
+		return;
+	}
+#endif
+	usubmod64_scalar( a, b, out, n, mod );
+}
+
+/**
+ * void umulmod64_batch( const uint64_t *a, const uint64_t *b, uint64_t *out, size_t n, uint64_t mod )
+ * @param a
+ * @param b
+ * @param out [out] out[ i ] = ( a[ i ] * b[ i ] ) % mod
+ * @param n number of elements
+ * @param mod modular
+ */
+void umulmod64_batch( const uint64_t *a, const uint64_t *b, uint64_t *out, const size_t n, const uint64_t mod ) {
+	if ( mod == 0 ) {
+		throw std::overflow_error( "Divide by Zero." );
+	}
+#if defined( UINT64MOD_BATCH_X86 )
+	if ( ( mod & 1 ) != 0 && mod > 1 ) {
+		if ( selected_isa == batch_isa::avx512ifma && mod < ( 1ULL << 52 ) ) {
+			umulmod64_ifma( a, b, out, n, mod );
+			return;
+		}
+		if ( selected_isa != batch_isa::scalar && mod < ( 1ULL << 32 ) ) {
+			umulmod64_avx2( a, b, out, n, mod );
+			return;
+		}
+	}
+#endif
+	umulmod64_scalar( a, b, out, n, mod );
+}
+
+/**
+ * void powmod64_batch( const uint64_t *a, const uint64_t *e, uint64_t *out, size_t n, uint64_t mod )
+ * @param a bases
+ * @param e exponents
+ * @param out [out] out[ i ] = ( a[ i ] ** e[ i ] ) % mod
+ * @param n number of elements
+ * @param mod modular
+ */
+void powmod64_batch( const uint64_t *a, const uint64_t *e, uint64_t *out, const size_t n, const uint64_t mod ) {
+	if ( mod == 0 ) {
+		throw std::overflow_error( "Divide by Zero." );
+	}
+#if defined( UINT64MOD_BATCH_X86 )
+	if ( ( mod & 1 ) != 0 && mod > 1 ) {
+		if ( selected_isa == batch_isa::avx512ifma && mod < ( 1ULL << 52 ) ) {
+			powmod64_ifma( a, e, out, n, mod );
+			return;
+		}
+		if ( selected_isa != batch_isa::scalar && mod < ( 1ULL << 32 ) ) {
+			powmod64_avx2( a, e, out, n, mod );
+			return;
+		}
+	}
+#endif
+	powmod64_scalar( a, e, out, n, mod );
+}
+
+/**
+ * Montgomery's trick : one inversion and 3 ( n - 1 ) multiplications for n inverses.
+ */
+// Residues mod an even modulus, with the same interface as Montgomery64.
+struct plain_residues {
+	Barrett64 br;
+	uint64_t to_mont( const uint64_t a ) const { return br.reduce( a ); }
+	uint64_t from_mont( const uint64_t a ) const { return a; }
+	uint64_t one() const { return br.one(); }
+	uint64_t mul( const uint64_t a, const uint64_t b ) const { return br.mul( a, b ); }
+	uint64_t inverse( const uint64_t a ) const { return umodinv64( a, br.modulus() ); }
+};
+
+/**
+ * batch_inverse( const Ring &ring, const uint64_t *x, const uint8_t *skip, uint64_t *out, size_t n )
+ * out[ i ] = x[ i ]^-1 for every i without skip[ i ]. Throws std::overflow_error if a product is not invertible.
+ */
+template <typename Ring>
+static void batch_inverse( const Ring &ring, const uint64_t *x, const uint8_t *skip, uint64_t *out, const size_t n ) {
+	// out[ i ] = x[ 0 ] * ... * x[ i - 1 ]
+	uint64_t product = ring.one();
+	for ( size_t i = 0; i < n; i++ ) {
+		if ( !skip[ i ] ) {
+			out[ i ] = product;
+			product = ring.mul( product, x[ i ] );
+		}
+	}
+	// inv = ( x[ 0 ] * ... * x[ i ] )^-1
+	uint64_t inv = ring.inverse( product );
+	for ( size_t i = n; i-- > 0; ) {
+		if ( !skip[ i ] ) {
+			out[ i ] = ring.mul( out[ i ], inv );
+			inv = ring.mul( inv, x[ i ] );
+		}
+	}
+}
+
+template <typename Ring>
+static std::vector<size_t> umodinv64_batch( const Ring &ring, const uint64_t *in, uint64_t *out, const size_t n,
+                                            const uint64_t mod ) {
+	std::vector<uint64_t> x( n );
+	std::vector<uint8_t> skip( n );
+	for ( size_t i = 0; i < n; i++ ) {
+		x[ i ] = ring.to_mont( in[ i ] );
+		skip[ i ] = ( x[ i ] == 0 );
+	}
+	try {
+		batch_inverse( ring, x.data(), skip.data(), out, n );
+	} catch ( const std::overflow_error & ) {
+		// Composite modulus : find the elements sharing a factor with mod.
+		for ( size_t i = 0; i < n; i++ ) {
+			skip[ i ] = skip[ i ] || ugcd64( ( in[ i ] < mod ) ? in[ i ] : in[ i ] % mod, mod ) != 1;
+		}
+		batch_inverse( ring, x.data(), skip.data(), out, n );
+	}
+
+	std::vector<size_t> failed;
+	for ( size_t i = 0; i < n; i++ ) {
+		if ( skip[ i ] ) {
+			out[ i ] = 0;
+			failed.push_back( i );
+		} else {
+			out[ i ] = ring.from_mont( out[ i ] );
+		}
+	}
+	return failed;
+}
+
+/**
+ * std::vector<size_t> umodinv64_batch( const uint64_t *in, uint64_t *out, size_t n, uint64_t mod )
+ * @param in
+ * @param out [out] out[ i ] = in[ i ]^-1 % mod, 0 if in[ i ] is not invertible
+ * @param n number of elements
+ * @param mod modular
+ * @return indices of the elements that are not invertible, in increasing order
+ */
+std::vector<size_t> umodinv64_batch( const uint64_t *in, uint64_t *out, const size_t n, const uint64_t mod ) {
+	if ( mod == 0 ) {
+		throw std::overflow_error( "Divide by Zero." );
+	}
+	if ( mod == 1 ) {
+		// umodinv64( a, 1 ) = 0
+		for ( size_t i = 0; i < n; i++ ) {
+			out[ i ] = 0;
+		}
+		return {};
+	}
+	if ( mod & 1 ) {
+		return umodinv64_batch( Montgomery64( mod ), in, out, n, mod );
+	}
+	return umodinv64_batch( plain_residues{ Barrett64( mod ) }, in, out, n, mod );
+}
+
+/**
+ * void is_square_batch( const uint64_t *x, bool *out, size_t n )
+ * The modulo 64 filter runs first over the whole array without branches, then is_square() only on the 3 / 16 of
+ * the elements that pass it.
+ * @param x
+ * @param out [out] out[ i ] = is_square( x[ i ] )
+ * @param n number of elements
+ */
+void is_square_batch( const uint64_t *x, bool *out, const size_t n ) {
+	// bit r is set iff r is a square modulo 64.
+	const uint64_t squares_64 = 0x0202'0212'0203'0213ULL;
+	for ( size_t i = 0; i < n; i++ ) {
+		out[ i ] = ( squares_64 >> ( x[ i ] & 63 ) ) & 1;
+	}
+	for ( size_t i = 0; i < n; i++ ) {
+		if ( out[ i ] ) {
+			out[ i ] = is_square( x[ i ] );
+		}
+	}
+}
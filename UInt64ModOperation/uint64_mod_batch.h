@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Batched modular operations over arrays.
+// Results are identical to uaddmod64(), usubmod64(), umulmod64() and powmod64() applied per element.
+// Kernels are selected at runtime : AVX-512 IFMA52 ( mod < 2^52 ), AVX2 ( mod < 2^32 ), scalar Montgomery.
+// umodinv64_batch() uses Montgomery's trick and returns the indices of non-invertible elements instead of throwing.
+// is_square_batch() applies is_square() to every element.
+
+enum class batch_isa {
+	scalar,
+	avx2,
+	avx512ifma,
+};
+
+void uaddmod64_batch( const uint64_t *a, const uint64_t *b, uint64_t *out, size_t n, uint64_t mod );
+void usubmod64_batch( const uint64_t *a, const uint64_t *b, uint64_t *out, size_t n, uint64_t mod );
+void umulmod64_batch( const uint64_t *a, const uint64_t *b, uint64_t *out, size_t n, uint64_t mod );
+void powmod64_batch( const uint64_t *a, const uint64_t *e, uint64_t *out, size_t n, uint64_t mod );
+std::vector<size_t> umodinv64_batch( const uint64_t *in, uint64_t *out, size_t n, uint64_t mod );
+void is_square_batch( const uint64_t *x, bool *out, size_t n );
+
+batch_isa detect_batch_isa();
+batch_isa get_batch_isa();
+void set_batch_isa( batch_isa isa );
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "barrett64.h"
+#include "uint128_arith.h"
+#include "uint64_mod_operation.h"
+
+// Branch-free modular arithmetic.
+// The running time depends on the modulus, which is public, and not on the operands or the exponent.
+// Comparisons are carry / borrow flags turned into masks, selections are masked blends.
+// Operands must already be reduced ( a, b < mod ) : reducing them would need a data-dependent division.
+namespace ct {
+
+/**
+ * mask( uint64_t bit )
+ * @param bit 0 or 1
+ * @return 0 or 0xFFFF'FFFF'FFFF'FFFF
+ */
+inline uint64_t mask( const uint64_t bit ) { return 0 - bit; }
+
+/**
+ * select( uint64_t m, uint64_t a, uint64_t b )
+ * @param m mask
+ * @return m ? a : b
+ */
+inline uint64_t select( const uint64_t m, const uint64_t a, const uint64_t b ) { return b ^ ( ( a ^ b ) & m ); }
+
+/**
+ * uaddmod64( uint64_t a, uint64_t b, uint64_t mod )
+ * @param a a < mod
+ * @param b b < mod
+ * @return ( a + b ) % mod
+ */
+inline uint64_t uaddmod64( const uint64_t a, const uint64_t b, const uint64_t mod ) {
+	uint64_t carry = 0, borrow = 0;
+	const uint64_t s = uaddc64( a, b, 0, &carry );
+	const uint64_t t = usubb64( s, mod, 0, &borrow );
+	// a + b >= mod : the sum overflowed, or s - mod did not borrow.
+	return select( mask( carry | ( borrow ^ 1 ) ), t, s );
+}
+
+/**
+ * usubmod64( uint64_t a, uint64_t b, uint64_t mod )
+ * @param a a < mod
+ * @param b b < mod
+ * @return ( a - b ) % mod
+ */
+inline uint64_t usubmod64( const uint64_t a, const uint64_t b, const uint64_t mod ) {
+	uint64_t borrow = 0;
+	const uint64_t d = usubb64( a, b, 0, &borrow );
+	return d + ( mod & mask( borrow ) );
+}
+
+/**
+ * umulmod64( uint64_t a, uint64_t b, const Barrett64 &ctx )
+ * Barrett64 reduction with branch-free corrections, see Barrett64::mul_ct().
+ * @param a a < ctx.modulus()
+ * @param b b < ctx.modulus()
+ * @return ( a * b ) % ctx.modulus()
+ */
+inline uint64_t umulmod64( const uint64_t a, const uint64_t b, const Barrett64 &ctx ) { return ctx.mul_ct( a, b ); }
+
+/**
+ * umulmod64( uint64_t a, uint64_t b, uint64_t mod )
+ * Computes the reciprocal of mod on every call; keep a Barrett64 for repeated use.
+ * @param a a < mod
+ * @param b b < mod
+ * @return ( a * b ) % mod
+ */
+inline uint64_t umulmod64( const uint64_t a, const uint64_t b, const uint64_t mod ) { return Barrett64( mod ).mul_ct( a, b ); }
+
+/**
+ * powmod64( uint64_t a, uint64_t e, const Barrett64 &ctx )
+ * 64 squarings and 64 multiplications for every exponent; the product is kept or dropped with a mask.
+ * @param a a < ctx.modulus()
+ * @param e exponent, secret
+ * @return ( a ** e ) % ctx.modulus(), 0 ** 0 = 1 % mod
+ */
+inline uint64_t powmod64( const uint64_t a, const uint64_t e, const Barrett64 &ctx ) {
+	uint64_t ans = ctx.one();
+	for ( int i = 63; i >= 0; i-- ) {
+		ans = ctx.mul_ct( ans, ans );
+		ans = select( mask( ( e >> i ) & 1 ), ctx.mul_ct( ans, a ), ans );
+	}
+	return ans;
+}
+
+/**
+ * powmod64( uint64_t a, uint64_t e, uint64_t mod )
+ * @param a a < mod
+ * @param e exponent, secret
+ * @param mod modular
+ * @return ( a ** e ) % mod, 0 ** 0 = 1 % mod
+ */
+inline uint64_t powmod64( const uint64_t a, const uint64_t e, const uint64_t mod ) { return powmod64( a, e, Barrett64( mod ) ); }
+
+/**
+ * umodinv64( uint64_t a, uint64_t mod )
+ * Fixed 128 iterations of binary GCD, see umodinv64_ct().
+ * @param a a < mod
+ * @param mod odd modular
+ * @return a^-1 % mod
+ */
+inline uint64_t umodinv64( const uint64_t a, const uint64_t mod ) { return umodinv64_ct( a, mod ); }
+
+}  // namespace ct
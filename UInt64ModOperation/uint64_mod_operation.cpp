@@ -1,5 +1,14 @@
 #include "uint64_mod_operation.h"
 
+#include <math.h>
+
+#include <vector>
+
+#include "barrett64.h"
+#include "lucas64.h"
+#include "montgomery64.h"
+#include "uint64_mod_stats.h"
+
 /**
  * uaddmod64( uint64_t a, uint64_t b, uint64_t mod )
  * @param a
@@ -53,8 +62,10 @@ uint64_t umulmod64( uint64_t a, uint64_t b, const uint64_t mod ) {
 	if ( mod == 0 ) {
 		throw std::overflow_error( "Divide by Zero." );
 	}
+	UINT64MOD_STAT_INC( umulmod_calls );
 
 	//
+	UINT64MOD_STAT_ADD( umulmod_unreduced, ( a >= mod || b >= mod ) ? 1 : 0 );
 	if ( a >= mod ) {
 		a %= mod;
 	}
@@ -63,139 +74,243 @@ uint64_t umulmod64( uint64_t a, uint64_t b, const uint64_t mod ) {
 	}
 
 	if ( a == 0 || b == 0 || mod == 1 ) {
+		UINT64MOD_STAT_INC( umulmod_trivial );
 		return 0;
 	}
 
-	//	_umul128(), _udiv128() can be used.
-	// The conditions for using _umul128() and _udiv128() are bitlen( a * b ) - bitlen( mod ) < sizeof( uint64_t ).
-	// The quotient does not overflow.
-	if ( static_cast<int>( sizeof( uint64_t ) ) * 8 - __lzcnt64( a ) - __lzcnt64( b ) + __lzcnt64( mod ) <
-	     static_cast<int>( sizeof( uint64_t ) * 8 ) ) {
-		uint64_t hi = 0, rem = 0;
-		const uint64_t lo = _umul128( a, b, &hi );
-		_udiv128( hi, lo, mod, &rem );
-		return rem;
-	}
-
-	// Ensure that a >= b.
-	if ( a < b ) {
-		uint64_t t = a;
-		a = b;
-		b = t;
-	}
-
-	uint64_t ans = 0;
-	uint64_t x = a;
-	while ( b ) {
-		if ( b & 1 ) {
-			if ( is_add_overflow( ans, x ) ) {
-				ans = uaddmod64( ans, x, mod );
-			} else {
-				// ans < mod , x < mod : ans + x < 2 * mod
-				ans += x;
-				if ( ans > mod ) {
-					ans -= mod;
-				}
-			}
-		}
-		b >>= 1;
-		if ( b == 0 ) {
-			break;
-		}
-
-		if ( is_add_overflow( x, x ) ) {
-			x = uaddmod64( x, x, mod );
-		} else {
-			// x < mod : x + x < 2 * mod
-			x += x;
-			if ( x > mod ) {
-				x -= mod;
-			}
-		}
-	}
-
-	return ans;
+	// a, b < mod, so hi < mod and the udiv128() quotient fits in 64 bits.
+	uint64_t hi = 0, rem = 0;
+	const uint64_t lo = umul128( a, b, &hi );
+	udiv128( hi, lo, mod, &rem );
+	return rem;
 }
 
 /**
  * uint64_t powmod64( uint64_t a, uint64_t e, const uint64_t mod )
+ * Sliding-window exponentiation over the full 64-bit exponent.
  * @param a base
  * @param e exponent
  * @param mod modular
- * @return ( a ** e ) % mod
+ * @return ( a ** e ) % mod, 0 ** 0 = 1 % mod
  */
-uint64_t powmod64( uint64_t a, uint64_t e, const uint64_t mod ) {
-	if ( a >= mod ) {
-		a %= mod;
+uint64_t powmod64( uint64_t a, const uint64_t e, const uint64_t mod ) {
+	if ( mod == 0 ) {
+		throw std::overflow_error( "Divide by Zero." );
 	}
-	if ( a == 1 ) {
-		return 1;
+	UINT64MOD_STAT_INC( powmod_calls );
+	UINT64MOD_STAT_TIMER( powmod_ticks );
+	if ( mod == 1 ) {
+		return 0;
 	}
-	if ( e >= mod ) {
-		e = e % mod;
+	if ( a >= mod ) {
+		a %= mod;
 	}
 	if ( e == 0 ) {
 		return 1;
 	}
+	if ( a <= 1 ) {
+		return a;
+	}
 	if ( a == mod - 1 ) {                // a ≡ -1 % mod
 		return ( e & 1 ) ? mod - 1 : 1;  // Returns -1 if the exponent is odd and 1 if it is even.
 	}
 
-	uint64_t ans = 1;
-	uint64_t t = a;
+	if ( mod & 1 ) {
+		// Odd modulus : Montgomery multiplication, no division in the loop.
+		UINT64MOD_STAT_INC( powmod_montgomery );
+		const Montgomery64 mg( mod );
+		return mg.from_mont( mg.pow( mg.to_mont( a ), e ) );
+	}
+
+	// Even modulus : precomputed reciprocal, no division in the loop.
+	UINT64MOD_STAT_INC( powmod_barrett );
+	const Barrett64 br( mod );
+	return br.pow( a, e );
+}
 
-	while ( e ) {
-		if ( e & 1 ) {
-			ans = umulmod64( ans, t, mod );
+/**
+ * interleaved_pow( const Ring &ring, const uint64_t *x, const uint64_t *e, size_t count )
+ * Interleaved sliding-window exponentiation ( Möller ) : every exponent is split into its own windows, and all
+ * the bases share one squaring chain.
+ * @return x[ 0 ] ** e[ 0 ] * ... * x[ count - 1 ] ** e[ count - 1 ]
+ */
+template <typename Ring>
+static uint64_t interleaved_pow( const Ring &ring, const uint64_t *x, const uint64_t *e, const size_t count ) {
+	struct window {
+		int low;         // lowest bit of the window
+		uint64_t power;  // x^w, w odd
+	};
+	// windows[ j ] in decreasing order of low.
+	std::vector<std::vector<window>> windows( count );
+	int top = -1;
+	for ( size_t j = 0; j < count; j++ ) {
+		if ( e[ j ] == 0 ) {
+			continue;
 		}
-		e >>= 1;
-		if ( e == 0 ) {
-			break;
+		const int k = pow_window_bits( e[ j ] );
+		uint64_t odd[ 4 ] = { x[ j ] };
+		if ( k > 1 ) {
+			const uint64_t x2 = ring.mul( x[ j ], x[ j ] );
+			for ( int i = 1; i < ( 1 << ( k - 1 ) ); i++ ) {
+				odd[ i ] = ring.mul( odd[ i - 1 ], x2 );
+			}
+		}
+		const int high = 63 - ulzcnt64( e[ j ] );
+		top = ( high > top ) ? high : top;
+		for ( int i = high; i >= 0; ) {
+			if ( ( ( e[ j ] >> i ) & 1 ) == 0 ) {
+				i--;
+				continue;
+			}
+			int low = ( i - k + 1 > 0 ) ? i - k + 1 : 0;
+			while ( ( ( e[ j ] >> low ) & 1 ) == 0 ) {
+				low++;
+			}
+			const uint64_t w = ( e[ j ] >> low ) & ( ( 1ULL << ( i - low + 1 ) ) - 1 );
+			windows[ j ].push_back( window{ low, odd[ w >> 1 ] } );
+			i = low - 1;
+		}
+	}
+
+	uint64_t ans = ring.one();
+	bool first = true;
+	std::vector<size_t> next( count, 0 );
+	for ( int bit = top; bit >= 0; bit-- ) {
+		if ( !first ) {
+			ans = ring.mul( ans, ans );
+		}
+		for ( size_t j = 0; j < count; j++ ) {
+			if ( next[ j ] < windows[ j ].size() && windows[ j ][ next[ j ] ].low == bit ) {
+				ans = first ? windows[ j ][ next[ j ] ].power : ring.mul( ans, windows[ j ][ next[ j ] ].power );
+				first = false;
+				next[ j ]++;
+			}
 		}
-		t = umulmod64( t, t, mod );
 	}
 	return ans;
 }
 
-uint64_t extended_eucledian( uint64_t a, uint64_t b, uint64_t mod, uint64_t *ox, uint64_t *oy ) {
-	if ( a == 0 ) {
-		*ox = 0;
-		*oy = 1;
-		return b;
+/**
+ * uint64_t multi_powmod64( const uint64_t *bases, const uint64_t *exps, size_t count, uint64_t mod )
+ * Simultaneous exponentiation ( Straus, Shamir's trick ) : one squaring chain for all the bases.
+ * @param bases
+ * @param exps exponents
+ * @param count number of bases
+ * @param mod modular
+ * @return ( bases[ 0 ] ** exps[ 0 ] * ... * bases[ count - 1 ] ** exps[ count - 1 ] ) % mod, 0 ** 0 = 1
+ */
+uint64_t multi_powmod64( const uint64_t *bases, const uint64_t *exps, const size_t count, const uint64_t mod ) {
+	if ( mod == 0 ) {
+		throw std::overflow_error( "Divide by Zero." );
 	}
-	uint64_t x, y;
-	uint64_t t = b;
-	if ( b >= a ){
-		t = b % a;
+	if ( mod == 1 ) {
+		return 0;
 	}
-	uint64_t gcd = extended_eucledian( t, a, mod, &x, &y );
-	// *x1 = y - ( b / a ) * x;
-	uint64_t q = b / a;
-	q = umulmod64( q, x, mod );
-	*ox = usubmod64( y, q, mod );
 
-	*oy = x;
-	return gcd;
+	std::vector<uint64_t> x( count );
+	if ( mod & 1 ) {
+		const Montgomery64 mg( mod );
+		for ( size_t j = 0; j < count; j++ ) {
+			x[ j ] = mg.to_mont( bases[ j ] );
+		}
+		return mg.from_mont( interleaved_pow( mg, x.data(), exps, count ) );
+	}
+	const Barrett64 br( mod );
+	for ( size_t j = 0; j < count; j++ ) {
+		x[ j ] = br.reduce( bases[ j ] );
+	}
+	return interleaved_pow( br, x.data(), exps, count );
 }
 
 /**
  * uint64_t umodinv64( uint64_t a, uint64_t mod )
+ * Iterative extended Euclidean algorithm.
+ * The Bezout coefficients alternate in sign, so only their magnitudes ( <= mod ) and the sign of the last one are kept.
  * @param a
  * @param mod
  * @return a^-1 % mod
  */
 uint64_t umodinv64( uint64_t a, uint64_t mod ) {
-	uint64_t x, y;
+	if ( mod == 0 ) {
+		throw std::overflow_error( "Divide by Zero." );
+	}
 	if ( a >= mod ) {
 		a %= mod;
 	}
-	uint64_t gcd = extended_eucledian( a, mod, mod, &x, &y );
-	if ( gcd != 1 ) {
+
+	// r0 ≡ ±t0 * a, r1 ≡ ±t1 * a ( mod mod )
+	uint64_t r0 = mod, r1 = a;
+	uint64_t t0 = 0, t1 = 1;
+	bool negative = true;  // sign of t0
+	while ( r1 != 0 ) {
+		const uint64_t q = r0 / r1;
+		const uint64_t r = r0 - q * r1;
+		r0 = r1;
+		r1 = r;
+		const uint64_t t = t0 + q * t1;
+		t0 = t1;
+		t1 = t;
+		negative = !negative;
+	}
+
+	if ( r0 != 1 ) {
+		throw std::overflow_error( "The inverse does not exist." );
+	}
+	return ( negative && t0 != 0 ) ? mod - t0 : t0;
+}
+
+/**
+ * uint64_t umodinv64_ct( uint64_t a, uint64_t mod )
+ * Constant-time inverse for an odd modulus. Binary GCD ( Möller, GMP mpn_sec_invert ) with a fixed 128 iterations
+ * and no data-dependent branches.
+ * @param a a < mod ( otherwise a % mod is taken, which is not constant-time )
+ * @param mod odd modular
+ * @return a^-1 % mod
+ */
+uint64_t umodinv64_ct( uint64_t a, const uint64_t mod ) {
+	if ( ( mod & 1 ) == 0 ) {
+		throw std::invalid_argument( "Modulus must be odd." );
+	}
+	if ( a >= mod ) {
+		a %= mod;
+	}
+
+	// a ≡ u * A, b ≡ v * A ( mod mod ), b is odd.
+	uint64_t b = mod;
+	uint64_t u = 1 % mod;
+	uint64_t v = 0;
+	const uint64_t half_mod = ( mod >> 1 ) + 1;  // ( mod + 1 ) / 2
+
+	for ( int i = 0; i < 2 * 64; i++ ) {
+		const uint64_t odd = 0 - ( a & 1 );
+		// a < b : borrow of a - b
+		const uint64_t d = a - b;
+		const uint64_t lt = 0 - ( ( ( ~a & b ) | ( ( ~( a ^ b ) ) & d ) ) >> 63 );
+
+		// a odd and a < b : swap ( a, u ) and ( b, v ).
+		const uint64_t swap = odd & lt;
+		const uint64_t sab = ( a ^ b ) & swap;
+		a ^= sab;
+		b ^= sab;
+		const uint64_t suv = ( u ^ v ) & swap;
+		u ^= suv;
+		v ^= suv;
+
+		// a odd : a -= b, u -= v ( mod mod )
+		a -= b & odd;
+		const uint64_t w = v & odd;
+		const uint64_t borrow = 0 - ( ( ( ~u & w ) | ( ( ~( u ^ w ) ) & ( u - w ) ) ) >> 63 );
+		u = u - w + ( mod & borrow );
+
+		// a is even : a /= 2, u /= 2 ( mod mod )
+		a >>= 1;
+		u = ( u >> 1 ) + ( half_mod & ( 0 - ( u & 1 ) ) );
+	}
+
+	if ( b != 1 ) {
 		throw std::overflow_error( "The inverse does not exist." );
-	} else {
-		y = x % mod;
 	}
-	return y;
+	return v;
 }
 
 /**
@@ -212,122 +327,260 @@ uint64_t udivmod64( const uint64_t a, const uint64_t b, const uint64_t mod ) {
 	return umulmod64( a, umodinv64( b, mod ), mod );
 }
 
+/**
+ * ugcd64( uint64_t a, uint64_t b )
+ * binary GCD ( Stein )
+ * @param a
+ * @param b
+ * @return gcd( a, b )
+ */
+uint64_t ugcd64( uint64_t a, uint64_t b ) {
+	if ( a == 0 ) {
+		return b;
+	}
+	if ( b == 0 ) {
+		return a;
+	}
+	const int shift = utzcnt64( a | b );
+	a >>= utzcnt64( a );
+	while ( b != 0 ) {
+		b >>= utzcnt64( b );
+		if ( a > b ) {
+			const uint64_t t = a;
+			a = b;
+			b = t;
+		}
+		b -= a;
+	}
+	return a << shift;
+}
+
 /**
  *	is_prime( uint64_t x )
  *
  */
-const static std::map<uint64_t, uint64_t> prime_and_max = std::map<uint64_t, uint64_t>{
-    { 2, 8321 },  //	2047. Strong pseudoprimes to base 2, [ 2047( = 23x89 ),
-                  // 3277( = 29x113 ), 4033( = 37x109 ), 4681( = 31x151 ), 8321(
-                  //= 53x157 )
-    { 3, 1373653 },
-    { 5, 25326001 },
-    { 7, 3215031751 },
-    { 11, 2152302898747 },
-    { 13, 3474749660383 },
-    { 17, 341550071728321 },
-    { 19, 341550071728321 },
-    { 23, 3825123056546413051 },
-    { 29, 3825123056546413051 },
-    { 31, 3825123056546413051 },
-    { 37, 0xFFFF'FFFF'FFFF'FFFF },
-    { 41, 0xFFFF'FFFF'FFFF'FFFF },
-    // { 37, 318665857834031151167461 },
-    // { 41, 3317044064679887385961981 },
+// Trial division. target % p == 0  <=>  target * p^-1 ( mod 2^64 ) <= ( 2^64 - 1 ) / p
+struct trial_divisor {
+	uint64_t p;
+	uint64_t inv;  // p^-1 % 2^64
+	uint64_t max;  // ( 2^64 - 1 ) / p
 };
 
-bool is_prime( uint64_t target ) {
-	if ( target < 2 ) {
-		return false;
+constexpr trial_divisor make_trial_divisor( const uint64_t p ) {
+	uint64_t inv = p;
+	for ( int i = 0; i < 5; i++ ) {
+		inv *= 2 - p * inv;
 	}
-	if ( target < 4 ) {
+	return trial_divisor{ p, inv, 0xFFFF'FFFF'FFFF'FFFF / p };
+}
+
+constexpr trial_divisor small_primes[] = {
+    make_trial_divisor( 3 ),  make_trial_divisor( 5 ),  make_trial_divisor( 7 ),  make_trial_divisor( 11 ),
+    make_trial_divisor( 13 ), make_trial_divisor( 17 ), make_trial_divisor( 19 ), make_trial_divisor( 23 ),
+    make_trial_divisor( 29 ), make_trial_divisor( 31 ), make_trial_divisor( 37 ), make_trial_divisor( 41 ),
+};
+
+// target < 2^32 : base 2 and one base chosen by mr_hash( target ).
+// For every bucket, the base has no strong pseudoprime to base 2 below 2^32 in the bucket
+// ( generated from the complete list of strong pseudoprimes to base 2 below 2^32 ).
+const static uint8_t mr_hashed_bases[ 256 ] = {
+    3, 5, 3, 3, 5, 3, 3, 5, 5, 3, 3, 3, 3, 3, 5, 7,
+    3, 3, 3, 3, 3, 5, 3, 3, 3, 5, 5, 3, 3, 3, 3, 3,
+    3, 3, 5, 3, 5, 5, 3, 3, 3, 5, 3, 3, 3, 3, 3, 3,
+    5, 3, 3, 5, 3, 3, 3, 3, 3, 5, 3, 3, 5, 7, 5, 3,
+    5, 3, 3, 3, 3, 3, 3, 3, 7, 3, 3, 3, 5, 5, 7, 3,
+    3, 3, 3, 7, 5, 7, 3, 3, 3, 3, 5, 3, 3, 7, 3, 10,
+    5, 3, 3, 3, 5, 5, 3, 3, 3, 3, 3, 3, 3, 3, 3, 5,
+    3, 7, 3, 7, 5, 3, 3, 3, 5, 3, 3, 3, 3, 5, 3, 5,
+    3, 3, 5, 5, 7, 3, 3, 3, 3, 7, 5, 3, 3, 3, 3, 5,
+    3, 3, 3, 5, 3, 3, 3, 3, 10, 3, 5, 3, 3, 3, 3, 3,
+    3, 5, 5, 7, 3, 3, 3, 5, 3, 3, 17, 3, 3, 3, 7, 3,
+    3, 3, 15, 3, 3, 3, 3, 3, 11, 5, 3, 3, 5, 5, 3, 3,
+    13, 3, 3, 7, 3, 3, 3, 5, 3, 3, 5, 3, 3, 3, 3, 3,
+    5, 7, 3, 5, 3, 5, 3, 7, 5, 3, 13, 11, 5, 5, 3, 3,
+    3, 3, 3, 3, 3, 5, 3, 3, 3, 3, 3, 3, 5, 3, 3, 3,
+    3, 3, 5, 3, 5, 3, 3, 7, 3, 3, 10, 3, 3, 3, 3, 5,
+};
+
+inline uint32_t mr_hash( const uint64_t target ) { return ( static_cast<uint32_t>( target ) * 0x9E37'79B1U ) >> 24; }
+
+// target < 2^64 : 7 bases, Jim Sinclair.
+const static uint64_t mr_bases_64[] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+
+/**
+ * is_strong_probable_prime( const Montgomery64 &mg, uint64_t d, int s, uint64_t base )
+ * @param mg Montgomery context of target
+ * @param d odd part of target - 1
+ * @param s target - 1 = d * 2^s
+ * @param base witness
+ * @return false if base proves that target is composite
+ */
+static bool is_strong_probable_prime( const Montgomery64 &mg, const uint64_t d, const int s, uint64_t base ) {
+	const uint64_t target = mg.modulus();
+	if ( base >= target ) {
+		base %= target;
+		if ( base == 0 ) {
+			return true;
+		}
+	}
+
+	// Montgomery form of 1 and -1.
+	const uint64_t one = mg.one();
+	const uint64_t minus_one = target - one;
+
+	uint64_t x = mg.pow( mg.to_mont( base ), d );
+	if ( x == one || x == minus_one ) {
 		return true;
 	}
-	if ( ( target & 1 ) == 0 ) {
-		return false;
+	for ( int i = 1; i < s; i++ ) {
+		x = mg.mul( x, x );
+		if ( x == minus_one ) {
+			return true;
+		}
 	}
+	return false;
+}
+
+// Miller-Rabin finished after bases, and found target composite or not.
+#define UINT64MOD_STAT_MR( bases, composite )                                                                    \
+	( UINT64MOD_STAT_ADD( is_prime_mr_bases, bases ), UINT64MOD_STAT_INC( is_prime_bases_1 + ( bases ) - 1 ), \
+	  UINT64MOD_STAT_ADD( is_prime_mr_composite, ( composite ) ? 1 : 0 ) )
 
-	for ( const auto &[ p, m ] : prime_and_max ) {
-		if ( target == p ) {
+/**
+ * trial_division( uint64_t target, bool *prime )
+ * Small and even numbers, and the primes below 43.
+ * @param prime [out] the answer, when decided
+ * @return true if decided
+ */
+static bool trial_division( const uint64_t target, bool *prime ) {
+	if ( target < 4 || ( target & 1 ) == 0 ) {
+		*prime = ( target == 2 || target == 3 );
+		return true;
+	}
+	for ( const auto &t : small_primes ) {
+		if ( target == t.p ) {
+			*prime = true;
 			return true;
 		}
-		if ( target % p == 0 ) {
-			return false;
+		if ( target * t.inv <= t.max ) {
+			*prime = false;
+			return true;
 		}
 	}
+	*prime = true;
+	return target < 43 * 43;
+}
 
-	uint64_t p_1 = target - 1;
-	uint64_t d = p_1;
-
-	while ( ( d & 1 ) == 0 ) {
-		d >>= 1;
+bool is_prime( uint64_t target ) {
+	UINT64MOD_STAT_INC( is_prime_calls );
+	UINT64MOD_STAT_TIMER( is_prime_ticks );
+	bool prime = false;
+	if ( trial_division( target, &prime ) ) {
+		return prime;
 	}
 
-	for ( const auto &[ p, m ] : prime_and_max ) {
-		uint64_t x = powmod64( p, d, target );
-		if ( x == 1 ) {
-			if ( target < m ) {
-				return true;
-			}
-			continue;
-		}
+	const int s = utzcnt64( target - 1 );
+	const uint64_t d = ( target - 1 ) >> s;
+	const Montgomery64 mg( target );
+	UINT64MOD_STAT_INC( is_prime_mr_calls );
 
-		uint64_t td = d;
-		while ( td != p_1 && x != p_1 ) {
-			x = powmod64( x, 2, target );
-			td <<= 1;
-		}
+	if ( !is_strong_probable_prime( mg, d, s, 2 ) ) {
+		UINT64MOD_STAT_MR( 1, true );
+		return false;
+	}
+	if ( target < 0x1'0000'0000 ) {
+		prime = is_strong_probable_prime( mg, d, s, mr_hashed_bases[ mr_hash( target ) ] );
+		UINT64MOD_STAT_MR( 2, !prime );
+		return prime;
+	}
 
-		if ( td == p_1 ) {
+	for ( size_t i = 1; i < sizeof( mr_bases_64 ) / sizeof( mr_bases_64[ 0 ] ); i++ ) {
+		if ( !is_strong_probable_prime( mg, d, s, mr_bases_64[ i ] ) ) {
+			UINT64MOD_STAT_MR( i + 1, true );
 			return false;
-		} else {
-			if ( x == p_1 && target < m ) {
-				return true;
-			}
 		}
 	}
-
+	UINT64MOD_STAT_MR( sizeof( mr_bases_64 ) / sizeof( mr_bases_64[ 0 ] ), false );
 	return true;
 }
 
+/**
+ * bpsw_is_prime( uint64_t target )
+ * Baillie-PSW : trial division, a base 2 strong probable prime test, and a strong Lucas test ( lucas64.h ).
+ * @param target
+ * @return true if target is prime
+ */
+bool bpsw_is_prime( const uint64_t target ) {
+	bool prime = false;
+	if ( trial_division( target, &prime ) ) {
+		return prime;
+	}
+	const int s = utzcnt64( target - 1 );
+	const uint64_t d = ( target - 1 ) >> s;
+	const Montgomery64 mg( target );
+	return is_strong_probable_prime( mg, d, s, 2 ) && is_strong_lucas_prp64( mg );
+}
+
 /**
  * isqrt( uint64_t x )
  * integer sqrt
- * Hacker's Delight
+ * sqrt( double ) is within one of the root, corrected by ±1.
  * @param x number
  * @return sqrt( x ) integer
  */
-uint64_t isqrt( uint64_t x ) {
-	if ( x <= 3 ) {
-		if ( x == 0 ) {
-			return 0;
-		}
-		return 1;
+uint64_t isqrt( const uint64_t x ) {
+	uint64_t root = static_cast<uint64_t>( sqrt( static_cast<double>( x ) ) );
+	// x close to 2^64 rounds up to 2^64 : root = 2^32.
+	if ( root > 0xFFFF'FFFF ) {
+		root = 0xFFFF'FFFF;
 	}
+	if ( root * root > x ) {
+		root--;
+	} else if ( root < 0xFFFF'FFFF && ( root + 1 ) * ( root + 1 ) <= x ) {
+		root++;
+	}
+	return root;
+}
 
-	// m = 0x4000'0000'0000'0000
-	uint64_t m = ( __lzcnt64( x ) | 1ULL ) + 1ULL;
-	m = 1ULL << ( sizeof( uint64_t ) * 8 - m );
+// bit r of bits is set iff r is a square modulo m, m <= 128.
+struct square_residues {
+	uint64_t bits[ 2 ];
+};
 
-	uint64_t y = 0;
-	while ( m != 0 ) {
-		const uint64_t b = y | m;
-		y = y >> 1;
-		if ( x >= b ) {
-			x -= b;
-			y |= m;
-		}
-		m = m >> 2;
+constexpr square_residues make_square_residues( const uint64_t m ) {
+	square_residues s{ { 0, 0 } };
+	for ( uint64_t i = 0; i < m; i++ ) {
+		const uint64_t r = i * i % m;
+		s.bits[ r >> 6 ] |= 1ULL << ( r & 63 );
 	}
-	return y;
+	return s;
 }
 
+constexpr bool is_square_residue( const square_residues &s, const uint64_t r ) {
+	return ( s.bits[ r >> 6 ] >> ( r & 63 ) ) & 1;
+}
+
+// Fractions of squares : 12 / 64, 16 / 63, 21 / 65, 6 / 11. Together less than 1% of non-squares pass.
+constexpr square_residues squares_64 = make_square_residues( 64 );
+constexpr square_residues squares_63 = make_square_residues( 63 );
+constexpr square_residues squares_65 = make_square_residues( 65 );
+constexpr square_residues squares_11 = make_square_residues( 11 );
+
 /**
  * is_square( x )
+ * Quadratic residue filters modulo 64, 63, 65 and 11 ( one division by 63 * 65 * 11 ), then isqrt().
  * @param x
  * @return Returns true if x is a square number.
  */
-bool is_square( uint64_t x ) {
+bool is_square( const uint64_t x ) {
+	if ( !is_square_residue( squares_64, x & 63 ) ) {
+		return false;
+	}
+	const uint64_t r = x % ( 63 * 65 * 11 );
+	if ( !is_square_residue( squares_63, r % 63 ) || !is_square_residue( squares_65, r % 65 ) ||
+	     !is_square_residue( squares_11, r % 11 ) ) {
+		return false;
+	}
 	const uint64_t root = isqrt( x );
 	return x == root * root;
 }
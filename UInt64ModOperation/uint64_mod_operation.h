@@ -1,18 +1,23 @@
 #pragma once
 
-#include <intrin.h>
 #include <stdint.h>
 
 #include <limits>
 #include <map>
 #include <stdexcept>
 
+#include "uint128_arith.h"
+
 uint64_t uaddmod64( uint64_t a, uint64_t b, uint64_t p );
 uint64_t usubmod64( uint64_t a, uint64_t b, uint64_t p );
 uint64_t umulmod64( const uint64_t a, const uint64_t b, const uint64_t mod );
 uint64_t powmod64( const uint64_t a, const uint64_t e, const uint64_t mod );
+uint64_t multi_powmod64( const uint64_t *bases, const uint64_t *exps, size_t count, uint64_t mod );
 uint64_t umodinv64( uint64_t a, uint64_t m );
+uint64_t umodinv64_ct( uint64_t a, uint64_t mod );
+uint64_t ugcd64( uint64_t a, uint64_t b );
 bool is_prime( uint64_t self );
+bool bpsw_is_prime( uint64_t n );
 uint64_t isqrt( uint64_t x );
 bool is_square( uint64_t x );
 
@@ -20,3 +25,67 @@ template <typename T>
 bool is_add_overflow( const T a, const T b ) {
 	return a > std::numeric_limits<T>::max() - b;
 }
+
+/**
+ * pow_window_bits( uint64_t e )
+ * Window size for sliding-window exponentiation, from the bit length of e ( HAC Table 14.16 ).
+ * @param e exponent
+ * @return k : 2^( k - 1 ) odd powers are precomputed, k = 1 is left-to-right binary
+ */
+inline int pow_window_bits( const uint64_t e ) {
+	const int bits = 64 - ulzcnt64( e );
+	return ( bits <= 8 ) ? 1 : ( bits <= 24 ) ? 2 : 3;
+}
+
+/**
+ * sliding_window_pow( const Ring &ring, uint64_t a, uint64_t e )
+ * Left-to-right sliding-window exponentiation. Ring provides one() and mul( x, y ), with a in the same representation.
+ * @param ring
+ * @param a base
+ * @param e exponent
+ * @return a ** e, 0 ** 0 = ring.one()
+ */
+template <typename Ring>
+uint64_t sliding_window_pow( const Ring &ring, const uint64_t a, const uint64_t e ) {
+	if ( e == 0 ) {
+		return ring.one();
+	}
+	const int k = pow_window_bits( e );
+
+	// odd[ i ] = a^( 2i + 1 )
+	uint64_t odd[ 4 ] = { a };
+	if ( k > 1 ) {
+		const uint64_t a2 = ring.mul( a, a );
+		for ( int i = 1; i < ( 1 << ( k - 1 ) ); i++ ) {
+			odd[ i ] = ring.mul( odd[ i - 1 ], a2 );
+		}
+	}
+
+	uint64_t ans = ring.one();
+	bool first = true;
+	for ( int i = 63 - ulzcnt64( e ); i >= 0; ) {
+		if ( ( ( e >> i ) & 1 ) == 0 ) {
+			ans = ring.mul( ans, ans );
+			i--;
+			continue;
+		}
+		// Window e[ i .. j ] : at most k bits, ends with a 1.
+		int j = ( i - k + 1 > 0 ) ? i - k + 1 : 0;
+		while ( ( ( e >> j ) & 1 ) == 0 ) {
+			j++;
+		}
+		const int width = i - j + 1;
+		const uint64_t w = ( e >> j ) & ( ( 1ULL << width ) - 1 );
+		if ( first ) {
+			ans = odd[ w >> 1 ];
+			first = false;
+		} else {
+			for ( int t = 0; t < width; t++ ) {
+				ans = ring.mul( ans, ans );
+			}
+			ans = ring.mul( ans, odd[ w >> 1 ] );
+		}
+		i = j - 1;
+	}
+	return ans;
+}
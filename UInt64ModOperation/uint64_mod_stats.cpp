@@ -0,0 +1,112 @@
+#include "uint64_mod_stats.h"
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ ) || defined( _M_IX86 )
+#define UINT64MOD_STATS_RDTSC 1
+#if defined( _MSC_VER ) && !defined( __clang__ )
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace stats {
+
+static const char *const names[ counter_count ] = {
+    "umulmod_calls",     "umulmod_trivial",   "umulmod_unreduced",
+    "powmod_calls",      "powmod_montgomery", "powmod_barrett",    "powmod_ticks",
+    "is_prime_calls",    "is_prime_mr_calls", "is_prime_mr_composite",
+    "is_prime_mr_bases", "is_prime_bases_1",  "is_prime_bases_2",  "is_prime_bases_3", "is_prime_bases_4",
+    "is_prime_bases_5",  "is_prime_bases_6",  "is_prime_bases_7",  "is_prime_ticks",
+};
+
+const char *name( const counter c ) { return ( c >= 0 && c < counter_count ) ? names[ c ] : ""; }
+
+uint64_t ticks() {
+#if defined( UINT64MOD_STATS_RDTSC )
+	return __rdtsc();
+#else
+	return static_cast<uint64_t>(
+	    std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() )
+	        .count() );
+#endif
+}
+
+#if defined( UINT64MOD_STATS )
+// Live blocks, and the totals of the threads that have exited.
+struct registry {
+	std::mutex lock;
+	std::vector<block *> blocks;
+	uint64_t retired[ counter_count ] = {};
+};
+
+// Never destroyed : thread_local blocks of other threads may outlive static destruction.
+static registry &get_registry() {
+	static registry *r = new registry;
+	return *r;
+}
+
+block::block() {
+	for ( auto &&v : value ) {
+		v.store( 0, std::memory_order_relaxed );
+	}
+	registry &r = get_registry();
+	std::lock_guard<std::mutex> guard( r.lock );
+	r.blocks.push_back( this );
+}
+
+block::~block() {
+	registry &r = get_registry();
+	std::lock_guard<std::mutex> guard( r.lock );
+	for ( int c = 0; c < counter_count; c++ ) {
+		r.retired[ c ] += value[ c ].load( std::memory_order_relaxed );
+	}
+	for ( size_t i = 0; i < r.blocks.size(); i++ ) {
+		if ( r.blocks[ i ] == this ) {
+			r.blocks[ i ] = r.blocks.back();
+			r.blocks.pop_back();
+			break;
+		}
+	}
+}
+
+snapshot collect() {
+	// Register the calling thread, so that its block is not created while the lock is held.
+	static_cast<void>( &local );
+	snapshot s{};
+	registry &r = get_registry();
+	std::lock_guard<std::mutex> guard( r.lock );
+	for ( int c = 0; c < counter_count; c++ ) {
+		s.value[ c ] = r.retired[ c ];
+	}
+	for ( auto &&b : r.blocks ) {
+		for ( int c = 0; c < counter_count; c++ ) {
+			s.value[ c ] += b->value[ c ].load( std::memory_order_relaxed );
+		}
+	}
+	return s;
+}
+
+void reset() {
+	static_cast<void>( &local );
+	registry &r = get_registry();
+	std::lock_guard<std::mutex> guard( r.lock );
+	for ( int c = 0; c < counter_count; c++ ) {
+		r.retired[ c ] = 0;
+	}
+	for ( auto &&b : r.blocks ) {
+		for ( auto &&v : b->value ) {
+			v.store( 0, std::memory_order_relaxed );
+		}
+	}
+}
+#else
+snapshot collect() { return snapshot{}; }
+
+void reset() {}
+#endif
+
+}  // namespace stats
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+// Hot-path counters for umulmod64(), powmod64() and is_prime().
+// Counting is compiled in only with UINT64MOD_STATS ( CMake option UINT64MOD_STATS ); otherwise the
+// UINT64MOD_STAT_* hooks expand to nothing, and collect() returns zeros.
+// Every thread counts into its own block; collect() sums the blocks of the live threads and the totals left by the
+// threads that have exited.
+namespace stats {
+
+#if defined( UINT64MOD_STATS )
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+enum counter : int {
+	umulmod_calls,
+	umulmod_trivial,    // a or b ≡ 0, or mod == 1
+	umulmod_unreduced,  // a >= mod or b >= mod : reduced with a division first
+	powmod_calls,       // calls - montgomery - barrett : mod == 1, e == 0, a ≡ 0, 1 or -1
+	powmod_montgomery,  // odd mod
+	powmod_barrett,     // even mod
+	powmod_ticks,
+	is_prime_calls,     // calls - mr_calls : decided by trial division
+	is_prime_mr_calls,
+	is_prime_mr_composite,
+	is_prime_mr_bases,  // bases tried, all calls
+	is_prime_bases_1,   // calls that tried 1 .. 7 bases
+	is_prime_bases_2,
+	is_prime_bases_3,
+	is_prime_bases_4,
+	is_prime_bases_5,
+	is_prime_bases_6,
+	is_prime_bases_7,
+	is_prime_ticks,
+	counter_count
+};
+
+/**
+ * name( counter c )
+ * @return "umulmod_calls", ...
+ */
+const char *name( counter c );
+
+struct snapshot {
+	uint64_t value[ counter_count ];
+
+	uint64_t operator[]( const counter c ) const { return value[ c ]; }
+};
+
+/**
+ * collect()
+ * Counts of the calling thread are exact; those of other running threads may miss their last few updates.
+ * @return totals over all threads since the last reset()
+ */
+snapshot collect();
+
+/**
+ * reset()
+ * Zero every counter. Updates made concurrently by other threads may be lost.
+ */
+void reset();
+
+/**
+ * ticks()
+ * @return time stamp counter ( rdtsc ) on x86, steady_clock nanoseconds elsewhere
+ */
+uint64_t ticks();
+
+#if defined( UINT64MOD_STATS )
+struct block {
+	block();
+	~block();
+
+	// Written only by the owning thread : relaxed load and store, no locked read-modify-write.
+	std::atomic<uint64_t> value[ counter_count ];
+};
+
+inline thread_local block local;
+
+inline void add( const counter c, const uint64_t n ) {
+	std::atomic<uint64_t> &v = local.value[ c ];
+	v.store( v.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+}
+
+/**
+ * timer
+ * Adds the ticks between construction and destruction to a counter.
+ */
+class timer {
+   public:
+	explicit timer( const counter c ) : counter_( c ), start_( ticks() ) {}
+	~timer() { add( counter_, ticks() - start_ ); }
+	timer( const timer & ) = delete;
+	timer &operator=( const timer & ) = delete;
+
+   private:
+	counter counter_;
+	uint64_t start_;
+};
+
+#define UINT64MOD_STAT_ADD( c, n ) stats::add( static_cast<stats::counter>( stats::c ), ( n ) )
+#define UINT64MOD_STAT_TIMER( c ) const stats::timer uint64mod_stat_timer_( stats::c )
+#else
+#define UINT64MOD_STAT_ADD( c, n ) ( ( void )0 )
+#define UINT64MOD_STAT_TIMER( c ) ( ( void )0 )
+#endif
+
+#define UINT64MOD_STAT_INC( c ) UINT64MOD_STAT_ADD( c, 1 )
+
+}  // namespace stats
@@ -5,4 +5,13 @@
 
 #pragma once
 
+#include <math.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
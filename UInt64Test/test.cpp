@@ -1,6 +1,23 @@
 #include "pch.h"
 
+#include "../UInt64ModOperation/barrett64.h"
+#include "../UInt64ModOperation/factor64.h"
+#include "../UInt64ModOperation/lucas64.h"
+#include "../UInt64ModOperation/mod_arith.h"
+#include "../UInt64ModOperation/fixed_base_pow.h"
+#include "../UInt64ModOperation/modint64.h"
+#include "../UInt64ModOperation/montgomery64.h"
+#include "../UInt64ModOperation/multiplicative64.h"
+#include "../UInt64ModOperation/ntt64.h"
+#include "../UInt64ModOperation/prime_sieve.h"
+#include "../UInt64ModOperation/range_scanner.h"
+#include "../UInt64ModOperation/rns64.h"
+#include "../UInt64ModOperation/sqrtmod64.h"
+#include "../UInt64ModOperation/uint64_mod_batch.h"
+#include "../UInt64ModOperation/uint64_mod_ct.h"
 #include "../UInt64ModOperation/uint64_mod_operation.h"
+#include "../UInt64ModOperation/uint64_mod_stats.h"
+#include "../UInt64Tool/operand_text.h"
 
 TEST( TestCaseName, uaddmod64 ) {
 	uint64_t a, b, c;
@@ -95,6 +112,180 @@ TEST( TestCaseName, umodinv64_large_number ) {
 	}
 }
 
+TEST( TestCaseName, umodinv64_composite ) {
+	// Odd and even composite moduli
+	std::vector<uint64_t> moduli{ 1, 2, 9, 15, 16, 1000, 65536, 0xFFFF'FFFF'FFFF'FFFF, 0xFFFF'FFFF'FFFF'FFFE,
+	                              4294967291ULL * 4294967279ULL };
+	for ( auto &&mod : moduli ) {
+		for ( uint64_t i = 0, a = 0; i < 1000; i++, a = a * 0x9E37'79B9'7F4A'7C15ULL + 12345 ) {
+			if ( ugcd64( a % mod, mod ) == 1 ) {
+				const uint64_t inv = umodinv64( a, mod );
+				EXPECT_EQ( 1 % mod, umulmod64( a, inv, mod ) ) << a << " " << mod;
+				if ( mod & 1 ) {
+					EXPECT_EQ( inv, umodinv64_ct( a, mod ) ) << a << " " << mod;
+				}
+			} else {
+				EXPECT_THROW( umodinv64( a, mod ), std::overflow_error ) << a << " " << mod;
+				if ( mod & 1 ) {
+					EXPECT_THROW( umodinv64_ct( a, mod ), std::overflow_error ) << a << " " << mod;
+				}
+			}
+		}
+	}
+	EXPECT_THROW( umodinv64( 3, 0 ), std::overflow_error );
+	EXPECT_THROW( umodinv64_ct( 3, 10 ), std::invalid_argument );
+}
+
+TEST( TestCaseName, umodinv64_ct ) {
+	const uint64_t prime = 18446744073709551557ULL;
+	for ( uint64_t i = 1; i < 1000; i++ ) {
+		EXPECT_EQ( umodinv64( i, prime ), umodinv64_ct( i, prime ) );
+		EXPECT_EQ( umodinv64( prime - i, prime ), umodinv64_ct( prime - i, prime ) );
+	}
+	EXPECT_EQ( 1, umodinv64_ct( 1, 3 ) );
+	EXPECT_EQ( 2, umodinv64_ct( 2, 3 ) );
+	EXPECT_EQ( 0, umodinv64_ct( 0, 1 ) );
+}
+
+TEST( TestCaseName, Barrett64 ) {
+	std::vector<uint64_t> moduli{ 1,
+	                              2,
+	                              3,
+	                              0x8000,
+	                              65497,
+	                              3ULL << 40,
+	                              0x8000'0000'0000'0000,
+	                              0xFFFF'FFFF'FFFF'FFC5,
+	                              0xFFFF'FFFF'FFFF'FFFE,
+	                              0xFFFF'FFFF'FFFF'FFFF };
+
+	for ( auto &&mod : moduli ) {
+		const Barrett64 br( mod );
+		EXPECT_EQ( mod, br.modulus() );
+		EXPECT_EQ( 1 % mod, br.one() );
+
+		for ( uint64_t a = mod - 1, i = 0; i < 100; a = a * 0x9E37'79B9'7F4A'7C15ULL + 1, i++ ) {
+			const uint64_t b = a ^ 0x5555'5555'5555'5555ULL;
+			const uint64_t ra = br.reduce( a );
+			const uint64_t rb = br.reduce( b );
+
+			EXPECT_EQ( a % mod, ra );
+			EXPECT_EQ( umulmod64( a, b, mod ), br.mul( ra, rb ) );
+			EXPECT_EQ( umulmod64( a, b, mod ), umulmod64( a, b, br ) );
+			EXPECT_EQ( uaddmod64( a, b, mod ), uaddmod64( a, b, br ) );
+			EXPECT_EQ( usubmod64( a, b, mod ), usubmod64( a, b, br ) );
+
+			uint64_t expected = 1 % mod;
+			for ( uint64_t e = 0; e < 20; e++ ) {
+				EXPECT_EQ( expected, br.pow( ra, e ) );
+				expected = umulmod64( expected, a, mod );
+			}
+		}
+	}
+
+	// Largest remainder
+	const Barrett64 br( 0xFFFF'FFFF'FFFF'FFFE );
+	EXPECT_EQ( 0xFFFF'FFFF'FFFF'FFFDULL, br.reduce( 0xFFFF'FFFF'FFFF'FFFD, 0xFFFF'FFFF'FFFF'FFFF ) );
+	EXPECT_EQ( 1ULL, umulmod64( 0xFFFF'FFFF'FFFF'FFFD, 0xFFFF'FFFF'FFFF'FFFD, br ) );
+	EXPECT_THROW( Barrett64( 0 ), std::overflow_error );
+}
+
+TEST( TestCaseName, ct_arithmetic ) {
+	std::vector<uint64_t> moduli{ 1, 2, 3, 0x8000, 65497, 3ULL << 40, 0x8000'0000'0000'0000, 0xFFFF'FFFF'FFFF'FFC5,
+	                              0xFFFF'FFFF'FFFF'FFFE, 0xFFFF'FFFF'FFFF'FFFF };
+	for ( auto &&mod : moduli ) {
+		const Barrett64 br( mod );
+		uint64_t x = mod;
+		for ( int i = 0; i < 500; i++ ) {
+			x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+			const uint64_t a = ( i == 0 ) ? 0 : ( i == 1 ) ? mod - 1 : x % mod;
+			const uint64_t b = ( i == 0 ) ? mod - 1 : ( i == 1 ) ? mod - 1 : ( x >> 17 ) % mod;
+			const uint64_t e = x >> ( i % 64 );
+			EXPECT_EQ( uaddmod64( a, b, mod ), ct::uaddmod64( a, b, mod ) ) << mod << " " << a << " " << b;
+			EXPECT_EQ( usubmod64( a, b, mod ), ct::usubmod64( a, b, mod ) ) << mod << " " << a << " " << b;
+			EXPECT_EQ( umulmod64( a, b, mod ), ct::umulmod64( a, b, mod ) ) << mod << " " << a << " " << b;
+			EXPECT_EQ( powmod64( a, e, mod ), ct::powmod64( a, e, mod ) ) << mod << " " << a << " " << e;
+			EXPECT_EQ( br.mul( a, b ), ct::umulmod64( a, b, br ) ) << mod << " " << a << " " << b;
+			EXPECT_EQ( br.pow( a, e ), ct::powmod64( a, e, br ) ) << mod << " " << a << " " << e;
+			if ( ( mod & 1 ) && ugcd64( a, mod ) == 1 ) {
+				EXPECT_EQ( umodinv64( a, mod ), ct::umodinv64( a, mod ) ) << mod << " " << a;
+			}
+		}
+	}
+	EXPECT_THROW( ct::umulmod64( 1, 1, 0 ), std::overflow_error );
+}
+
+/**
+ * dudect_t( Op op, uint64_t fixed, size_t measurements )
+ * dudect : time op on a fixed input class and a random input class in random order, crop the slowest measurements
+ * and return Welch's t statistic of the two timing distributions. Inputs of the random class are < 2^64 - 59.
+ */
+template <typename Op>
+static double dudect_t( Op op, const uint64_t fixed, const size_t measurements ) {
+	const int batch = 256;
+	std::vector<uint64_t> inputs( batch );
+	std::vector<std::pair<int, double>> samples;
+	uint64_t x = 0x1234'5678'9ABC'DEF0ULL;
+	volatile uint64_t sink = 0;
+	for ( size_t m = 0; m < measurements; m++ ) {
+		x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+		const int cls = ( x >> 63 ) & 1;
+		for ( auto &&v : inputs ) {
+			x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+			v = ( cls == 0 ) ? fixed : x;
+		}
+		uint64_t acc = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for ( auto &&v : inputs ) {
+			acc += op( v );
+		}
+		const auto stop = std::chrono::steady_clock::now();
+		sink = sink + acc;
+		samples.emplace_back( cls, std::chrono::duration<double, std::nano>( stop - start ).count() );
+	}
+
+	// Crop at the 90th percentile : interrupts and migrations only make measurements slower.
+	std::vector<double> times;
+	for ( auto &&s : samples ) {
+		times.push_back( s.second );
+	}
+	std::nth_element( times.begin(), times.begin() + times.size() * 9 / 10, times.end() );
+	const double crop = times[ times.size() * 9 / 10 ];
+
+	double n[ 2 ] = { 0, 0 }, mean[ 2 ] = { 0, 0 }, m2[ 2 ] = { 0, 0 };
+	for ( auto &&[ cls, t ] : samples ) {
+		if ( t > crop ) {
+			continue;
+		}
+		// Welford
+		n[ cls ] += 1;
+		const double delta = t - mean[ cls ];
+		mean[ cls ] += delta / n[ cls ];
+		m2[ cls ] += delta * ( t - mean[ cls ] );
+	}
+	const double v0 = m2[ 0 ] / ( n[ 0 ] - 1 ), v1 = m2[ 1 ] / ( n[ 1 ] - 1 );
+	return ( mean[ 0 ] - mean[ 1 ] ) / sqrt( v0 / n[ 0 ] + v1 / n[ 1 ] );
+}
+
+TEST( TestCaseName, ct_timing ) {
+	// | t | > 10 : the timing depends on the input class with overwhelming probability ( dudect ).
+	const double threshold = 10;
+	const size_t measurements = 40000;
+	const uint64_t mod = 0xFFFF'FFFF'FFFF'FFC5;
+	const uint64_t base = 0x0123'4567'89AB'CDEF;
+
+	const double t_add = dudect_t( [ & ]( uint64_t v ) { return ct::uaddmod64( base, v, mod ); }, 0, measurements );
+	EXPECT_LT( fabs( t_add ), threshold ) << "ct::uaddmod64 t = " << t_add;
+	const double t_mul = dudect_t( [ & ]( uint64_t v ) { return ct::umulmod64( base, v, mod ); }, 0, measurements );
+	EXPECT_LT( fabs( t_mul ), threshold ) << "ct::umulmod64 t = " << t_mul;
+	const double t_pow = dudect_t( [ & ]( uint64_t e ) { return ct::powmod64( base, e, mod ); }, 0, measurements / 20 );
+	EXPECT_LT( fabs( t_pow ), threshold ) << "ct::powmod64 t = " << t_pow;
+
+	// The variable-time powmod64() returns early for e = 0 : the test must see it.
+	const double t_leak = dudect_t( [ & ]( uint64_t e ) { return powmod64( base, e, mod ); }, 0, measurements / 20 );
+	EXPECT_GT( fabs( t_leak ), threshold ) << "powmod64 t = " << t_leak;
+}
+
 TEST( TestCaseName, umulmod64 ) {
 	uint64_t a, b, c, p, ans;
 
@@ -130,6 +321,90 @@ TEST( TestCaseName, umulmod64 ) {
 	EXPECT_EQ( 1, umulmod64( 5, umodinv64( 5, c ), c ) );
 }
 
+static uint64_t powmod64_naive( uint64_t a, uint64_t e, const uint64_t mod ) {
+	uint64_t ans = 1 % mod;
+	a %= mod;
+	while ( e ) {
+		if ( e & 1 ) {
+			ans = umulmod64( ans, a, mod );
+		}
+		a = umulmod64( a, a, mod );
+		e >>= 1;
+	}
+	return ans;
+}
+
+TEST( TestCaseName, powmod64 ) {
+	EXPECT_EQ( 1, powmod64( 0, 0, 7 ) );
+	EXPECT_EQ( 0, powmod64( 0, 5, 7 ) );
+	EXPECT_EQ( 0, powmod64( 5, 0, 1 ) );
+	// The exponent is not reduced by mod : 2^7 % 7 = 2, 2^( 7 % 7 ) = 1.
+	EXPECT_EQ( 2, powmod64( 2, 7, 7 ) );
+	EXPECT_EQ( 59, powmod64( 2, 64, 18446744073709551557ULL ) );
+	EXPECT_EQ( 0, powmod64( 2, 64, 0x8000'0000'0000'0000ULL ) );
+	EXPECT_EQ( 0x8000'0000'0000'0000ULL, powmod64( 2, 63, 0x8000'0000'0000'0001ULL ) );
+
+	std::vector<uint64_t> moduli{ 2, 3, 12, 65497, 0xFFFF'FFFB, 3ULL << 40, 0xFFFF'FFFF'FFFF'FFC5, 0xFFFF'FFFF'FFFF'FFFE };
+	for ( auto &&mod : moduli ) {
+		uint64_t x = mod;
+		for ( int i = 0; i < 200; i++ ) {
+			x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+			// Exponents of every bit length, some larger than mod.
+			const uint64_t a = x ^ ( x >> 29 );
+			const uint64_t e = x >> ( i % 64 );
+			EXPECT_EQ( powmod64_naive( a, e, mod ), powmod64( a, e, mod ) ) << mod << " " << a << " " << e;
+		}
+	}
+	EXPECT_THROW( powmod64( 2, 3, 0 ), std::overflow_error );
+}
+
+TEST( TestCaseName, multi_powmod64 ) {
+	EXPECT_EQ( 1, multi_powmod64( nullptr, nullptr, 0, 7 ) );
+	const uint64_t b2[] = { 3, 5 }, e2[] = { 4, 2 };
+	EXPECT_EQ( ( 81 * 25 ) % 1000, multi_powmod64( b2, e2, 2, 1000 ) );
+	EXPECT_EQ( 0, multi_powmod64( b2, e2, 2, 1 ) );
+
+	std::vector<uint64_t> moduli{ 2, 12, 65497, 0xFFFF'FFFB, 3ULL << 40, 0xFFFF'FFFF'FFFF'FFC5, 0xFFFF'FFFF'FFFF'FFFE };
+	for ( auto &&mod : moduli ) {
+		uint64_t x = mod;
+		for ( size_t count = 1; count <= 6; count++ ) {
+			std::vector<uint64_t> bases( count ), exps( count );
+			for ( int t = 0; t < 20; t++ ) {
+				uint64_t expected = 1 % mod;
+				for ( size_t j = 0; j < count; j++ ) {
+					x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+					bases[ j ] = ( t == 0 && j == 0 ) ? 0 : x ^ ( x >> 31 );
+					exps[ j ] = ( t == 1 ) ? 0 : x >> ( ( t * 7 + j * 13 ) % 64 );
+					expected = umulmod64( expected, powmod64( bases[ j ], exps[ j ], mod ), mod );
+				}
+				EXPECT_EQ( expected, multi_powmod64( bases.data(), exps.data(), count, mod ) ) << mod << " " << count;
+			}
+		}
+	}
+	EXPECT_THROW( multi_powmod64( b2, e2, 2, 0 ), std::overflow_error );
+}
+
+TEST( TestCaseName, FixedBasePow ) {
+	std::vector<uint64_t> moduli{ 1, 2, 12, 65497, 0xFFFF'FFFB, 3ULL << 40, 0xFFFF'FFFF'FFFF'FFC5, 0xFFFF'FFFF'FFFF'FFFE };
+	for ( auto &&mod : moduli ) {
+		for ( auto &&base : { 0ULL, 1ULL, 3ULL, 0xFFFF'FFFF'FFFF'FFFFULL } ) {
+			for ( int teeth : { 1, 5, 8, 16 } ) {
+				const FixedBasePow fb( base, mod, teeth );
+				EXPECT_EQ( base, fb.base() );
+				EXPECT_EQ( mod, fb.modulus() );
+				uint64_t x = mod + base;
+				for ( int i = 0; i < 50; i++ ) {
+					x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+					const uint64_t e = ( i == 0 ) ? 0 : ( i == 1 ) ? ~0ULL : x >> ( i % 64 );
+					EXPECT_EQ( powmod64_naive( base, e, mod ), fb.pow( e ) ) << mod << " " << base << " " << e;
+				}
+			}
+		}
+	}
+	EXPECT_THROW( FixedBasePow( 2, 0 ), std::overflow_error );
+	EXPECT_THROW( FixedBasePow( 2, 7, 17 ), std::invalid_argument );
+}
+
 TEST( TestCaseName, is_prime ) {
 	EXPECT_TRUE( is_prime( 2ULL ) );
 	EXPECT_TRUE( is_prime( 3ULL ) );
@@ -178,6 +453,389 @@ TEST( TestCaseName, is_prime ) {
 	EXPECT_FALSE( is_prime( 4294966813ULL * 4294966769ULL ) );
 }
 
+TEST( TestCaseName, is_prime_strong_pseudoprime ) {
+	// Strong pseudoprimes to the bases 2, 3, 5, ...
+	std::vector<uint64_t> pseudoprimes{ 2047ULL,
+	                                    3277ULL,
+	                                    4033ULL,
+	                                    4681ULL,
+	                                    8321ULL,
+	                                    1373653ULL,
+	                                    25326001ULL,
+	                                    3215031751ULL,
+	                                    2152302898747ULL,
+	                                    3474749660383ULL,
+	                                    341550071728321ULL,
+	                                    3825123056546413051ULL,
+	                                    318665857834031151ULL,
+	                                    4294967297ULL };
+	for ( auto &&n : pseudoprimes ) {
+		EXPECT_FALSE( is_prime( n ) ) << n;
+	}
+
+	// 1849 = 43 * 43 : the first composite without a factor below 43.
+	EXPECT_FALSE( is_prime( 1849ULL ) );
+	EXPECT_TRUE( is_prime( 1847ULL ) );
+	EXPECT_TRUE( is_prime( 4294967291ULL ) );
+	EXPECT_TRUE( is_prime( 4294967311ULL ) );
+
+	// Sieve of Eratosthenes
+	const uint64_t limit = 200000;
+	std::vector<bool> composite( limit, false );
+	for ( uint64_t i = 2; i < limit; i++ ) {
+		if ( !composite[ i ] ) {
+			for ( uint64_t j = i * i; j < limit; j += i ) {
+				composite[ j ] = true;
+			}
+		}
+		EXPECT_EQ( !composite[ i ], is_prime( i ) ) << i;
+	}
+}
+
+TEST( TestCaseName, stats ) {
+	stats::reset();
+	EXPECT_EQ( 3, umulmod64( 4, 6, 7 ) );
+	EXPECT_EQ( 5, umulmod64( 10, 4, 7 ) );
+	EXPECT_EQ( 0, umulmod64( 0, 4, 7 ) );
+	EXPECT_EQ( 24, powmod64( 2, 10, 1000 ) );
+	EXPECT_EQ( 23, powmod64( 2, 10, 1001 ) );
+	EXPECT_EQ( 1, powmod64( 5, 0, 7 ) );
+	EXPECT_FALSE( is_prime( 9 ) );
+	EXPECT_TRUE( is_prime( 1000000007ULL ) );
+	EXPECT_FALSE( is_prime( 3215031751ULL ) );
+	EXPECT_TRUE( is_prime( 0xFFFF'FFFF'FFFF'FFC5ULL ) );
+	EXPECT_FALSE( is_prime( 1000000007ULL * 998244353ULL ) );
+	// Counts of an exited thread are kept.
+	std::thread( [] { is_prime( 1000000009ULL ); } ).join();
+
+	const stats::snapshot counts = stats::collect();
+	if ( !stats::enabled ) {
+		for ( int c = 0; c < stats::counter_count; c++ ) {
+			EXPECT_EQ( 0, counts.value[ c ] ) << stats::name( static_cast<stats::counter>( c ) );
+		}
+		return;
+	}
+	EXPECT_EQ( 3, counts[ stats::umulmod_calls ] );
+	EXPECT_EQ( 1, counts[ stats::umulmod_unreduced ] );
+	EXPECT_EQ( 1, counts[ stats::umulmod_trivial ] );
+	EXPECT_EQ( 3, counts[ stats::powmod_calls ] );
+	EXPECT_EQ( 1, counts[ stats::powmod_montgomery ] );
+	EXPECT_EQ( 1, counts[ stats::powmod_barrett ] );
+	EXPECT_LT( 0, counts[ stats::powmod_ticks ] );
+	EXPECT_EQ( 6, counts[ stats::is_prime_calls ] );
+	EXPECT_EQ( 5, counts[ stats::is_prime_mr_calls ] );
+	EXPECT_EQ( 2, counts[ stats::is_prime_mr_composite ] );
+	// 2 + 2 + 2 + 7 + 1
+	EXPECT_EQ( 14, counts[ stats::is_prime_mr_bases ] );
+	EXPECT_EQ( 1, counts[ stats::is_prime_bases_1 ] );
+	EXPECT_EQ( 3, counts[ stats::is_prime_bases_2 ] );
+	EXPECT_EQ( 1, counts[ stats::is_prime_bases_7 ] );
+	EXPECT_LT( 0, counts[ stats::is_prime_ticks ] );
+	EXPECT_STREQ( "is_prime_bases_7", stats::name( stats::is_prime_bases_7 ) );
+
+	stats::reset();
+	EXPECT_EQ( 0, stats::collect()[ stats::is_prime_calls ] );
+}
+
+TEST( TestCaseName, lucas_uv64 ) {
+	// P = 1, Q = -1 : Fibonacci and Lucas numbers, exact below 2^64 - 59.
+	const uint64_t n = 0xFFFF'FFFF'FFFF'FFC5ULL;
+	uint64_t f0 = 0, f1 = 1, l0 = 2, l1 = 1;
+	for ( uint64_t k = 0; k <= 90; k++ ) {
+		const lucas_terms<uint64_t> t = lucas_uv64( 1, -1, k, n );
+		EXPECT_EQ( f0, t.u ) << k;
+		EXPECT_EQ( l0, t.v ) << k;
+		EXPECT_EQ( ( k & 1 ) ? n - 1 : 1, t.qk ) << k;
+		const uint64_t f = f0 + f1, l = l0 + l1;
+		f0 = f1;
+		f1 = f;
+		l0 = l1;
+		l1 = l;
+	}
+	// U_p ≡ ( D / p ), V_p ≡ P ( mod p ) for a prime p, D = P^2 - 4Q.
+	std::mt19937_64 rng( 25 );
+	for ( const uint64_t p : { 1000000007ULL, 0xFFFF'FFFF'FFFF'FFC5ULL } ) {
+		for ( int i = 0; i < 100; i++ ) {
+			const int64_t P = static_cast<int64_t>( rng() % 2001 ) - 1000, Q = static_cast<int64_t>( rng() % 2001 ) - 1000;
+			const int64_t D = P * P - 4 * Q;
+			const int j = jacobi64( ( D < 0 ) ? p - static_cast<uint64_t>( -D ) % p : static_cast<uint64_t>( D ), p );
+			const lucas_terms<uint64_t> t = lucas_uv64( P, Q, p, p );
+			EXPECT_EQ( ( j < 0 ) ? p - 1 : static_cast<uint64_t>( j ), t.u ) << P << " " << Q;
+			EXPECT_EQ( ( P < 0 ) ? p - static_cast<uint64_t>( -P ) : static_cast<uint64_t>( P ), t.v ) << P << " " << Q;
+			// N limbs, same modulus.
+			const lucas_terms<uint_n<2>> t2 = lucas_uv( P, Q, uint_n<2>::from( p ), uint_n<2>::from( p ) );
+			EXPECT_EQ( uint_n<2>::from( t.u ), t2.u );
+			EXPECT_EQ( uint_n<2>::from( t.v ), t2.v );
+			EXPECT_EQ( uint_n<2>::from( t.qk ), t2.qk );
+		}
+	}
+	EXPECT_THROW( lucas_uv64( 1, -1, 10, 1000 ), std::invalid_argument );
+}
+
+TEST( TestCaseName, bpsw_is_prime ) {
+	// Strong Lucas pseudoprimes ( OEIS A217255 ) : not base 2 strong pseudoprimes.
+	for ( const uint64_t n : { 5459ULL, 5777ULL, 10877ULL, 16109ULL, 18971ULL, 22499ULL, 24569ULL, 25199ULL, 40309ULL,
+	                           58519ULL } ) {
+		EXPECT_TRUE( is_strong_lucas_prp64( n ) ) << n;
+		EXPECT_FALSE( bpsw_is_prime( n ) ) << n;
+	}
+	// Base 2 strong pseudoprimes, and squares : no D with ( D / n ) = -1.
+	for ( const uint64_t n : { 2047ULL, 3277ULL, 4033ULL, 3215031751ULL, 3825123056546413051ULL, 318665857834031151ULL,
+	                           9ULL, 25ULL, 1849ULL, 4294967291ULL * 4294967291ULL } ) {
+		EXPECT_FALSE( bpsw_is_prime( n ) ) << n;
+	}
+	EXPECT_FALSE( is_strong_lucas_prp64( 4294967291ULL * 4294967291ULL ) );
+
+	for ( uint64_t n = 0; n < 100000; n++ ) {
+		EXPECT_EQ( is_prime( n ), bpsw_is_prime( n ) ) << n;
+		if ( is_prime( n ) ) {
+			EXPECT_TRUE( is_strong_lucas_prp64( n ) ) << n;
+		}
+	}
+	std::mt19937_64 rng( 2025 );
+	for ( int i = 0; i < 100000; i++ ) {
+		const uint64_t n = rng() >> ( i % 64 ) | 1;
+		EXPECT_EQ( is_prime( n ), bpsw_is_prime( n ) ) << n;
+	}
+	for ( int bits = 32; bits <= 64; bits += 8 ) {
+		const uint64_t p = random_prime( bits, rng );
+		EXPECT_TRUE( bpsw_is_prime( p ) ) << p;
+		EXPECT_TRUE( is_strong_lucas_prp64( p ) ) << p;
+	}
+
+	// N limbs
+	const uint_n<2> m127{ { ~0ULL, 0x7FFF'FFFF'FFFF'FFFFULL } };
+	const uint_n<4> m255{ { ~0ULL - 18, ~0ULL, ~0ULL, 0x7FFF'FFFF'FFFF'FFFFULL } };
+	const uint_n<4> c255{ { 0x9F, 0x8000'0000'0000'0000ULL, 0xFFFF'FFFF'FFFF'FFAFULL, 0x7FFF'FFFF'FFFF'FFFFULL } };
+	EXPECT_TRUE( bpsw_is_prime( m127 ) );
+	EXPECT_TRUE( is_strong_lucas_prp( m127 ) );
+	EXPECT_TRUE( bpsw_is_prime( m255 ) );
+	EXPECT_TRUE( bpsw_is_prime( uint_n<2>{ { ~0ULL - 158, ~0ULL } } ) );
+	EXPECT_FALSE( bpsw_is_prime( c255 ) );
+	EXPECT_FALSE( is_strong_lucas_prp( c255 ) );
+	// ( 2^64 - 59 )^2 : a square above 2^64.
+	uint_n<2> square;
+	square.limb[ 0 ] = umul128( 0xFFFF'FFFF'FFFF'FFC5ULL, 0xFFFF'FFFF'FFFF'FFC5ULL, &square.limb[ 1 ] );
+	EXPECT_TRUE( is_square( square ) );
+	EXPECT_EQ( uint_n<2>::from( 0xFFFF'FFFF'FFFF'FFC5ULL ), isqrt( square ) );
+	EXPECT_FALSE( is_strong_lucas_prp( square ) );
+	EXPECT_FALSE( bpsw_is_prime( square ) );
+	for ( int i = 0; i < 300; i++ ) {
+		const uint_n<2> n{ { rng() | 1, rng() >> ( i % 64 ) } };
+		EXPECT_EQ( is_prime( n ), bpsw_is_prime( n ) );
+	}
+	EXPECT_EQ( is_prime( uint_n<1>::from( 1000000007 ) ), bpsw_is_prime( uint_n<1>::from( 1000000007 ) ) );
+}
+
+TEST( TestCaseName, jacobi64 ) {
+	EXPECT_EQ( 1, jacobi64( 0, 1 ) );
+	EXPECT_EQ( 0, jacobi64( 0, 3 ) );
+	EXPECT_EQ( 1, jacobi64( 1, 3 ) );
+	EXPECT_EQ( -1, jacobi64( 2, 3 ) );
+	EXPECT_EQ( 0, jacobi64( 21, 15 ) );
+	EXPECT_EQ( -1, jacobi64( 1001, 9907 ) );
+	EXPECT_EQ( 1, jacobi64( 19, 45 ) );
+	EXPECT_EQ( -1, jacobi64( 8, 21 ) );
+
+	// Euler's criterion for primes
+	for ( auto &&p : { 3ULL, 5ULL, 65497ULL, 998244353ULL, 0xFFFF'FFFF'FFFF'FFC5ULL } ) {
+		uint64_t x = p;
+		for ( int i = 0; i < 200; i++ ) {
+			x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+			const uint64_t e = powmod64( x, ( p - 1 ) / 2, p );
+			EXPECT_EQ( ( e == 0 ) ? 0 : ( e == 1 ) ? 1 : -1, jacobi64( x, p ) ) << x << " " << p;
+		}
+	}
+	// Multiplicative in n
+	for ( uint64_t a = 0; a < 200; a++ ) {
+		EXPECT_EQ( jacobi64( a, 65497 ) * jacobi64( a, 65519 ), jacobi64( a, 65497ULL * 65519 ) ) << a;
+	}
+	EXPECT_THROW( jacobi64( 3, 10 ), std::invalid_argument );
+}
+
+TEST( TestCaseName, sqrtmod64 ) {
+	// p ≡ 3 ( mod 4 ), p ≡ 5 ( mod 8 ), p ≡ 1 ( mod 8 ) with 2^s || p - 1 : s = 3, 4, 23 ( Tonelli-Shanks ),
+	// s = 32, 46 ( Cipolla ).
+	std::vector<uint64_t> primes{ 3,
+	                              65519,
+	                              0xFFFF'FFFF'FFFF'FF43,
+	                              5,
+	                              0xFFFF'FFFF'FFFF'FFC5,
+	                              65497,
+	                              17,
+	                              998244353,
+	                              0xFFFF'FFFF'0000'0001,
+	                              0x3FFF'C000'0000'0001 };
+	for ( auto &&p : primes ) {
+		ASSERT_TRUE( is_prime( p ) ) << p;
+		uint64_t x = p;
+		for ( int i = 0; i < 300; i++ ) {
+			x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+			const uint64_t a = ( p < 1000 ) ? i % p : x % p;
+			if ( jacobi64( a, p ) == -1 ) {
+				EXPECT_THROW( sqrtmod64( a, p ), std::overflow_error ) << a << " " << p;
+				continue;
+			}
+			const uint64_t r = sqrtmod64( a, p );
+			EXPECT_EQ( a, umulmod64( r, r, p ) ) << a << " " << p;
+			EXPECT_LE( r, p - r ) << a << " " << p;
+		}
+	}
+	EXPECT_EQ( 1, sqrtmod64( 1, 2 ) );
+	EXPECT_EQ( 0, sqrtmod64( 65519, 65519 ) );
+	EXPECT_EQ( 3, sqrtmod64( 65519 + 9, 65519 ) );
+	EXPECT_THROW( sqrtmod64( 4, 1 ), std::invalid_argument );
+
+	// Composite p ≡ 1 ( mod 8 ) : squares, and t of no order 2^i in Tonelli-Shanks.
+	for ( const uint64_t p : { 9ULL, 289ULL, 697ULL, 15ULL, 21ULL, 4294967291ULL * 4294967291ULL,
+	                           65537ULL * 65537ULL * 65537ULL } ) {
+		EXPECT_THROW( sqrtmod64( 4, p ), std::invalid_argument ) << p;
+	}
+	// Otherwise a root, or std::invalid_argument, but no endless loop. p - 1 = q * 2^32 : Cipolla.
+	std::vector<uint64_t> composites{ 4294967297ULL, 12884901889ULL, 30064771073ULL };
+	for ( uint64_t p = 9; p < 3000; p += 8 ) {
+		if ( !is_prime( p ) ) {
+			composites.push_back( p );
+		}
+	}
+	for ( auto &&p : composites ) {
+		for ( uint64_t a = 2; a < 40; a++ ) {
+			try {
+				const uint64_t r = sqrtmod64( a, p );
+				EXPECT_EQ( a % p, umulmod64( r, r, p ) ) << a << " " << p;
+			} catch ( const std::invalid_argument & ) {
+			} catch ( const std::overflow_error & ) {
+			}
+		}
+	}
+}
+
+TEST( TestCaseName, totient64 ) {
+	for ( uint64_t n = 1; n <= 300; n++ ) {
+		uint64_t phi = 0;
+		for ( uint64_t a = 1; a <= n; a++ ) {
+			phi += ( ugcd64( a, n ) == 1 ) ? 1 : 0;
+		}
+		EXPECT_EQ( phi, totient64( n ) ) << n;
+
+		// The smallest m with a^m ≡ 1 for every unit a.
+		uint64_t lambda = 1;
+		for ( bool all = false; !all; ) {
+			all = true;
+			for ( uint64_t a = 1; a < n && all; a++ ) {
+				all = ugcd64( a, n ) != 1 || powmod64( a, lambda, n ) == 1;
+			}
+			lambda += all ? 0 : 1;
+		}
+		EXPECT_EQ( lambda, carmichael64( n ) ) << n;
+	}
+	// 2^64 - 1 = 3 * 5 * 17 * 257 * 641 * 65537 * 6700417
+	EXPECT_EQ( 9208981628670443520ULL, totient64( 0xFFFF'FFFF'FFFF'FFFFULL ) );
+	EXPECT_EQ( 17153064960ULL, carmichael64( 0xFFFF'FFFF'FFFF'FFFFULL ) );
+	EXPECT_EQ( 1ULL << 63, totient64( 1ULL << 63 ) + ( 1ULL << 62 ) );
+	EXPECT_EQ( 1ULL << 61, carmichael64( 1ULL << 63 ) );
+	EXPECT_THROW( totient64( 0 ), std::invalid_argument );
+	EXPECT_THROW( carmichael64( 0 ), std::invalid_argument );
+}
+
+TEST( TestCaseName, primitive_root64 ) {
+	EXPECT_EQ( 1, primitive_root64( 2 ) );
+	EXPECT_EQ( 2, primitive_root64( 3 ) );
+	EXPECT_EQ( 3, primitive_root64( 7 ) );
+	EXPECT_EQ( 3, primitive_root64( 998244353 ) );
+	EXPECT_EQ( 5, primitive_root64( 1000000007 ) );
+	EXPECT_EQ( 7, primitive_root64( 0xFFFF'FFFF'0000'0001ULL ) );
+	EXPECT_EQ( 2, primitive_root64( 18446744073709551557U ) );
+	EXPECT_THROW( primitive_root64( 1 ), std::invalid_argument );
+	EXPECT_THROW( primitive_root64( 561 ), std::invalid_argument );
+
+	for ( uint64_t p = 3; p < 1000; p += 2 ) {
+		if ( !is_prime( p ) ) {
+			continue;
+		}
+		// The order of every smaller g is a proper divisor of p - 1.
+		const uint64_t g = primitive_root64( p );
+		for ( uint64_t a = 1; a <= g; a++ ) {
+			uint64_t order = 1;
+			for ( uint64_t x = a % p; x != 1; x = x * a % p ) {
+				order++;
+			}
+			EXPECT_EQ( a == g, order == p - 1 ) << p << " " << a;
+		}
+	}
+}
+
+TEST( TestCaseName, discrete_log64 ) {
+	// Every g, h modulo small primes against the first power that matches.
+	for ( const uint64_t p : { 2ULL, 3ULL, 13ULL, 17ULL, 97ULL } ) {
+		for ( uint64_t g = 1; g < p; g++ ) {
+			const DiscreteLog64 dlog( g, p );
+			for ( uint64_t h = 1; h < p; h++ ) {
+				uint64_t x = 0, y = 1;
+				while ( y != h && x < p ) {
+					y = y * g % p;
+					x++;
+				}
+				if ( x < p ) {
+					EXPECT_EQ( x, dlog.log( h ) ) << p << " " << g << " " << h;
+					EXPECT_EQ( x, discrete_log64( g, h, p ) );
+				} else {
+					EXPECT_THROW( dlog.log( h ), std::overflow_error ) << p << " " << g << " " << h;
+				}
+			}
+		}
+	}
+
+	// p - 1 smooth, and with a large prime factor.
+	const std::vector<std::pair<uint64_t, uint64_t>> groups{
+	    { 998244353, 3 },
+	    { 1000000007, 5 },
+	    { 0xFFFF'FFFF'0000'0001ULL, 7 },
+	};
+	uint64_t seed = 12345;
+	for ( auto &&[ p, g ] : groups ) {
+		const DiscreteLog64 dlog( g, p );
+		EXPECT_EQ( p - 1, dlog.order() );
+		const DiscreteLog64 scaled( g, p, 8 );
+		for ( int i = 0; i < 20; i++ ) {
+			seed = seed * 0x9E37'79B9'7F4A'7C15ULL + 1;
+			const uint64_t x = seed % ( p - 1 );
+			EXPECT_EQ( x, dlog.log( powmod64( g, x, p ) ) ) << p;
+			EXPECT_EQ( x, scaled.log( powmod64( g, x, p ) ) ) << p;
+		}
+		// g^2 generates the squares : the primitive root is not one of them.
+		const DiscreteLog64 squares( powmod64( g, 2, p ), p );
+		EXPECT_EQ( ( p - 1 ) / 2, squares.order() );
+		EXPECT_EQ( 1000, squares.log( powmod64( g, 2000, p ) ) );
+		EXPECT_THROW( squares.log( g ), std::overflow_error );
+	}
+	EXPECT_EQ( 123456, discrete_log64( 5, powmod64( 5, 123456, 1000000007 ), 1000000007 ) );
+
+	// 2^64 - 59 : p - 1 = 2^2 * 11 * 137 * 547 * 5594472617641, Pollard's rho for the 43-bit factor.
+	const uint64_t p = 18446744073709551557U;
+	const DiscreteLog64 dlog( 2, p );
+	EXPECT_EQ( 0x0123'4567'89AB'CDEFULL, dlog.log( powmod64( 2, 0x0123'4567'89AB'CDEFULL, p ) ) );
+	EXPECT_EQ( p - 2, dlog.log( powmod64( 2, p - 2, p ) ) );
+
+	// Safe primes p = 2q + 1 : q > 2^40 takes Pollard's rho, no baby-step table.
+	const uint64_t safe = 35184372098147ULL;
+	const DiscreteLog64 rho( primitive_root64( safe ), safe );
+	for ( const uint64_t x : std::vector<uint64_t>{ 1, 17592186049073ULL, 0x1234'5678'9ABCULL, safe - 2 } ) {
+		EXPECT_EQ( x, rho.log( powmod64( rho.base(), x, safe ) ) ) << x;
+	}
+	// q ~ 2^62 : a table of scale * sqrt( q ) baby steps would take 64 GiB.
+	const uint64_t safe63 = 9223372036854778487ULL;
+	const DiscreteLog64 big( primitive_root64( safe63 ), safe63 );
+	EXPECT_EQ( safe63 - 1, big.order() );
+	EXPECT_EQ( 0, big.log( 1 ) );
+	EXPECT_EQ( ( safe63 - 1 ) / 2, big.log( safe63 - 1 ) );
+
+	EXPECT_THROW( DiscreteLog64( 3, 15 ), std::invalid_argument );
+	EXPECT_THROW( DiscreteLog64( 13, 13 ), std::invalid_argument );
+	EXPECT_THROW( DiscreteLog64( 2, 13, 0 ), std::invalid_argument );
+	EXPECT_THROW( DiscreteLog64( 2, 13 ).log( 26 ), std::invalid_argument );
+}
+
 TEST( TestCaseName, isqrt ) {
 	EXPECT_EQ( 0xFFFFFFFF, isqrt( 0xFFFFFFFFFFFFFFFF ) );
 	EXPECT_EQ( 0, isqrt( 0 ) );
@@ -281,3 +939,716 @@ TEST( TestCaseName, is_square ) {
 	EXPECT_FALSE( is_square( 0xFFFFFFFFFFFFFFFEULL ) );
 	EXPECT_FALSE( is_square( 0xFFFFFFFFFFFFFFFFULL ) );
 }
+
+TEST( TestCaseName, isqrt_double_seed ) {
+	// Around squares where sqrt( double ) rounds across the root.
+	for ( uint64_t r = 0xFFFF'FFFF; r > 0xFFFF'FFFF - 100000; r-- ) {
+		EXPECT_EQ( r, isqrt( r * r ) );
+		EXPECT_EQ( r - 1, isqrt( r * r - 1 ) );
+		EXPECT_EQ( r, isqrt( r * r + 2 * r ) );
+	}
+	for ( uint64_t r = 0x400'0000; r < 0x400'0000 + 100000; r++ ) {
+		EXPECT_EQ( r, isqrt( r * r ) );
+		EXPECT_EQ( r - 1, isqrt( r * r - 1 ) );
+	}
+	EXPECT_EQ( 0xFFFF'FFFFULL, isqrt( 0xFFFF'FFFF'FFFF'FFFF ) );
+	EXPECT_EQ( 0xFFFF'FFFEULL, isqrt( 0xFFFF'FFFE'0000'0001 - 1 ) );
+}
+
+TEST( TestCaseName, is_square_batch ) {
+	const size_t n = 4000;
+	std::vector<uint64_t> x( n );
+	bool out[ n ];
+	uint64_t y = 1;
+	for ( size_t i = 0; i < n; i++ ) {
+		y = y * 0x9E37'79B9'7F4A'7C15ULL + 1;
+		const uint64_t r = y >> 32;
+		// Squares, neighbours of squares and random numbers.
+		x[ i ] = ( i % 4 == 0 ) ? r * r : ( i % 4 == 1 ) ? r * r + 1 : ( i % 4 == 2 ) ? r * r - 1 : y;
+	}
+	is_square_batch( x.data(), out, n );
+	for ( size_t i = 0; i < n; i++ ) {
+		const uint64_t r = isqrt( x[ i ] );
+		EXPECT_EQ( r * r == x[ i ], out[ i ] ) << x[ i ];
+		EXPECT_EQ( r * r == x[ i ], is_square( x[ i ] ) ) << x[ i ];
+	}
+	// Every residue class of the filters
+	for ( uint64_t v = 0; v < 63 * 65 * 11 * 4; v++ ) {
+		const uint64_t r = isqrt( v );
+		EXPECT_EQ( r * r == v, is_square( v ) ) << v;
+	}
+}
+
+TEST( TestCaseName, Montgomery64 ) {
+	std::vector<uint64_t> moduli{ 1,
+	                              3,
+	                              11,
+	                              65497,
+	                              0xFFFF'FFFF'FFFF'FFC5,
+	                              0xFFFF'FFFF'FFFF'FEFF,
+	                              0xFFFF'FFFF'FFFF'FFFF,
+	                              18446744073709551253ULL };
+
+	for ( auto &&mod : moduli ) {
+		const Montgomery64 mg( mod );
+		EXPECT_EQ( mod, mg.modulus() );
+		EXPECT_EQ( 1 % mod, mg.from_mont( mg.one() ) );
+
+		for ( uint64_t a = mod - 1, i = 0; i < 100; a = a * 0x9E37'79B9'7F4A'7C15ULL + 1, i++ ) {
+			const uint64_t b = a ^ 0x5555'5555'5555'5555ULL;
+			const uint64_t ma = mg.to_mont( a );
+			const uint64_t mb = mg.to_mont( b );
+
+			EXPECT_EQ( a % mod, mg.from_mont( ma ) );
+			EXPECT_EQ( umulmod64( a, b, mod ), mg.from_mont( mg.mul( ma, mb ) ) );
+			EXPECT_EQ( uaddmod64( a, b, mod ), mg.from_mont( mg.add( ma, mb ) ) );
+			EXPECT_EQ( usubmod64( a, b, mod ), mg.from_mont( mg.sub( ma, mb ) ) );
+
+			uint64_t expected = 1 % mod;
+			for ( uint64_t e = 0; e < 20; e++ ) {
+				EXPECT_EQ( expected, mg.from_mont( mg.pow( ma, e ) ) );
+				expected = umulmod64( expected, a, mod );
+			}
+		}
+	}
+
+	const Montgomery64 mg( 18446744073709551557ULL );
+	for ( uint64_t i = 2; i < 1000; i++ ) {
+		const uint64_t x = mg.to_mont( i );
+		EXPECT_EQ( mg.one(), mg.mul( x, mg.inverse( x ) ) );
+	}
+	EXPECT_THROW( Montgomery64( 10 ), std::invalid_argument );
+}
+
+TEST( TestCaseName, ModArith ) {
+	// n = p * q : every result modulo p and modulo q must match the 64-bit functions.
+	const uint64_t p = 0xFFFF'FFFF'FFFF'FFC5ULL, q = 1000000007ULL;
+	uint_n<2> n;
+	n.limb[ 0 ] = umul128( p, q, &n.limb[ 1 ] );
+	const ModArith<2> ma( n );
+	std::mt19937_64 rng( 24 );
+	for ( int i = 0; i < 1000; i++ ) {
+		const uint_n<2> a = ma.reduce( uint_n<2>{ { rng(), rng() } } );
+		const uint_n<2> b = ma.reduce( uint_n<2>{ { rng(), rng() } } );
+		const uint64_t e = rng() >> ( i % 64 );
+		for ( const uint64_t m : { p, q } ) {
+			const uint64_t am = limbs::umod64( a, m ), bm = limbs::umod64( b, m );
+			EXPECT_EQ( uaddmod64( am, bm, m ), limbs::umod64( ma.add( a, b ), m ) );
+			EXPECT_EQ( usubmod64( am, bm, m ), limbs::umod64( ma.sub( a, b ), m ) );
+			EXPECT_EQ( umulmod64( am, bm, m ), limbs::umod64( ma.mul( a, b ), m ) );
+			EXPECT_EQ( powmod64( am, e, m ), limbs::umod64( ma.pow( a, uint_n<2>::from( e ) ), m ) );
+		}
+		if ( limbs::umod64( a, p ) != 0 && limbs::umod64( a, q ) != 0 ) {
+			EXPECT_EQ( uint_n<2>::from( 1 ), ma.mul( a, ma.inv( a ) ) );
+		}
+	}
+	EXPECT_THROW( ma.inv( uint_n<2>::from( q ) ), std::overflow_error );
+	EXPECT_THROW( ModArith<2>( uint_n<2>{ { 0, 1 } } ), std::invalid_argument );
+
+	// Fermat : a^( m - 1 ) = 1 modulo the primes 2^127 - 1 and 2^255 - 19.
+	const uint_n<2> m127{ { ~0ULL, 0x7FFF'FFFF'FFFF'FFFFULL } };
+	const ModArith<2> ma127( m127 );
+	const uint_n<2> e127{ { ~0ULL - 1, 0x7FFF'FFFF'FFFF'FFFFULL } };
+	const uint_n<4> m255{ { ~0ULL - 18, ~0ULL, ~0ULL, 0x7FFF'FFFF'FFFF'FFFFULL } };
+	const ModArith<4> ma255( m255 );
+	const uint_n<4> e255{ { ~0ULL - 19, ~0ULL, ~0ULL, 0x7FFF'FFFF'FFFF'FFFFULL } };
+	for ( int i = 0; i < 20; i++ ) {
+		const uint_n<2> a = ma127.reduce( uint_n<2>{ { rng(), rng() } } );
+		EXPECT_EQ( uint_n<2>::from( 1 ), ma127.pow( a, e127 ) );
+		EXPECT_EQ( uint_n<2>::from( 1 ), ma127.mul( a, ma127.inv( a ) ) );
+		const uint_n<4> b = ma255.reduce( uint_n<4>{ { rng(), rng(), rng(), rng() } } );
+		EXPECT_EQ( uint_n<4>::from( 1 ), ma255.pow( b, e255 ) );
+		EXPECT_EQ( uint_n<4>::from( 1 ), ma255.mul( b, ma255.inv( b ) ) );
+	}
+
+	EXPECT_TRUE( is_prime( m127 ) );
+	EXPECT_TRUE( is_prime( m255 ) );
+	EXPECT_TRUE( is_prime( uint_n<2>{ { ~0ULL - 158, ~0ULL } } ) );  // 2^128 - 159
+	EXPECT_TRUE( is_prime( uint_n<2>{ { 0x1FFF'FFFF'FFFF'FFFFULL, 0 } } ) );  // 2^61 - 1
+	EXPECT_FALSE( is_prime( uint_n<2>{ { 0x1FF'FFFF'FFFF'FFFFULL, 0 } } ) );  // 2^57 - 1
+	EXPECT_FALSE( is_prime( n ) );
+	EXPECT_FALSE( is_prime( uint_n<2>{ { ~0ULL, ~0ULL } } ) );
+	EXPECT_FALSE( is_prime( uint_n<2>{ { 1, 0x8000'0000'0000'0000ULL } } ) );  // 2^127 + 1
+	// ( 2^127 - 1 ) * ( 2^128 - 159 )
+	const uint_n<4> c255{ { 0x9F, 0x8000'0000'0000'0000ULL, 0xFFFF'FFFF'FFFF'FFAFULL, 0x7FFF'FFFF'FFFF'FFFFULL } };
+	EXPECT_FALSE( is_prime( c255 ) );
+
+	// N = 1 : the uint64_t functions, any modulus.
+	const ModArith<1> m10( 10 );
+	EXPECT_EQ( 6, m10.mul( 7, 8 ) );
+	EXPECT_EQ( 1, m10.add( 13, 8 ) );
+	EXPECT_EQ( 5, m10.sub( 2, 7 ) );
+	EXPECT_EQ( 4, m10.pow( 2, 10 ) );
+	EXPECT_EQ( 7, m10.inv( 3 ) );
+	const MontgomeryN<1> mg1( uint_n<1>::from( p ) );
+	for ( int i = 0; i < 100; i++ ) {
+		const uint64_t a = rng() % p, b = rng() % p;
+		EXPECT_EQ( umulmod64( a, b, p ),
+		           mg1.from_mont( mg1.mul( mg1.to_mont( uint_n<1>::from( a ) ), mg1.to_mont( uint_n<1>::from( b ) ) ) )
+		               .limb[ 0 ] );
+	}
+}
+
+TEST( TestCaseName, batch ) {
+	std::vector<uint64_t> moduli{ 1,
+	                              2,
+	                              3,
+	                              11,
+	                              0x8000,
+	                              65497,
+	                              0x7FFF'FFFF,
+	                              0xFFFF'FFFB,
+	                              0xF'FFFF'FFFF'FFFB,
+	                              0x1FFF'FFFF'FFFF'FFFF,
+	                              0xFFFF'FFFF'FFFF'FFC5,
+	                              0xFFFF'FFFF'FFFF'FEFF,
+	                              0xFFFF'FFFF'FFFF'FFFE };
+
+	const size_t n = 37;
+	std::vector<uint64_t> a( n ), b( n ), e( n ), out( n );
+
+	const batch_isa supported = detect_batch_isa();
+	for ( int isa = 0; isa <= static_cast<int>( supported ); isa++ ) {
+		set_batch_isa( static_cast<batch_isa>( isa ) );
+		EXPECT_EQ( static_cast<batch_isa>( isa ), get_batch_isa() );
+
+		for ( auto &&mod : moduli ) {
+			uint64_t x = mod;
+			for ( size_t i = 0; i < n; i++ ) {
+				x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+				// Most operands are reduced, a few are not.
+				a[ i ] = ( i % 8 == 5 ) ? x : x % mod;
+				b[ i ] = ( i % 16 == 9 ) ? ~x : ( x >> 7 ) % mod;
+				e[ i ] = ( i % 4 == 0 ) ? x : x >> ( i % 64 );
+			}
+			a[ 0 ] = 0;
+			b[ 1 ] = mod - 1;
+
+			uaddmod64_batch( a.data(), b.data(), out.data(), n, mod );
+			for ( size_t i = 0; i < n; i++ ) {
+				EXPECT_EQ( uaddmod64( a[ i ], b[ i ], mod ), out[ i ] ) << mod << " " << i;
+			}
+			usubmod64_batch( a.data(), b.data(), out.data(), n, mod );
+			for ( size_t i = 0; i < n; i++ ) {
+				EXPECT_EQ( usubmod64( a[ i ], b[ i ], mod ), out[ i ] ) << mod << " " << i;
+			}
+			umulmod64_batch( a.data(), b.data(), out.data(), n, mod );
+			for ( size_t i = 0; i < n; i++ ) {
+				EXPECT_EQ( umulmod64( a[ i ], b[ i ], mod ), out[ i ] ) << mod << " " << i;
+			}
+			powmod64_batch( a.data(), e.data(), out.data(), n, mod );
+			for ( size_t i = 0; i < n; i++ ) {
+				EXPECT_EQ( powmod64( a[ i ], e[ i ], mod ), out[ i ] ) << mod << " " << i;
+			}
+		}
+	}
+	set_batch_isa( supported );
+
+	EXPECT_THROW( umulmod64_batch( a.data(), b.data(), out.data(), n, 0 ), std::overflow_error );
+}
+
+TEST( TestCaseName, umodinv64_batch ) {
+	std::vector<uint64_t> moduli{ 1, 2, 3, 12, 65497, 0xFFFF'FFFB, 3ULL * 5 * 7 * 11 * 13 * 1000003, 0xFFFF'FFFF'FFFF'FFC5,
+	                              0xFFFF'FFFF'FFFF'FFFE };
+	const size_t n = 53;
+	std::vector<uint64_t> in( n ), out( n );
+	for ( auto &&mod : moduli ) {
+		uint64_t x = mod;
+		for ( size_t i = 0; i < n; i++ ) {
+			x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+			in[ i ] = ( i % 8 == 5 ) ? x : x % mod;
+		}
+		in[ 0 ] = 0;
+		in[ 1 ] = mod;
+		in[ 2 ] = 1;
+
+		std::vector<size_t> expected;
+		for ( size_t i = 0; i < n; i++ ) {
+			if ( ugcd64( in[ i ] % mod, mod ) != 1 ) {
+				expected.push_back( i );
+			}
+		}
+		EXPECT_EQ( expected, umodinv64_batch( in.data(), out.data(), n, mod ) ) << mod;
+		for ( size_t i = 0, k = 0; i < n; i++ ) {
+			if ( k < expected.size() && expected[ k ] == i ) {
+				EXPECT_EQ( 0, out[ i ] ) << mod << " " << i;
+				k++;
+			} else {
+				EXPECT_EQ( umodinv64( in[ i ], mod ), out[ i ] ) << mod << " " << i;
+			}
+		}
+	}
+	EXPECT_EQ( std::vector<size_t>(), umodinv64_batch( in.data(), out.data(), 0, 7 ) );
+	EXPECT_THROW( umodinv64_batch( in.data(), out.data(), n, 0 ), std::overflow_error );
+}
+
+template <uint64_t Mod>
+static void check_modint( const modint_reduction reduction ) {
+	using Z = ModInt<Mod>;
+	EXPECT_EQ( reduction, Z::reduction ) << Mod;
+	uint64_t x = Mod;
+	for ( int i = 0; i < 2000; i++ ) {
+		x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+		const uint64_t a = ( i % 16 == 0 ) ? Mod - 1 : x;
+		const uint64_t b = ( i % 16 == 1 ) ? 0 : ~x;
+		const uint64_t e = x >> ( i % 64 );
+		const Z za( a ), zb( b );
+		EXPECT_EQ( a % Mod, za.val() ) << Mod << " " << a;
+		EXPECT_EQ( uaddmod64( a % Mod, b % Mod, Mod ), ( za + zb ).val() ) << Mod << " " << a << " " << b;
+		EXPECT_EQ( usubmod64( a % Mod, b % Mod, Mod ), ( za - zb ).val() ) << Mod << " " << a << " " << b;
+		EXPECT_EQ( umulmod64( a % Mod, b % Mod, Mod ), ( za * zb ).val() ) << Mod << " " << a << " " << b;
+		EXPECT_EQ( ( Z( 0 ) - za ).val(), ( -za ).val() ) << Mod << " " << a;
+		EXPECT_EQ( powmod64( a, e, Mod ), za.pow( e ).val() ) << Mod << " " << a << " " << e;
+		if ( ugcd64( a % Mod, Mod ) == 1 ) {
+			EXPECT_EQ( umodinv64( a, Mod ), za.inv().val() ) << Mod << " " << a;
+		} else {
+			EXPECT_THROW( za.inv(), std::overflow_error ) << Mod << " " << a;
+		}
+	}
+}
+
+TEST( TestCaseName, ModInt ) {
+	// Evaluated at compile time.
+	static_assert( ( ModInt<1000000007>( 123456789 ) * ModInt<1000000007>( 987654321 ) ).val() == 259106859 );
+	static_assert( ModInt<( 1ULL << 61 ) - 1>( 3 ).pow( ( 1ULL << 61 ) - 2 ) == ModInt<( 1ULL << 61 ) - 1>( 1 ) );
+	static_assert( ModInt<18446744073709551557ULL>( 2 ).pow( 64 ).val() == 59 );
+	static_assert( ( ModInt<998244353ULL * 1000003>( 5 ).inv() * 5 ).val() == 1 );
+	static_assert( ModInt<3ULL << 40>( 1ULL << 41 ).pow( 2 ).val() == ( 1ULL << 40 ) );
+
+	check_modint<2>( modint_reduction::native );
+	check_modint<998244353>( modint_reduction::native );
+	check_modint<0xFFFF'FFFF>( modint_reduction::native );
+	check_modint<( 1ULL << 33 ) - 1>( modint_reduction::mersenne );
+	check_modint<( 1ULL << 61 ) - 1>( modint_reduction::mersenne );
+	check_modint<18446744073709551557ULL>( modint_reduction::pseudo_mersenne );
+	check_modint<0xFFFF'FFFF'0000'0001ULL>( modint_reduction::pseudo_mersenne );
+	check_modint<0xFFFF'FFFF'FFFF'FFFFULL>( modint_reduction::pseudo_mersenne );
+	check_modint<998244353ULL * 1000003>( modint_reduction::montgomery );
+	check_modint<0x7FFF'FFFF'FFFF'FFE7ULL>( modint_reduction::montgomery );
+	check_modint<1ULL << 32>( modint_reduction::barrett );
+	check_modint<3ULL << 40>( modint_reduction::barrett );
+	check_modint<0xFFFF'FFFE'FFFF'FFFEULL>( modint_reduction::barrett );
+}
+
+TEST( TestCaseName, primes_in_range ) {
+	EXPECT_EQ( std::vector<uint64_t>( {} ), primes_in_range( 0, 1 ) );
+	EXPECT_EQ( std::vector<uint64_t>( { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31 } ), primes_in_range( 0, 31 ) );
+	EXPECT_EQ( std::vector<uint64_t>( { 7, 11, 13 } ), primes_in_range( 7, 13 ) );
+	EXPECT_EQ( std::vector<uint64_t>( {} ), primes_in_range( 24, 28 ) );
+	EXPECT_EQ( std::vector<uint64_t>( {} ), primes_in_range( 10, 9 ) );
+
+	// Compare with is_prime().
+	const std::vector<std::pair<uint64_t, uint64_t>> ranges{
+	    { 0, 2000000 },
+	    { 1000000000000ULL, 1000000100000ULL },
+	    { 0xFFFF'FFFF'0000'0000ULL, 0xFFFF'FFFF'0001'0000ULL },
+	    { 0xFFFF'FFFF'FFFF'0000ULL, 0xFFFF'FFFF'FFFF'FFFFULL },
+	};
+	for ( auto &&[ lo, hi ] : ranges ) {
+		const std::vector<uint64_t> primes = primes_in_range( lo, hi );
+		std::vector<uint64_t> expected;
+		for ( uint64_t i = lo;; i++ ) {
+			if ( is_prime( i ) ) {
+				expected.push_back( i );
+			}
+			if ( i == hi ) {
+				break;
+			}
+		}
+		EXPECT_EQ( expected, primes );
+		EXPECT_EQ( expected.size(), count_primes( lo, hi ) );
+	}
+}
+
+TEST( TestCaseName, count_primes ) {
+	EXPECT_EQ( 0, count_primes( 0, 1 ) );
+	EXPECT_EQ( 1, count_primes( 0, 2 ) );
+	EXPECT_EQ( 4, count_primes( 0, 10 ) );
+	EXPECT_EQ( 25, count_primes( 0, 100 ) );
+	EXPECT_EQ( 168, count_primes( 1, 1000 ) );
+	EXPECT_EQ( 78498, count_primes( 0, 1000000 ) );
+	EXPECT_EQ( 5761455, count_primes( 0, 100000000 ) );
+	EXPECT_EQ( 5761455 - 78498, count_primes( 1000001, 100000000 ) );
+}
+
+TEST( TestCaseName, next_prime ) {
+	EXPECT_EQ( 2, next_prime( 0 ) );
+	EXPECT_EQ( 2, next_prime( 1 ) );
+	EXPECT_EQ( 3, next_prime( 2 ) );
+	EXPECT_EQ( 5, next_prime( 3 ) );
+	EXPECT_EQ( 1031, next_prime( 1021 ) );
+	EXPECT_EQ( 18446744073709551557U, next_prime( 18446744073709551533U ) );
+	EXPECT_THROW( next_prime( 18446744073709551557U ), std::overflow_error );
+	EXPECT_THROW( next_prime( 0xFFFF'FFFF'FFFF'FFFFULL ), std::overflow_error );
+
+	EXPECT_EQ( 2, prev_prime( 3 ) );
+	EXPECT_EQ( 3, prev_prime( 4 ) );
+	EXPECT_EQ( 3, prev_prime( 5 ) );
+	EXPECT_EQ( 1021, prev_prime( 1031 ) );
+	EXPECT_EQ( 18446744073709551557U, prev_prime( 0xFFFF'FFFF'FFFF'FFFFULL ) );
+	EXPECT_EQ( 18446744073709551533U, prev_prime( 18446744073709551557U ) );
+	EXPECT_THROW( prev_prime( 2 ), std::invalid_argument );
+
+	// Walk the primes of ranges both ways and compare with primes_in_range().
+	const std::vector<std::pair<uint64_t, uint64_t>> ranges{
+	    { 0, 1200000 },
+	    { 1000000000000ULL, 1000000100000ULL },
+	    { 0xFFFF'FFFF'FFFF'0000ULL, 18446744073709551557U },
+	};
+	for ( auto &&[ lo, hi ] : ranges ) {
+		const std::vector<uint64_t> expected = primes_in_range( lo, hi );
+		std::vector<uint64_t> up;
+		for ( uint64_t p = next_prime( lo - ( lo > 0 ) ); p <= hi; p = ( p == hi ) ? hi + 1 : next_prime( p ) ) {
+			up.push_back( p );
+		}
+		EXPECT_EQ( expected, up );
+		std::vector<uint64_t> down;
+		for ( uint64_t p = expected.back(); p >= expected.front(); p = prev_prime( p ) ) {
+			down.push_back( p );
+			if ( p == 2 ) {
+				break;
+			}
+		}
+		std::reverse( down.begin(), down.end() );
+		EXPECT_EQ( expected, down );
+
+		EXPECT_EQ( expected, next_primes( lo - ( lo > 0 ), expected.size() ) );
+	}
+	EXPECT_EQ( std::vector<uint64_t>( {} ), next_primes( 10, 0 ) );
+	EXPECT_EQ( std::vector<uint64_t>( { 2, 3, 5, 7, 11 } ), next_primes( 0, 5 ) );
+	EXPECT_THROW( next_primes( 18446744073709551533U, 2 ), std::overflow_error );
+}
+
+TEST( TestCaseName, random_prime ) {
+	std::mt19937_64 rng( 20260101 );
+	for ( int bits = 2; bits <= 64; bits++ ) {
+		for ( int i = 0; i < 20; i++ ) {
+			const uint64_t p = random_prime( bits, rng );
+			EXPECT_TRUE( is_prime( p ) ) << p;
+			EXPECT_EQ( 64 - bits, ulzcnt64( p ) ) << p;
+		}
+	}
+	EXPECT_THROW( random_prime( 1, rng ), std::invalid_argument );
+	EXPECT_THROW( random_prime( 65, rng ), std::invalid_argument );
+}
+
+TEST( TestCaseName, parse_operands ) {
+	const auto parse = []( const std::string &text, std::vector<uint64_t> *out ) {
+		const char *error = parse_operands( text.data(), text.data() + text.size(), out );
+		return ( error == nullptr ) ? -1 : static_cast<int>( error - text.data() );
+	};
+	std::vector<uint64_t> v;
+	EXPECT_EQ( -1, parse( "", &v ) );
+	EXPECT_EQ( -1, parse( " \r\n\t", &v ) );
+	EXPECT_TRUE( v.empty() );
+	EXPECT_EQ( -1, parse( "0 1\n23\r\n0x1F 0XfF\t18446744073709551615 0xFFFFFFFFFFFFFFFF", &v ) );
+	EXPECT_EQ( std::vector<uint64_t>( { 0, 1, 23, 31, 255, 0xFFFF'FFFF'FFFF'FFFFULL, 0xFFFF'FFFF'FFFF'FFFFULL } ), v );
+
+	// The position of the malformed number is returned, the numbers before it are kept.
+	v.clear();
+	EXPECT_EQ( 4, parse( "1 2 3x 4", &v ) );
+	EXPECT_EQ( std::vector<uint64_t>( { 1, 2 } ), v );
+	EXPECT_EQ( 0, parse( "18446744073709551616", &v ) );
+	EXPECT_EQ( 0, parse( "0x10000000000000000", &v ) );
+	EXPECT_EQ( 1, parse( " -1", &v ) );
+	EXPECT_EQ( 0, parse( "0x", &v ) );
+	EXPECT_EQ( 0, parse( "0xG", &v ) );
+
+	uint64_t x = 0;
+	EXPECT_TRUE( parse_operand( "0xFFFFFFFFFFFFFFC5", &x ) );
+	EXPECT_EQ( 0xFFFF'FFFF'FFFF'FFC5ULL, x );
+	EXPECT_FALSE( parse_operand( "1 2", &x ) );
+	EXPECT_FALSE( parse_operand( "", &x ) );
+}
+
+TEST( TestCaseName, format_decimal ) {
+	char buffer[ max_decimal_digits ];
+	const auto format = [ & ]( const uint64_t x ) { return std::string( buffer, format_decimal( x, buffer ) ); };
+	EXPECT_EQ( "0", format( 0 ) );
+	EXPECT_EQ( "9", format( 9 ) );
+	EXPECT_EQ( "10", format( 10 ) );
+	EXPECT_EQ( "100", format( 100 ) );
+	EXPECT_EQ( "18446744073709551615", format( 0xFFFF'FFFF'FFFF'FFFFULL ) );
+	uint64_t x = 1;
+	for ( int i = 0; i < 1000; i++ ) {
+		x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+		const uint64_t y = x >> ( i % 64 );
+		EXPECT_EQ( std::to_string( y ), format( y ) );
+	}
+}
+
+// Largest x passed to slow_first_chunk().
+static std::atomic<uint64_t> slow_first_chunk_max( 0 );
+
+// is_prime(), slow for x < 100.
+static bool slow_first_chunk( const uint64_t x ) {
+	uint64_t seen = slow_first_chunk_max;
+	while ( seen < x && !slow_first_chunk_max.compare_exchange_weak( seen, x ) ) {
+	}
+	if ( x < 100 ) {
+		std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+	}
+	return is_prime( x );
+}
+
+TEST( TestCaseName, parallel_range_scan ) {
+	range_scan_options options;
+	options.threads = 4;
+	options.chunk = 1000;
+
+	EXPECT_EQ( count_primes( 0, 1000000 ), parallel_count( 0, 1000000, is_prime, options ) );
+	EXPECT_EQ( 1001, parallel_count( 0, 1000000, is_square, options ) );
+	EXPECT_EQ( 0, parallel_count( 10, 9, is_prime, options ) );
+
+	EXPECT_EQ( primes_in_range( 1000000000, 1000100000 ), parallel_collect( 1000000000, 1000100000, is_prime, options ) );
+	const uint64_t top = 0xFFFF'FFFF'FFFF'FFFFULL;
+	EXPECT_EQ( primes_in_range( top - 100000, top ), parallel_collect( top - 100000, top, is_prime, options ) );
+
+	options.ordered = false;
+	std::vector<uint64_t> unordered = parallel_collect( 0, 100000, is_prime, options );
+	std::sort( unordered.begin(), unordered.end() );
+	EXPECT_EQ( primes_in_range( 0, 100000 ), unordered );
+
+	// Ordered callback
+	options.ordered = true;
+	uint64_t previous = 0;
+	uint64_t calls = 0;
+	parallel_for_each(
+	    0, 100000, is_prime,
+	    [ & ]( const uint64_t x ) {
+		    EXPECT_LT( previous, x );
+		    previous = x;
+		    calls++;
+	    },
+	    options );
+	EXPECT_EQ( 9592, calls );
+
+	EXPECT_THROW( parallel_for_each(
+	                  0, 100000, is_prime, []( uint64_t ) { throw std::runtime_error( "callback" ); }, options ),
+	              std::runtime_error );
+
+	// The first chunk is slow : while chunk c is emitted, no chunk from c + window on has been scanned.
+	options.threads = 8;
+	options.chunk = 100;
+	for ( const uint64_t window : { 0ULL, 1ULL, 3ULL } ) {
+		options.window = window;
+		const uint64_t limit = ( window == 0 ) ? 32 : window;
+		slow_first_chunk_max = 0;
+		calls = 0;
+		bool bounded = true;
+		parallel_for_each(
+		    0, 1000000, slow_first_chunk,
+		    [ & ]( const uint64_t x ) {
+			    bounded = bounded && slow_first_chunk_max < ( x / options.chunk + limit ) * options.chunk;
+			    calls++;
+		    },
+		    options );
+		EXPECT_EQ( 78498, calls ) << window;
+		EXPECT_TRUE( bounded ) << window;
+	}
+}
+
+TEST( TestCaseName, factor64 ) {
+	EXPECT_EQ( factorization( {} ), factor64( 0 ) );
+	EXPECT_EQ( factorization( {} ), factor64( 1 ) );
+	EXPECT_EQ( factorization( { { 2, 1 } } ), factor64( 2 ) );
+	EXPECT_EQ( factorization( { { 2, 2 }, { 3, 1 } } ), factor64( 12 ) );
+	EXPECT_EQ( factorization( { { 2, 63 } } ), factor64( 0x8000'0000'0000'0000ULL ) );
+	EXPECT_EQ( factorization( { { 3, 40 } } ), factor64( 12157665459056928801ULL ) );
+	EXPECT_EQ( factorization( { { 3, 1 }, { 5, 1 }, { 17, 1 }, { 257, 1 }, { 641, 1 }, { 65537, 1 }, { 6700417, 1 } } ),
+	           factor64( 0xFFFF'FFFF'FFFF'FFFFULL ) );
+	EXPECT_EQ( factorization( { { 18446744073709551557ULL, 1 } } ), factor64( 18446744073709551557ULL ) );
+	EXPECT_EQ( factorization( { { 4294967291ULL, 2 } } ), factor64( 4294967291ULL * 4294967291ULL ) );
+	EXPECT_EQ( factorization( { { 4294967279ULL, 1 }, { 4294967291ULL, 1 } } ), factor64( 4294967291ULL * 4294967279ULL ) );
+	EXPECT_EQ( factorization( { { 4294966769ULL, 1 }, { 4294966813ULL, 1 } } ), factor64( 4294966813ULL * 4294966769ULL ) );
+	EXPECT_EQ( factorization( { { 3, 1 }, { 1000003, 3 } } ), factor64( 3ULL * 1000003 * 1000003 * 1000003 ) );
+	EXPECT_EQ( factorization( { { 829, 1 }, { 1657, 1 } } ), factor64( 1373653 ) );
+
+	for ( uint64_t n = 2; n < 20000; n++ ) {
+		uint64_t product = 1;
+		for ( auto &&[ p, e ] : factor64( n ) ) {
+			EXPECT_TRUE( is_prime( p ) );
+			for ( uint32_t i = 0; i < e; i++ ) {
+				product *= p;
+			}
+		}
+		EXPECT_EQ( n, product );
+	}
+}
+
+TEST( TestCaseName, pollard_brent64_squfof64 ) {
+	const std::vector<std::pair<uint64_t, uint64_t>> semiprimes{
+	    { 65449ULL, 65497ULL }, { 65101ULL, 65111ULL }, { 1000003ULL, 1000033ULL }, { 2147483647ULL, 2147483629ULL } };
+	for ( auto &&[ p, q ] : semiprimes ) {
+		const uint64_t g = pollard_brent64( p * q, 1 );
+		EXPECT_TRUE( g == p || g == q ) << p * q;
+		const uint64_t h = squfof64( p * q );
+		EXPECT_TRUE( h == p || h == q ) << p * q;
+	}
+}
+
+static std::vector<uint64_t> poly_mul_naive( const std::vector<uint64_t> &a, const std::vector<uint64_t> &b,
+                                             const uint64_t p ) {
+	std::vector<uint64_t> c( a.size() + b.size() - 1, 0 );
+	for ( size_t i = 0; i < a.size(); i++ ) {
+		for ( size_t j = 0; j < b.size(); j++ ) {
+			c[ i + j ] = uaddmod64( c[ i + j ], umulmod64( a[ i ], b[ j ], p ), p );
+		}
+	}
+	return c;
+}
+
+TEST( TestCaseName, poly_mul_mod ) {
+	EXPECT_EQ( 1ULL << 23, ntt_max_length( 998244353 ) );
+	EXPECT_EQ( 1ULL << 32, ntt_max_length( 0xFFFF'FFFF'0000'0001ULL ) );
+	EXPECT_EQ( 0ULL, ntt_max_length( 2 ) );
+	EXPECT_EQ( 0ULL, ntt_max_length( 998244353ULL * 3 ) );
+
+	// NTT primes ( Shoup, Montgomery ), primes with short transforms, composite and even moduli.
+	std::vector<uint64_t> moduli{ 1,           2,           0x8000, 65497, 998244353, 0x3FFF'C000'0000'0001,
+	                              0xFFFF'FFFF'0000'0001, 0xFFFF'FFFF'FFFF'FFC5, 0xFFFF'FFFF'FFFF'FFFF };
+	std::vector<std::pair<size_t, size_t>> sizes{ { 1, 1 }, { 1, 50 }, { 33, 33 }, { 40, 97 }, { 257, 300 } };
+	for ( auto &&mod : moduli ) {
+		for ( auto &&[ na, nb ] : sizes ) {
+			std::vector<uint64_t> a( na ), b( nb );
+			uint64_t x = mod + na;
+			for ( auto &&v : a ) {
+				x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+				v = x % mod;
+			}
+			for ( auto &&v : b ) {
+				x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+				v = x % mod;
+			}
+			// Unreduced coefficients
+			a[ 0 ] = ~0ULL;
+			b.back() = mod - 1;
+			EXPECT_EQ( poly_mul_naive( a, b, mod ), poly_mul_mod( a, b, mod ) ) << mod << " " << na << " " << nb;
+			EXPECT_EQ( poly_mul_naive( a, a, mod ), poly_mul_mod( a, a, mod ) ) << mod << " " << na;
+		}
+	}
+
+	// More primes than the per-thread table cache holds, twice : evicted tables are rebuilt, and grown.
+	for ( const size_t n : { 100, 600 } ) {
+		for ( auto &&mod : { 998244353ULL, 469762049ULL, 167772161ULL, 754974721ULL, 7340033ULL, 0x3FFF'BE00'0000'0001ULL } ) {
+			std::vector<uint64_t> a( n ), b( n + 7 );
+			uint64_t x = mod + n;
+			for ( auto &&v : a ) {
+				x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+				v = x % mod;
+			}
+			for ( auto &&v : b ) {
+				x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+				v = x % mod;
+			}
+			EXPECT_EQ( poly_mul_naive( a, b, mod ), poly_mul_mod( a, b, mod ) ) << mod << " " << n;
+		}
+	}
+
+	// Transforms longer than one cache block
+	for ( auto &&mod : { 998244353ULL, 0xFFFF'FFFF'0000'0001ULL, 0xFFFF'FFFF'FFFF'FFC5ULL } ) {
+		std::vector<uint64_t> a( 3000 ), b( 2500 );
+		uint64_t x = mod;
+		for ( auto &&v : a ) {
+			x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+			v = x % mod;
+		}
+		for ( auto &&v : b ) {
+			x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+			v = ( mod - 1 ) - ( x & 0xFF );
+		}
+		EXPECT_EQ( poly_mul_naive( a, b, mod ), poly_mul_mod( a, b, mod ) ) << mod;
+	}
+
+	EXPECT_TRUE( poly_mul_mod( {}, { 1, 2 }, 7 ).empty() );
+	EXPECT_THROW( poly_mul_mod( { 1 }, { 1 }, 0 ), std::overflow_error );
+}
+
+TEST( TestCaseName, RnsBasis ) {
+	// Small moduli : M = 15015
+	const RnsBasis small( { 3, 5, 7, 11, 13 } );
+	EXPECT_EQ( std::vector<uint64_t>{ 15015 }, small.product() );
+	RnsVector a = small.make_vector( 100 ), b = small.make_vector( 100 ), out;
+	for ( uint64_t i = 0; i < 100; i++ ) {
+		small.set( a, i, i * 151 + 7 );
+		small.set( b, i, std::vector<uint64_t>{ i * 1009 } );
+	}
+	small.add( a, b, out );
+	for ( uint64_t i = 0; i < 100; i++ ) {
+		const uint64_t x = ( i * 151 + 7 + i * 1009 ) % 15015;
+		EXPECT_EQ( x ? std::vector<uint64_t>{ x } : std::vector<uint64_t>{}, small.get( out, i ) ) << i;
+	}
+	small.sub( a, b, out );
+	for ( uint64_t i = 0; i < 100; i++ ) {
+		const uint64_t x = ( i * 151 + 7 + 15015 * 10 - i * 1009 ) % 15015;
+		EXPECT_EQ( x ? std::vector<uint64_t>{ x } : std::vector<uint64_t>{}, small.get( out, i ) ) << i;
+	}
+	small.mul( a, b, out );
+	for ( uint64_t i = 0; i < 100; i++ ) {
+		const uint64_t x = ( i * 151 + 7 ) * ( i * 1009 ) % 15015;
+		EXPECT_EQ( x ? std::vector<uint64_t>{ x } : std::vector<uint64_t>{}, small.get( out, i ) ) << i;
+	}
+
+	// Four 64-bit primes : M > 2^255, products of 128-bit numbers are exact.
+	std::vector<uint64_t> primes;
+	for ( uint64_t p = 0xFFFF'FFFF'FFFF'FFFF; primes.size() < 4; p -= 2 ) {
+		if ( is_prime( p ) ) {
+			primes.push_back( p );
+		}
+	}
+	const RnsBasis basis( primes );
+	EXPECT_EQ( 4u, basis.size() );
+	EXPECT_EQ( 4u, basis.product().size() );
+	const size_t n = 50;
+	RnsVector u = basis.make_vector( n ), v = basis.make_vector( n );
+	std::vector<std::vector<uint64_t>> us( n ), vs( n );
+	uint64_t x = 1;
+	for ( size_t i = 0; i < n; i++ ) {
+		x = x * 0x9E37'79B9'7F4A'7C15ULL + 1;
+		us[ i ] = { x, x ^ 0x5555'5555'5555'5555ULL };
+		vs[ i ] = { ~x, x >> ( i % 64 ) };
+		basis.set( u, i, us[ i ] );
+		basis.set( v, i, vs[ i ] );
+		EXPECT_EQ( us[ i ], basis.get( u, i ) );
+	}
+	basis.mul( u, v, out );
+	for ( size_t i = 0; i < n; i++ ) {
+		// Schoolbook 2 x 2 limbs
+		std::vector<uint64_t> expected( 4, 0 );
+		for ( size_t p = 0; p < 2; p++ ) {
+			uint64_t carry = 0;
+			for ( size_t q = 0; q < 2; q++ ) {
+				uint64_t hi = 0;
+				const uint64_t lo = umul128( us[ i ][ p ], vs[ i ][ q ], &hi );
+				uint64_t s = expected[ p + q ] + lo;
+				hi += ( s < lo ) ? 1 : 0;
+				expected[ p + q ] = s + carry;
+				hi += ( expected[ p + q ] < s ) ? 1 : 0;
+				carry = hi;
+			}
+			expected[ p + 2 ] = carry;
+		}
+		while ( !expected.empty() && expected.back() == 0 ) {
+			expected.pop_back();
+		}
+		EXPECT_EQ( expected, basis.get( out, i ) ) << i;
+	}
+	// ( u * v - u ) + u = u * v
+	RnsVector w;
+	basis.sub( out, u, w );
+	basis.add( w, u, w );
+	for ( size_t i = 0; i < n; i++ ) {
+		EXPECT_EQ( basis.get( out, i ), basis.get( w, i ) ) << i;
+	}
+	// M - 1
+	RnsVector m1 = basis.make_vector( 1 );
+	basis.set( m1, 0, 1 );
+	basis.sub( basis.make_vector( 1 ), m1, m1 );
+	std::vector<uint64_t> expected = basis.product();
+	expected[ 0 ]--;
+	EXPECT_EQ( expected, basis.get( m1, 0 ) );
+
+	EXPECT_THROW( RnsBasis( { 3, 9 } ), std::invalid_argument );
+	EXPECT_THROW( RnsBasis( { 4, 9 } ), std::invalid_argument );
+	EXPECT_THROW( basis.add( u, m1, w ), std::invalid_argument );
+}
@@ -0,0 +1,449 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "factor64.h"
+#include "mapped_file.h"
+#include "operand_text.h"
+#include "range_scanner.h"
+#include "uint64_mod_batch.h"
+#include "uint64_mod_operation.h"
+#include "uint64_mod_stats.h"
+
+// UInt64Tool : applies one operation to every operand of a file.
+// Files are memory-mapped. Binary operands are read in place and binary results are stored straight into the mapped
+// output file. Text is parsed and formatted in blocks on all threads. The work is split into blocks scheduled by
+// parallel_for_each(), and every block runs the batched kernels of uint64_mod_batch.h.
+
+static const char usage[] =
+    "usage : UInt64Tool <op> [options] <input> <output>\n"
+    "  op            add | sub | mul | pow | inv | is_prime | is_square | factor\n"
+    "  -m <mod>      modulus of add, sub, mul, pow, inv\n"
+    "  -b <value>    second operand of add, sub, mul, exponent of pow\n"
+    "  -B <file>     second operands, one per input operand, in the input format\n"
+    "  -i text|bin   input format ( default text )\n"
+    "  -o text|bin   output format ( default : the input format, factor writes text )\n"
+    "  -t <threads>  0 : all hardware threads ( default )\n"
+    "  -v            print timings, and the hot-path counters of a UINT64MOD_STATS build, to stderr\n"
+    "text : decimal or 0x hexadecimal numbers separated by white space, results one per line.\n"
+    "bin  : native 64-bit words. is_prime / is_square write 0 or 1, inv writes 0 for non-invertible operands.\n"
+    "output - : stdout.\n";
+
+enum class tool_op { add, sub, mul, pow, inv, is_prime, is_square, factor };
+enum class file_format { text, binary };
+
+struct tool_options {
+	tool_op op = tool_op::add;
+	uint64_t mod = 0;
+	bool has_b = false;
+	uint64_t b = 0;
+	std::string b_path;
+	file_format in_format = file_format::text;
+	file_format out_format = file_format::text;
+	bool out_format_set = false;
+	unsigned threads = 0;
+	bool verbose = false;
+	std::string in_path;
+	std::string out_path;
+};
+
+// Bytes of text per parsing block, operands per compute block.
+const size_t text_block = 1 << 20;
+const size_t op_block = 1 << 14;
+
+static bool is_binary_op( const tool_op op ) {
+	return op == tool_op::add || op == tool_op::sub || op == tool_op::mul || op == tool_op::pow;
+}
+
+static bool parse_format( const char *text, file_format *format ) {
+	if ( strcmp( text, "text" ) == 0 ) {
+		*format = file_format::text;
+	} else if ( strcmp( text, "bin" ) == 0 ) {
+		*format = file_format::binary;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+/**
+ * parse_arguments( int argc, char **argv, tool_options *opt )
+ * @return false on a usage error
+ */
+static bool parse_arguments( const int argc, char **argv, tool_options *opt ) {
+	if ( argc < 2 ) {
+		return false;
+	}
+	static const std::pair<const char *, tool_op> ops[] = {
+	    { "add", tool_op::add },
+	    { "sub", tool_op::sub },
+	    { "mul", tool_op::mul },
+	    { "pow", tool_op::pow },
+	    { "inv", tool_op::inv },
+	    { "is_prime", tool_op::is_prime },
+	    { "is_square", tool_op::is_square },
+	    { "factor", tool_op::factor },
+	};
+	bool found = false;
+	for ( auto &&[ name, op ] : ops ) {
+		if ( strcmp( argv[ 1 ], name ) == 0 ) {
+			opt->op = op;
+			found = true;
+		}
+	}
+	if ( !found ) {
+		return false;
+	}
+
+	bool has_mod = false;
+	std::vector<std::string> paths;
+	for ( int i = 2; i < argc; i++ ) {
+		const std::string arg = argv[ i ];
+		const bool has_value = ( i + 1 < argc );
+		if ( arg == "-m" && has_value ) {
+			has_mod = parse_operand( argv[ ++i ], &opt->mod );
+			if ( !has_mod ) {
+				return false;
+			}
+		} else if ( arg == "-b" && has_value ) {
+			opt->has_b = parse_operand( argv[ ++i ], &opt->b );
+			if ( !opt->has_b ) {
+				return false;
+			}
+		} else if ( arg == "-B" && has_value ) {
+			opt->b_path = argv[ ++i ];
+		} else if ( arg == "-i" && has_value ) {
+			if ( !parse_format( argv[ ++i ], &opt->in_format ) ) {
+				return false;
+			}
+		} else if ( arg == "-o" && has_value ) {
+			if ( !parse_format( argv[ ++i ], &opt->out_format ) ) {
+				return false;
+			}
+			opt->out_format_set = true;
+		} else if ( arg == "-t" && has_value ) {
+			uint64_t threads = 0;
+			if ( !parse_operand( argv[ ++i ], &threads ) || threads > 4096 ) {
+				return false;
+			}
+			opt->threads = static_cast<unsigned>( threads );
+		} else if ( arg == "-v" ) {
+			opt->verbose = true;
+		} else if ( arg.size() > 1 && arg[ 0 ] == '-' ) {
+			return false;
+		} else {
+			paths.push_back( arg );
+		}
+	}
+	if ( paths.size() != 2 ) {
+		return false;
+	}
+	opt->in_path = paths[ 0 ];
+	opt->out_path = paths[ 1 ];
+	if ( !opt->out_format_set ) {
+		opt->out_format = ( opt->op == tool_op::factor ) ? file_format::text : opt->in_format;
+	}
+
+	const bool needs_mod = is_binary_op( opt->op ) || opt->op == tool_op::inv;
+	const bool has_second = opt->has_b || !opt->b_path.empty();
+	return has_mod == needs_mod && has_second == is_binary_op( opt->op ) && !( opt->has_b && !opt->b_path.empty() ) &&
+	       !( opt->op == tool_op::factor && opt->out_format == file_format::binary );
+}
+
+/**
+ * for_each_block( size_t blocks, const range_scan_options &options, F f )
+ * Calls f( k ) for every k in [ 0, blocks ) on the worker threads of parallel_for_each().
+ */
+template <typename F>
+static void for_each_block( const size_t blocks, const range_scan_options &options, F f ) {
+	if ( blocks == 0 ) {
+		return;
+	}
+	parallel_for_each(
+	    0, blocks - 1, []( uint64_t ) { return true; }, [ & ]( const uint64_t k ) { f( static_cast<size_t>( k ) ); },
+	    options );
+}
+
+/**
+ * operand_array
+ * Operands of a file : the mapping itself for binary files, parsed numbers for text files.
+ */
+struct operand_array {
+	mapped_file file;
+	std::vector<uint64_t> parsed;
+	const uint64_t *data = nullptr;
+	size_t size = 0;
+};
+
+/**
+ * load_operands( const std::string &path, file_format format, const range_scan_options &options, operand_array *out )
+ * Text is cut into blocks at white space and every block is parsed by one thread.
+ */
+static void load_operands( const std::string &path, const file_format format, const range_scan_options &options,
+                           operand_array *out ) {
+	out->file = mapped_file::open_read( path );
+	const size_t bytes = out->file.size();
+	if ( format == file_format::binary ) {
+		if ( bytes % sizeof( uint64_t ) != 0 ) {
+			throw std::runtime_error( path + " : size is not a multiple of 8 bytes" );
+		}
+		// Mappings are page aligned.
+		out->data = reinterpret_cast<const uint64_t *>( out->file.data() );
+		out->size = bytes / sizeof( uint64_t );
+		return;
+	}
+
+	const char *text = reinterpret_cast<const char *>( out->file.data() );
+	// Block k starts at the first token boundary at or after k * text_block.
+	const auto boundary = [ & ]( const size_t k ) {
+		size_t pos = k * text_block;
+		if ( pos >= bytes ) {
+			return bytes;
+		}
+		while ( pos > 0 && pos < bytes && !is_operand_space( text[ pos - 1 ] ) ) {
+			pos++;
+		}
+		return pos;
+	};
+	const size_t blocks = ( bytes + text_block - 1 ) / text_block;
+	std::vector<std::vector<uint64_t>> parts( blocks );
+	std::vector<const char *> errors( blocks, nullptr );
+	for_each_block( blocks, options, [ & ]( const size_t k ) {
+		errors[ k ] = parse_operands( text + boundary( k ), text + boundary( k + 1 ), &parts[ k ] );
+	} );
+	for ( auto &&e : errors ) {
+		if ( e != nullptr ) {
+			throw std::runtime_error( path + " : malformed number at byte " + std::to_string( e - text ) );
+		}
+	}
+
+	size_t total = 0;
+	for ( auto &&part : parts ) {
+		total += part.size();
+	}
+	out->parsed.resize( total );
+	std::vector<size_t> offsets( blocks + 1, 0 );
+	for ( size_t k = 0; k < blocks; k++ ) {
+		offsets[ k + 1 ] = offsets[ k ] + parts[ k ].size();
+	}
+	for_each_block( blocks, options, [ & ]( const size_t k ) {
+		if ( !parts[ k ].empty() ) {
+			memcpy( out->parsed.data() + offsets[ k ], parts[ k ].data(), parts[ k ].size() * sizeof( uint64_t ) );
+		}
+	} );
+	out->data = out->parsed.data();
+	out->size = total;
+}
+
+/**
+ * apply_block( const tool_options &opt, const uint64_t *a, const uint64_t *b, uint64_t *out, size_t n )
+ * @param b second operands, nullptr for unary operations
+ * @return number of operands without an inverse ( inv )
+ */
+static size_t apply_block( const tool_options &opt, const uint64_t *a, const uint64_t *b, uint64_t *out,
+                           const size_t n ) {
+	switch ( opt.op ) {
+		case tool_op::add:
+			uaddmod64_batch( a, b, out, n, opt.mod );
+			break;
+		case tool_op::sub:
+			usubmod64_batch( a, b, out, n, opt.mod );
+			break;
+		case tool_op::mul:
+			umulmod64_batch( a, b, out, n, opt.mod );
+			break;
+		case tool_op::pow:
+			powmod64_batch( a, b, out, n, opt.mod );
+			break;
+		case tool_op::inv:
+			return umodinv64_batch( a, out, n, opt.mod ).size();
+		case tool_op::is_prime:
+			for ( size_t i = 0; i < n; i++ ) {
+				out[ i ] = is_prime( a[ i ] ) ? 1 : 0;
+			}
+			break;
+		case tool_op::is_square: {
+			std::unique_ptr<bool[]> flags( new bool[ n ] );
+			is_square_batch( a, flags.get(), n );
+			for ( size_t i = 0; i < n; i++ ) {
+				out[ i ] = flags[ i ] ? 1 : 0;
+			}
+			break;
+		}
+		case tool_op::factor:
+			break;
+	}
+	return 0;
+}
+
+// n and at most 64 prime factors, separators and newline.
+const size_t factor_line_size = 65 * ( max_decimal_digits + 1 ) + 1;
+
+/**
+ * format_factors( uint64_t n, char *p )
+ * "n: p p q\n", the format of coreutils factor.
+ * @param p room for factor_line_size characters
+ * @return end of the line
+ */
+static char *format_factors( const uint64_t n, char *p ) {
+	p = format_decimal( n, p );
+	*p++ = ':';
+	for ( auto &&[ prime, count ] : factor64( n ) ) {
+		for ( uint32_t i = 0; i < count; i++ ) {
+			*p++ = ' ';
+			p = format_decimal( prime, p );
+		}
+	}
+	*p++ = '\n';
+	return p;
+}
+
+static double elapsed_ms( const std::chrono::steady_clock::time_point &start ) {
+	return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+}
+
+static void write_stdout( const void *data, const size_t bytes ) {
+	if ( bytes != 0 && fwrite( data, 1, bytes, stdout ) != bytes ) {
+		throw std::runtime_error( "stdout : write failed" );
+	}
+}
+
+static int run( const tool_options &opt ) {
+	range_scan_options options;
+	options.threads = opt.threads;
+	options.chunk = 1;
+	options.ordered = false;
+
+	auto start = std::chrono::steady_clock::now();
+	operand_array a;
+	load_operands( opt.in_path, opt.in_format, options, &a );
+	operand_array second;
+	std::vector<uint64_t> constant;
+	if ( !opt.b_path.empty() ) {
+		load_operands( opt.b_path, opt.in_format, options, &second );
+		if ( second.size != a.size ) {
+			throw std::runtime_error( opt.b_path + " : " + std::to_string( second.size ) + " operands, " + opt.in_path +
+			                          " : " + std::to_string( a.size ) );
+		}
+	} else if ( opt.has_b ) {
+		constant.assign( op_block, opt.b );
+	}
+	const double load_ms = elapsed_ms( start );
+
+	start = std::chrono::steady_clock::now();
+	const size_t n = a.size;
+	const size_t blocks = ( n + op_block - 1 ) / op_block;
+	std::atomic<size_t> failed( 0 );
+	const bool to_stdout = ( opt.out_path == "-" );
+	mapped_file out_file;
+	std::vector<uint64_t> out_words;
+	std::vector<std::vector<char>> out_text;
+
+	if ( opt.out_format == file_format::binary ) {
+		// Results go straight into the mapped output file.
+		uint64_t *out = nullptr;
+		if ( to_stdout ) {
+			out_words.resize( n );
+			out = out_words.data();
+		} else {
+			out_file = mapped_file::create( opt.out_path, n * sizeof( uint64_t ) );
+			out = reinterpret_cast<uint64_t *>( out_file.data() );
+		}
+		for_each_block( blocks, options, [ & ]( const size_t k ) {
+			const size_t first = k * op_block;
+			const size_t count = ( n - first < op_block ) ? n - first : op_block;
+			const uint64_t *b = second.data ? second.data + first : constant.data();
+			failed += apply_block( opt, a.data + first, b, out + first, count );
+		} );
+	} else {
+		out_text.resize( blocks );
+		for_each_block( blocks, options, [ & ]( const size_t k ) {
+			const size_t first = k * op_block;
+			const size_t count = ( n - first < op_block ) ? n - first : op_block;
+			std::vector<char> &text = out_text[ k ];
+			if ( opt.op == tool_op::factor ) {
+				char line[ factor_line_size ];
+				text.reserve( count * 2 * ( max_decimal_digits + 1 ) );
+				for ( size_t i = 0; i < count; i++ ) {
+					text.insert( text.end(), line, format_factors( a.data[ first + i ], line ) );
+				}
+				return;
+			}
+			std::vector<uint64_t> results( count );
+			const uint64_t *b = second.data ? second.data + first : constant.data();
+			failed += apply_block( opt, a.data + first, b, results.data(), count );
+			text.resize( count * ( max_decimal_digits + 1 ) );
+			char *p = text.data();
+			for ( auto &&r : results ) {
+				p = format_decimal( r, p );
+				*p++ = '\n';
+			}
+			text.resize( static_cast<size_t>( p - text.data() ) );
+		} );
+	}
+	const double compute_ms = elapsed_ms( start );
+
+	start = std::chrono::steady_clock::now();
+	if ( opt.out_format == file_format::binary ) {
+		if ( to_stdout ) {
+			write_stdout( out_words.data(), n * sizeof( uint64_t ) );
+		}
+	} else {
+		std::vector<size_t> offsets( blocks + 1, 0 );
+		for ( size_t k = 0; k < blocks; k++ ) {
+			offsets[ k + 1 ] = offsets[ k ] + out_text[ k ].size();
+		}
+		if ( to_stdout ) {
+			for ( auto &&text : out_text ) {
+				write_stdout( text.data(), text.size() );
+			}
+		} else {
+			out_file = mapped_file::create( opt.out_path, offsets[ blocks ] );
+			char *out = reinterpret_cast<char *>( out_file.data() );
+			for_each_block( blocks, options, [ & ]( const size_t k ) {
+				if ( !out_text[ k ].empty() ) {
+					memcpy( out + offsets[ k ], out_text[ k ].data(), out_text[ k ].size() );
+				}
+			} );
+		}
+	}
+	out_file = mapped_file();
+	const double write_ms = elapsed_ms( start );
+
+	if ( failed != 0 ) {
+		fprintf( stderr, "%zu operands have no inverse mod %llu, written as 0\n", failed.load(),
+		         static_cast<unsigned long long>( opt.mod ) );
+	}
+	if ( opt.verbose ) {
+		fprintf( stderr, "%zu operands : load %.1f ms, compute %.1f ms, write %.1f ms\n", n, load_ms, compute_ms,
+		         write_ms );
+		if ( stats::enabled ) {
+			const stats::snapshot counts = stats::collect();
+			for ( int c = 0; c < stats::counter_count; c++ ) {
+				fprintf( stderr, "%s %llu\n", stats::name( static_cast<stats::counter>( c ) ),
+				         static_cast<unsigned long long>( counts.value[ c ] ) );
+			}
+		}
+	}
+	return 0;
+}
+
+int main( int argc, char **argv ) {
+	tool_options opt;
+	if ( !parse_arguments( argc, argv, &opt ) ) {
+		fputs( usage, stderr );
+		return 2;
+	}
+	try {
+		return run( opt );
+	} catch ( const std::exception &e ) {
+		fprintf( stderr, "error : %s\n", e.what() );
+		return 1;
+	}
+}
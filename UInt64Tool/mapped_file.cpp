@@ -0,0 +1,193 @@
+#include "mapped_file.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <stdexcept>
+#include <utility>
+
+#if defined( _WIN32 )
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static std::runtime_error file_error( const std::string &path, const char *what ) {
+#if defined( _WIN32 )
+	return std::runtime_error( path + " : " + what + " failed, error " + std::to_string( GetLastError() ) );
+#else
+	return std::runtime_error( path + " : " + what + " failed, " + strerror( errno ) );
+#endif
+}
+
+#if defined( _WIN32 )
+
+mapped_file mapped_file::open_read( const std::string &path ) {
+	mapped_file f;
+	f.file_ = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                       FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+	if ( f.file_ == INVALID_HANDLE_VALUE ) {
+		f.file_ = nullptr;
+		throw file_error( path, "open" );
+	}
+	LARGE_INTEGER size;
+	if ( !GetFileSizeEx( f.file_, &size ) ) {
+		throw file_error( path, "stat" );
+	}
+	f.size_ = static_cast<size_t>( size.QuadPart );
+	// An empty file cannot be mapped.
+	if ( f.size_ == 0 ) {
+		return f;
+	}
+	f.mapping_ = CreateFileMappingA( f.file_, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if ( f.mapping_ == nullptr ) {
+		throw file_error( path, "mmap" );
+	}
+	f.data_ = static_cast<uint8_t *>( MapViewOfFile( f.mapping_, FILE_MAP_READ, 0, 0, 0 ) );
+	if ( f.data_ == nullptr ) {
+		throw file_error( path, "mmap" );
+	}
+	return f;
+}
+
+mapped_file mapped_file::create( const std::string &path, const size_t size ) {
+	mapped_file f;
+	f.file_ = CreateFileA( path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+	                       nullptr );
+	if ( f.file_ == INVALID_HANDLE_VALUE ) {
+		f.file_ = nullptr;
+		throw file_error( path, "create" );
+	}
+	f.size_ = size;
+	if ( size == 0 ) {
+		return f;
+	}
+	const uint64_t size64 = size;
+	f.mapping_ = CreateFileMappingA( f.file_, nullptr, PAGE_READWRITE, static_cast<DWORD>( size64 >> 32 ),
+	                                 static_cast<DWORD>( size64 ), nullptr );
+	if ( f.mapping_ == nullptr ) {
+		throw file_error( path, "mmap" );
+	}
+	f.data_ = static_cast<uint8_t *>( MapViewOfFile( f.mapping_, FILE_MAP_WRITE, 0, 0, 0 ) );
+	if ( f.data_ == nullptr ) {
+		throw file_error( path, "mmap" );
+	}
+	return f;
+}
+
+void mapped_file::close() {
+	if ( data_ != nullptr ) {
+		UnmapViewOfFile( data_ );
+	}
+	if ( mapping_ != nullptr ) {
+		CloseHandle( mapping_ );
+	}
+	if ( file_ != nullptr ) {
+		CloseHandle( file_ );
+	}
+	data_ = nullptr;
+	mapping_ = nullptr;
+	file_ = nullptr;
+	size_ = 0;
+}
+
+mapped_file::mapped_file( mapped_file &&other ) noexcept
+    : data_( std::exchange( other.data_, nullptr ) ),
+      size_( std::exchange( other.size_, 0 ) ),
+      file_( std::exchange( other.file_, nullptr ) ),
+      mapping_( std::exchange( other.mapping_, nullptr ) ) {}
+
+mapped_file &mapped_file::operator=( mapped_file &&other ) noexcept {
+	if ( this != &other ) {
+		close();
+		data_ = std::exchange( other.data_, nullptr );
+		size_ = std::exchange( other.size_, 0 );
+		file_ = std::exchange( other.file_, nullptr );
+		mapping_ = std::exchange( other.mapping_, nullptr );
+	}
+	return *this;
+}
+
+#else
+
+mapped_file mapped_file::open_read( const std::string &path ) {
+	mapped_file f;
+	f.fd_ = ::open( path.c_str(), O_RDONLY );
+	if ( f.fd_ < 0 ) {
+		throw file_error( path, "open" );
+	}
+	struct stat st;
+	if ( fstat( f.fd_, &st ) != 0 ) {
+		throw file_error( path, "stat" );
+	}
+	f.size_ = static_cast<size_t>( st.st_size );
+	// An empty file cannot be mapped.
+	if ( f.size_ == 0 ) {
+		return f;
+	}
+	void *p = mmap( nullptr, f.size_, PROT_READ, MAP_PRIVATE, f.fd_, 0 );
+	if ( p == MAP_FAILED ) {
+		throw file_error( path, "mmap" );
+	}
+	f.data_ = static_cast<uint8_t *>( p );
+	// The whole file is read once, front to back.
+	madvise( p, f.size_, MADV_SEQUENTIAL );
+	return f;
+}
+
+mapped_file mapped_file::create( const std::string &path, const size_t size ) {
+	mapped_file f;
+	f.fd_ = ::open( path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+	if ( f.fd_ < 0 ) {
+		throw file_error( path, "create" );
+	}
+	f.size_ = size;
+	if ( size == 0 ) {
+		return f;
+	}
+	if ( ftruncate( f.fd_, static_cast<off_t>( size ) ) != 0 ) {
+		throw file_error( path, "truncate" );
+	}
+	void *p = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, f.fd_, 0 );
+	if ( p == MAP_FAILED ) {
+		throw file_error( path, "mmap" );
+	}
+	f.data_ = static_cast<uint8_t *>( p );
+	return f;
+}
+
+void mapped_file::close() {
+	if ( data_ != nullptr ) {
+		munmap( data_, size_ );
+	}
+	if ( fd_ >= 0 ) {
+		::close( fd_ );
+	}
+	data_ = nullptr;
+	size_ = 0;
+	fd_ = -1;
+}
+
+mapped_file::mapped_file( mapped_file &&other ) noexcept
+    : data_( std::exchange( other.data_, nullptr ) ),
+      size_( std::exchange( other.size_, 0 ) ),
+      fd_( std::exchange( other.fd_, -1 ) ) {}
+
+mapped_file &mapped_file::operator=( mapped_file &&other ) noexcept {
+	if ( this != &other ) {
+		close();
+		data_ = std::exchange( other.data_, nullptr );
+		size_ = std::exchange( other.size_, 0 );
+		fd_ = std::exchange( other.fd_, -1 );
+	}
+	return *this;
+}
+
+#endif
+
+mapped_file::~mapped_file() { close(); }
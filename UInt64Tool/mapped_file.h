@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+// Memory-mapped files : POSIX mmap(), Win32 file mappings.
+// Inputs are mapped read-only and read in place. Outputs are created with their final size and written in place,
+// the kernels store results straight into the page cache.
+
+class mapped_file {
+   public:
+	/**
+	 * open_read( const std::string &path )
+	 * @return read-only mapping of the whole file
+	 */
+	static mapped_file open_read( const std::string &path );
+
+	/**
+	 * create( const std::string &path, size_t size )
+	 * Creates or truncates path to size bytes.
+	 * @return read-write mapping of the whole file
+	 */
+	static mapped_file create( const std::string &path, size_t size );
+
+	mapped_file() = default;
+	mapped_file( mapped_file &&other ) noexcept;
+	mapped_file &operator=( mapped_file &&other ) noexcept;
+	mapped_file( const mapped_file & ) = delete;
+	mapped_file &operator=( const mapped_file & ) = delete;
+	~mapped_file();
+
+	const uint8_t *data() const { return data_; }
+	uint8_t *data() { return data_; }
+	size_t size() const { return size_; }
+
+   private:
+	void close();
+
+	uint8_t *data_ = nullptr;
+	size_t size_ = 0;
+#if defined( _WIN32 )
+	void *file_ = nullptr;
+	void *mapping_ = nullptr;
+#else
+	int fd_ = -1;
+#endif
+};
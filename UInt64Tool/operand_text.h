@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+// Text operands : unsigned decimal or 0x-prefixed hexadecimal numbers separated by white space.
+// Parsing and formatting work on raw buffers without locale or errno, so a mapped file is read in place.
+
+// Digits of 2^64 - 1.
+const size_t max_decimal_digits = 20;
+
+inline bool is_operand_space( const char c ) {
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+inline int hex_digit( const char c ) {
+	if ( c >= '0' && c <= '9' ) {
+		return c - '0';
+	}
+	if ( ( c | 0x20 ) >= 'a' && ( c | 0x20 ) <= 'f' ) {
+		return ( c | 0x20 ) - 'a' + 10;
+	}
+	return -1;
+}
+
+/**
+ * parse_operands( const char *p, const char *end, std::vector<uint64_t> *out )
+ * Appends the numbers of [ p, end ) to out.
+ * @return nullptr, or the start of the first malformed or out of range number
+ */
+inline const char *parse_operands( const char *p, const char *end, std::vector<uint64_t> *out ) {
+	for ( ;; ) {
+		while ( p < end && is_operand_space( *p ) ) {
+			p++;
+		}
+		if ( p == end ) {
+			return nullptr;
+		}
+		const char *start = p;
+		uint64_t x = 0;
+		if ( end - p > 2 && p[ 0 ] == '0' && ( p[ 1 ] | 0x20 ) == 'x' ) {
+			p += 2;
+			const char *digits = p;
+			for ( int d; p < end && ( d = hex_digit( *p ) ) >= 0; p++ ) {
+				x = ( x << 4 ) | static_cast<uint64_t>( d );
+			}
+			if ( p == digits || p - digits > 16 ) {
+				return start;
+			}
+		} else {
+			for ( ; p < end && static_cast<unsigned>( *p - '0' ) < 10; p++ ) {
+				const uint64_t d = static_cast<uint64_t>( *p - '0' );
+				// x * 10 + d > 2^64 - 1
+				if ( x > ( 0xFFFF'FFFF'FFFF'FFFFULL - d ) / 10 ) {
+					return start;
+				}
+				x = x * 10 + d;
+			}
+			if ( p == start ) {
+				return start;
+			}
+		}
+		if ( p < end && !is_operand_space( *p ) ) {
+			return start;
+		}
+		out->push_back( x );
+	}
+}
+
+/**
+ * parse_operand( const char *text, uint64_t *x )
+ * @return true if text is exactly one number
+ */
+inline bool parse_operand( const char *text, uint64_t *x ) {
+	std::vector<uint64_t> v;
+	if ( parse_operands( text, text + strlen( text ), &v ) != nullptr || v.size() != 1 ) {
+		return false;
+	}
+	*x = v[ 0 ];
+	return true;
+}
+
+/**
+ * format_decimal( uint64_t x, char *p )
+ * Writes x in decimal, two digits per division.
+ * @param p room for max_decimal_digits characters
+ * @return end of the digits
+ */
+inline char *format_decimal( uint64_t x, char *p ) {
+	static const char pairs[] =
+	    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	    "8081828384858687888990919293949596979899";
+	char digits[ max_decimal_digits ];
+	char *q = digits + max_decimal_digits;
+	while ( x >= 100 ) {
+		const size_t r = static_cast<size_t>( x % 100 ) * 2;
+		x /= 100;
+		*--q = pairs[ r + 1 ];
+		*--q = pairs[ r ];
+	}
+	if ( x >= 10 ) {
+		*--q = pairs[ x * 2 + 1 ];
+		*--q = pairs[ x * 2 ];
+	} else {
+		*--q = static_cast<char>( '0' + x );
+	}
+	const size_t n = static_cast<size_t>( digits + max_decimal_digits - q );
+	memcpy( p, q, n );
+	return p + n;
+}